@@ -56,15 +56,50 @@ namespace rv {
                         const int       maskPosition,
                         const bool      mayHaveSideEffects);
 
+    // register all SIMD variants in the module that follow the x86 vector function ABI
+    // (functions named _ZGV<isa><mask><vlen><params>_<name> and "vector-variants" function attributes)
+    void addVectorABIMappings();
+
+    // the most specific vector function ABI variant of @scalarFn for @vectorWidth that accepts arguments of @argShapes
+    // masked variants are preferred if the call is @predicated, unmasked ones otherwise
+    // only variants for an ISA that @targetFn is compiled for qualify, the selected variant is declared on demand
+    const VectorMapping * getSIMDVariant(const Function & scalarFn, unsigned vectorWidth,
+                                         const VectorShapeVec & argShapes, bool predicated,
+                                         const Function & targetFn);
+
+    // whether the "target-features" of @fn contain @feature (e.g. "+avx512f")
+    static bool hasTargetFeature(const Function & fn, StringRef feature);
+    // whether @fn is compiled for AVX-512 (512bit registers and dedicated predicate registers)
+    bool hasAVX512(const Function & fn) const;
+    // whether the TTI is backed by a target machine (the target independent TTI reports 32bit vector registers)
+    bool hasTargetTTI() const;
+    // whether masked loads (@isLoad) or stores of @vecType are legal in @fn
+    // without a target machine the "target-features" of @fn decide, functions without features keep the intrinsics
+    bool isLegalMaskedMemory(const Function & fn, Type * vecType, bool isLoad) const;
+
     const DataLayout & getDataLayout() const { return mod.getDataLayout(); }
   private:
     VectorMapping * inferMapping(llvm::Function & scalarFnc, llvm::Function & simdFnc, int maskPos);
 
+    // register @simdFnc as the variant @mangledName of @scalarFnc (declared as @simdName when used if @simdFnc is null)
+    bool addVectorABIVariant(Function & scalarFnc, Function * simdFnc, StringRef mangledName, StringRef simdName);
+    // whether the target of @targetFn supports the vector function ABI @isa (b: SSE, c: AVX, d: AVX2, e: AVX-512)
+    bool supportsVectorABIISA(const Function & targetFn, char isa) const;
+
+    // vector function ABI variant (mapping.vectorFn is null until the variant is selected for the first time)
+    struct SIMDVariant {
+      VectorMapping * mapping;
+      char isa;
+      std::string simdName;
+      FunctionType * simdFnTy;
+    };
+
     Module & mod;
     TargetTransformInfo *mTTI;
     TargetLibraryInfo *mTLI;
     Module *avx2Mod, *avxMod, *sseMod;
     VectorFuncMap funcMappings;
+    std::map<const Function *, std::vector<SIMDVariant>> simdVariants;
     std::vector<VecDesc> commonVectorMappings;
   };
 
@@ -10,6 +10,10 @@
 //
 //
 
+#include <map>
+#include <vector>
+
+#include <llvm/ADT/BitVector.h>
 #include <llvm/ADT/DenseMap.h>
 #include <llvm/ADT/SmallPtrSet.h>
 #include <llvm/Analysis/LoopInfo.h>
@@ -55,29 +59,38 @@ namespace rv {
 class BranchDependenceAnalysis {
   static ConstBlockSet emptySet;
 
-  // iterated post dominance frontier
-  DenseMap<const llvm::BasicBlock*, ConstBlockSet> pdClosureMap;
-  DenseMap<const llvm::BasicBlock*, ConstBlockSet> domClosureMap;
+  // dense block numbering for the closure bit vectors
+  std::vector<const llvm::BasicBlock*> blocks;
+  DenseMap<const llvm::BasicBlock*, unsigned> blockIndex;
+
+  // iterated control dependence (post dominance frontier) and iterated dominance frontier closures (computed on demand)
+  std::vector<llvm::BitVector> pdClosures;
+  std::vector<llvm::BitVector> domClosures;
+  llvm::BitVector hasPdClosure;
+  llvm::BitVector hasDomClosure;
 
-  DenseMap<const llvm::TerminatorInst*, ConstBlockSet> effectedBlocks;
+  // effected blocks of the branches that were queried so far (references stay valid on insertion)
+  std::map<const llvm::TerminatorInst*, ConstBlockSet> effectedBlocks;
   const llvm::CDG & cdg;
   const llvm::DFG & dfg;
   const llvm::DominatorTree & domTree;
   const llvm::PostDominatorTree & postDomTree;
   const llvm::LoopInfo & loopInfo;
 
-  void computePostDomClosure(const llvm::BasicBlock & x, ConstBlockSet & closure);
-  void computeDomClosure(const llvm::BasicBlock & b, ConstBlockSet & closure);
+  unsigned getIndex(const llvm::BasicBlock & block) const;
+  const llvm::BitVector & getPostDomClosure(const llvm::BasicBlock & x);
+  const llvm::BitVector & getDomClosure(const llvm::BasicBlock & b);
+
+  // whether @z joins two disjoint paths from @brBlock to it
+  bool isDivergentJoin(const llvm::BasicBlock & brBlock, const llvm::BasicBlock & z);
+  void computeEffectedBlocks(const llvm::BasicBlock & brBlock, ConstBlockSet & phiBlocks);
 
 public:
   BranchDependenceAnalysis(llvm::Function & F, const llvm::CDG & cdg, const llvm::DFG & dfg, const llvm::DominatorTree & _domtree, const llvm::PostDominatorTree & postDomTree, const llvm::LoopInfo & loopInfo);
 
   /// \brief returns the set of blocks whose PHI nodes become divergent if @branch is divergent
-  const ConstBlockSet & getEffectedBlocks(const llvm::TerminatorInst & term) const {
-    auto it = effectedBlocks.find(&term);
-    if (it == effectedBlocks.end()) return emptySet;
-    return it->second;
-  }
+  /// the set is computed when the branch is queried for the first time
+  const ConstBlockSet & getEffectedBlocks(const llvm::TerminatorInst & term);
 };
 
 } // namespace rv
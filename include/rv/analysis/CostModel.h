@@ -0,0 +1,112 @@
+//===- CostModel.h ----------------*- C++ -*-===//
+//
+//                     The Region Vectorizer
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+// ----------------------------------------------------------------------------
+// Vector width cost model
+// Estimates the cost of vectorizing an analyzed region at a given vector width
+// ----------------------------------------------------------------------------
+
+#ifndef RV_ANALYSIS_COSTMODEL_H
+#define RV_ANALYSIS_COSTMODEL_H
+
+#include <memory>
+#include <vector>
+
+#include <llvm/ADT/ArrayRef.h>
+
+namespace llvm {
+  class BasicBlock;
+  class DominatorTree;
+  class Instruction;
+  class TargetTransformInfo;
+  class Type;
+  class raw_ostream;
+}
+
+namespace rv {
+
+class PlatformInfo;
+class VectorizationInfo;
+
+// cost estimate of one vectorized instance of the region at @vectorWidth
+struct WidthEstimate {
+  unsigned vectorWidth;
+  // estimated cost of executing the region once with @vectorWidth lanes
+  unsigned cost;
+
+  // lowering events that are expensive in vector code
+  unsigned numGathers;
+  unsigned numScatters;
+  unsigned numReplicatedCalls;
+  unsigned numCascades; // masked memory accesses the target can not do natively
+  unsigned numBlends;   // selects of folded phi nodes
+
+  // registers needed for the live varying values of the widest type
+  unsigned registerPressure;
+  unsigned numSpills;
+
+  WidthEstimate(unsigned _vectorWidth)
+  : vectorWidth(_vectorWidth)
+  , cost(0)
+  , numGathers(0)
+  , numScatters(0)
+  , numReplicatedCalls(0)
+  , numCascades(0)
+  , numBlends(0)
+  , registerPressure(0)
+  , numSpills(0)
+  {}
+
+  // cost per scalar instance
+  double getCostPerLane() const { return cost / (double) vectorWidth; }
+
+  void print(llvm::raw_ostream & out) const;
+};
+
+class CostModel {
+  PlatformInfo & platInfo;
+  VectorizationInfo & vecInfo;
+  const llvm::DominatorTree & domTree;
+  // target independent defaults if the platform has no TTI (declared before tti, which may refer to it)
+  std::unique_ptr<llvm::TargetTransformInfo> defaultTTI;
+  llvm::TargetTransformInfo & tti;
+
+  // whether @block will execute under a (non-trivial) mask
+  bool isPredicated(const llvm::BasicBlock & block) const;
+  // whether the phi nodes in @block are folded to selects
+  bool isBlendBlock(const llvm::BasicBlock & block) const;
+
+  // whether @inst produces a vector value
+  bool isVectorized(const llvm::Instruction & inst) const;
+
+  unsigned getScalarCost(const llvm::Instruction & inst) const;
+  unsigned getVectorCost(const llvm::Instruction & inst, llvm::Type & vecTy, WidthEstimate & estimate) const;
+  unsigned getMemoryCost(const llvm::Instruction & inst, WidthEstimate & estimate) const;
+  unsigned getCallCost(const llvm::Instruction & inst, WidthEstimate & estimate) const;
+  // cost of computing @inst once per lane and packing the results into a vector
+  unsigned getReplicatedCost(const llvm::Instruction & inst, unsigned vectorWidth) const;
+
+  // number of registers of the vector type of @ty
+  unsigned getNumParts(llvm::Type & ty, unsigned vectorWidth) const;
+
+  // estimate the maximal number of vector registers live at once
+  void estimateRegisterPressure(WidthEstimate & estimate) const;
+
+public:
+  CostModel(PlatformInfo & _platInfo, VectorizationInfo & _vecInfo, const llvm::DominatorTree & _domTree);
+  ~CostModel();
+
+  // estimate the cost of the analyzed region at @vectorWidth
+  WidthEstimate estimate(unsigned vectorWidth) const;
+
+  // estimates for all @candidateWidths ranked by cost per lane (cheapest first)
+  std::vector<WidthEstimate> rank(llvm::ArrayRef<unsigned> candidateWidths) const;
+};
+
+}
+
+#endif // RV_ANALYSIS_COSTMODEL_H
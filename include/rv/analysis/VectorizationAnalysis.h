@@ -11,8 +11,10 @@
 
 #include <string>
 #include <map>
+#include <functional>
 #include <queue>
 
+#include "llvm/ADT/BitVector.h"
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/IR/BasicBlock.h"
@@ -30,6 +32,7 @@
 #include "DFG.h"
 
 #include "rv/vectorizationInfo.h"
+#include "rv/shapeMap.h"
 #include "rv/vectorMapping.h"
 #include "rv/VectorizationInfoProxyPass.h"
 #include "rv/region/Region.h"
@@ -60,7 +63,6 @@ class VectorizationAnalysis {
   DataLayout layout;
 
 public:
-  using ValueMap          = std::map<const Value*, VectorShape>;
   using InstructionSet    = llvm::SmallPtrSet<const Instruction*, 32>;
 
   VectorizationAnalysis(PlatformInfo & platInfo,
@@ -80,12 +82,6 @@ public:
   //  if loop carried, this is the shape observed within the loop that defines @V
   VectorShape getShape(const Value* const V);
 
-  //---------------------- Iterators --------------------------//
-  typename ValueMap::iterator begin();
-  typename ValueMap::iterator end();
-  typename ValueMap::const_iterator begin() const;
-  typename ValueMap::const_iterator end() const;
-
 private:
   VectorizationInfo& mVecinfo;  // This will be the output
   const CDG& mCDG;      // Preserves CDG
@@ -96,8 +92,19 @@ private:
 
   Region* mRegion;
 
-  ValueMap mValue2Shape;    // Computed shapes
-  std::queue<const Instruction*> mWorklist;       // Next instructions to handle
+  ShapeMap mValue2Shape;    // Computed shapes (dense table over the values of the function)
+
+  // Next instructions to handle, in reverse post order of their blocks.
+  // Every instruction is queued at most once. Acyclic code converges in one pass,
+  // values in loops are revisited until their shapes are stable.
+  std::vector<const Instruction*> mRPOInsts;
+  DenseMap<const Instruction*, unsigned> mRPOIndex;
+  std::priority_queue<unsigned, std::vector<unsigned>, std::greater<unsigned>> mWorklist;
+  llvm::BitVector mInWorklist;
+
+  void numberInstructions(Function& F);
+  void pushToWorklist(const Instruction* I);
+  const Instruction* popFromWorklist();
 
   // VectorShape analysis logic
 
@@ -155,8 +162,7 @@ private:
   // Returns true iff the constant is aligned respective to mVectorizationFactor
   unsigned getAlignment(const Constant* c) const;
 
-  // Transfers the computed VectorShapes from mvalues to the VectorizationInfo object
-  // TODO just write into mVecinfo immediately?
+  // Moves the computed VectorShapes to the VectorizationInfo object
   void fillVectorizationInfo(Function& F);
 };
 
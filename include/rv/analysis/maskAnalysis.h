@@ -18,9 +18,10 @@
 #include <llvm/Pass.h>
 #include <llvm/ADT/SmallVector.h>
 #include <llvm/ADT/DenseSet.h>
+#include <llvm/ADT/SmallPtrSet.h>
 #include <llvm/Transforms/Utils/ValueMapper.h>
 
-#include <memory> // shared_ptr, weak_ptr
+#include <llvm/Support/Allocator.h>
 
 namespace llvm {
 class Value;
@@ -133,10 +134,17 @@ private:
     VectorizationInfo& vecInfo;
     const LoopInfo&    mLoopInfo;
 
+    // Mask nodes and mask infos are allocated from these arenas
+    // and released together with the analysis.
+    SpecificBumpPtrAllocator<Mask>             mMaskArena;
+    SpecificBumpPtrAllocator<BlockMaskInfo>    mBlockInfoArena;
+    SpecificBumpPtrAllocator<LoopMaskInfo>     mLoopInfoArena;
+    SpecificBumpPtrAllocator<LoopExitMaskInfo> mLoopExitInfoArena;
+
     DenseMap<const BasicBlock*, BlockMaskInfo*>    mBlockMap;
     DenseMap<const Loop*,       LoopMaskInfo*>     mLoopMaskMap;
     DenseMap<const BasicBlock*, LoopExitMaskInfo*> mLoopExitMap;
-    std::vector<MaskPtr>                           mMasks;
+    std::vector<MaskPtr>                           mMasks; // indexed by mask ID
 
     Value * mConstBoolFalse;
     Value * mConstBoolTrue;
@@ -147,8 +155,10 @@ private:
 	BlockMaskInfo* getOrCreateBMIFor(BasicBlock* block);
 
     void    createMaskGraph   (Function&                f);
-    void    recCreateMaskGraph(BasicBlock*              block,
-                               DenseSet<BasicBlock*>&   markedBlocks);
+    // region blocks reachable from @start in reverse post order
+    void    computeBlockOrder (BasicBlock*              start,
+                               SmallVector<BasicBlock*, 32>& blockOrder);
+    void    createBlockMasks  (BasicBlock*              block);
     MaskPtr createEntryMask   (BasicBlock*              block);
     void    createExitMasks   (BasicBlock*              block,
                                MaskPtr                  entryMask,
@@ -1,6 +1,7 @@
 #include <llvm/IR/Function.h>
 #include <llvm/IR/Instructions.h>
 #include <llvm/Analysis/LoopInfo.h>
+#include <llvm/Analysis/ScalarEvolution.h>
 #include <llvm/IR/Constant.h>
 
 #include <map>
@@ -8,10 +9,33 @@
 namespace rv {
 
 
+// kind of reduction operation
+enum class RedKind {
+  Binary, // Add, Sub, Mul, FAdd, FSub, FMul, And, Or, Xor
+  SMin,
+  SMax,
+  UMin,
+  UMax,
+  FMin, // fcmp + select idiom or llvm.minnum
+  FMax, // fcmp + select idiom or llvm.maxnum
+  Index // index of the min/max of a paired select reduction (see pairedRed)
+};
+
+const char * to_string(RedKind kind);
+
 // models a primitive value reduction of the form
 // @phi [@initInputIndex, V]. [@loopInputIndex, @reductInst]
 // where @reductInst has two operands: @phi and @reductInput
+//
+// @reductInst may also be a phi of a predicated update of the form
+// [@phi, ..], [@reductOp, ..] (see getReductOp)
+//
+// for min/max reductions the reduction operation is a select (or minnum/maxnum call).
+// Index reductions track the position of the min/max of @pairedRed:
+// @reductInst is a select that shares its condition with the select of @pairedRed
 struct Reduction {
+  // kind of the reduction operation
+  RedKind kind;
   // neutral element of this reduction operation
   llvm::Constant & neutralElem;
   // instruction feeding into the reduction phi
@@ -24,23 +48,42 @@ struct Reduction {
   int initInputIndex;
   int loopInputIndex;
 
+// Index reductions only
+  // min/max reduction whose position is tracked
+  Reduction * pairedRed;
+  // whether the first index of the min/max is tracked (or the last one)
+  bool takeFirstIndex;
+  // whether the index grows with the iteration (the first index is the lowest one)
+  bool increasingIndex;
+
+  // whether the lowest index of the min/max over all lanes is selected (or the highest one)
+  bool takeLowestIndex() const { return takeFirstIndex == increasingIndex; }
+
   llvm::Instruction & getReductInst() {
     return llvm::cast<llvm::Instruction>(*phi.getIncomingValue(loopInputIndex));
   }
 
+  // operation carrying out the reduction. Looks through the phi that merges
+  // a predicated update (if (c) r = r + x) with the unmodified reduction phi
+  llvm::Instruction & getReductOp();
+
   llvm::Value & getInitValue() {
     return *phi.getIncomingValue(initInputIndex);
   }
 
   void dump() const;
 
-  Reduction(llvm::Constant & _neutralElem, llvm::Value & _reductInput, llvm::Loop & _reductLoop, llvm::PHINode & _phi, int _initInputIndex, int _loopInputIndex)
-  : neutralElem(_neutralElem)
+  Reduction(RedKind _kind, llvm::Constant & _neutralElem, llvm::Value & _reductInput, llvm::Loop & _reductLoop, llvm::PHINode & _phi, int _initInputIndex, int _loopInputIndex)
+  : kind(_kind)
+  , neutralElem(_neutralElem)
   , redInput(_reductInput)
   , redLoop(_reductLoop)
   , phi(_phi)
   , initInputIndex(_initInputIndex)
   , loopInputIndex(_loopInputIndex)
+  , pairedRed(nullptr)
+  , takeFirstIndex(true)
+  , increasingIndex(true)
   {}
 };
 
@@ -50,13 +93,21 @@ class ReductionAnalysis {
 
   llvm::Function & func;
   const llvm::LoopInfo & loopInfo;
+  llvm::ScalarEvolution & SE;
 
   void analyze(llvm::Loop & loop);
   llvm::Constant * inferNeutralElement(llvm::Instruction & reductInst);
+  llvm::Constant * inferNeutralElement(RedKind kind, llvm::Type & reductTy);
+  // match min/max idioms (select patterns and minnum/maxnum calls)
+  bool matchMinMax(llvm::Instruction & reductInst, llvm::PHINode & headerPhi, RedKind & kind);
   Reduction* tryInferReduction(llvm::PHINode & headerPhi);
+  // index-of-min/max reduction (requires the paired min/max reduction to be known)
+  Reduction* tryInferIndexReduction(llvm::PHINode & headerPhi);
+  // whether @val is an affine induction of @loop with a known sign of the step: 1 (increasing), -1 (decreasing) or 0 (unknown)
+  int getInductionDirection(llvm::Value & val, llvm::Loop & loop);
 
 public:
-  ReductionAnalysis(llvm::Function & _func, const llvm::LoopInfo & _loopInfo);
+  ReductionAnalysis(llvm::Function & _func, const llvm::LoopInfo & _loopInfo, llvm::ScalarEvolution & _SE);
   ~ReductionAnalysis();
 
   void analyze();
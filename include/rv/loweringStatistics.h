@@ -0,0 +1,79 @@
+//===- loweringStatistics.h -----------------------------===//
+//
+//                     The Region Vectorizer
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+
+#ifndef INCLUDE_RV_LOWERINGSTATISTICS_H_
+#define INCLUDE_RV_LOWERINGSTATISTICS_H_
+
+#include <vector>
+
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/IR/DebugLoc.h>
+
+namespace llvm {
+  class Function;
+  class Instruction;
+}
+
+namespace rv {
+
+// how an instruction of the scalar function ended up in the vector code
+enum class LoweringKind {
+  ContiguousLoad,   // one vector load
+  ContiguousStore,
+  MaskedLoad,       // llvm.masked.load
+  MaskedStore,      // llvm.masked.store
+  InterleavedLoad,  // member of an interleaved group (wide loads + shuffles)
+  InterleavedStore,
+  Gather,           // llvm.masked.gather
+  Scatter,          // llvm.masked.scatter
+  CascadeLoad,      // one scalar load per lane
+  CascadeStore,
+  Fallback,         // replicated per lane (fallbackVectorize)
+  ReplicatedCall,   // one scalar call per lane
+  VectorCall,       // call of a vector function ABI variant
+  SleefCall,        // call of a vector math library function
+  BlendSelect,      // select introduced for a linearized phi or mask
+  Reduction,        // rv_any/rv_all introduced by the linearizer
+  NumKinds
+};
+
+const char * GetLoweringKindName(LoweringKind kind);
+
+/*
+ * Counts how the instructions of one function were lowered per source location.
+ * Filled by MaskGenerator, Linearizer and the native backend (see VectorizationInfo::getLoweringStatistics)
+ * and reported as optimization remarks of the "rv" pass.
+ */
+class LoweringStatistics {
+  static const unsigned NumKinds = static_cast<unsigned>(LoweringKind::NumKinds);
+
+  struct LocationCounts {
+    llvm::DebugLoc loc;
+    unsigned counts[NumKinds];
+  };
+
+  // source locations in the order they were first seen (index 0 for code without location)
+  std::vector<LocationCounts> locations;
+  llvm::DenseMap<const llvm::MDNode *, unsigned> locationIndex;
+  unsigned totals[NumKinds];
+
+public:
+  LoweringStatistics();
+
+  void add(LoweringKind kind, const llvm::DebugLoc & loc);
+  void add(LoweringKind kind, const llvm::Instruction & origin);
+
+  unsigned getTotal(LoweringKind kind) const { return totals[static_cast<unsigned>(kind)]; }
+
+  // emit one analysis remark per source location and a summary remark for @func
+  void emitRemarks(const llvm::Function & func) const;
+};
+
+}
+
+#endif /* INCLUDE_RV_LOWERINGSTATISTICS_H_ */
@@ -11,6 +11,9 @@
 
 #include "rv/PlatformInfo.h"
 #include "rv/analysis/DFG.h"
+#include "rv/analysis/CostModel.h"
+
+#include <vector>
 
 namespace llvm {
   class LoopInfo;
@@ -22,6 +25,17 @@ namespace rv {
 
 class VectorizationInfo;
 class MaskAnalysis;
+class TimeReport;
+
+/*
+ * Lowering of predicated code that has to run lane by lane
+ * (replicated calls with side effects, masked memory accesses without native support).
+ */
+enum class LaneIteration {
+  Auto,     // default lowering (currently unrolled, active lane loops are opt-in)
+  Unrolled, // one condition/masked block pair per lane
+  Loop      // iterate only the active lanes: while (m) { lane = cttz(m); ...; m &= m - 1; }
+};
 
 /*
  * The new vectorizer interface.
@@ -55,6 +69,22 @@ public:
                  const llvm::PostDominatorTree& postDomTree,
                  const llvm::DominatorTree& domTree);
 
+    /*
+     * Run the analyses (see analyze) once and estimate the cost of vectorizing the
+     * region at each of the @candidateWidths with the target's cost model (PlatformInfo::getTTI).
+     *
+     * Returns the estimates ranked by cost per scalar instance (cheapest first).
+     * Vector shapes may depend on the vector width: vectorize the winner with a fresh
+     * VectorizationInfo unless it matches the width of @vectorizationInfo.
+     */
+    std::vector<WidthEstimate> rankVectorWidths(VectorizationInfo& vectorizationInfo,
+                                                const llvm::CDG& cdg,
+                                                const llvm::DFG& dfg,
+                                                const llvm::LoopInfo& loopInfo,
+                                                const llvm::PostDominatorTree& postDomTree,
+                                                const llvm::DominatorTree& domTree,
+                                                llvm::ArrayRef<unsigned> candidateWidths);
+
     /*
      * Analyze mask values needed to mask certain values and preserve semantics of the function
      * after its control flow is linearized where needed.
@@ -77,6 +107,31 @@ public:
                       llvm::LoopInfo& loopInfo,
                       llvm::DominatorTree& domTree);
 
+    /*
+     * Guard linearized blocks whose estimated cost exceeds @costThreshold with
+     * uniform rv_any/rv_all branches (BOSCC). Pass 0 to disable (default).
+     */
+    void setBOSCCThreshold(unsigned costThreshold) { bosccThreshold = costThreshold; }
+
+    /*
+     * Select how predicated code is replicated for the active lanes (default: LaneIteration::Auto).
+     */
+    void setLaneIteration(LaneIteration _laneIteration) { laneIteration = _laneIteration; }
+
+    /*
+     * Record the compile time and heap usage of each phase, the size of the analyzed functions
+     * and vectorizer statistics in @_timeReport (see TimeReport). Pass nullptr to disable (default).
+     * The report is owned by the caller and may be shared by several VectorizerInterfaces.
+     */
+    void setTimeReport(TimeReport * _timeReport) { timeReport = _timeReport; }
+    TimeReport * getTimeReport() const { return timeReport; }
+
+    /*
+     * Emit optimization remarks on how the instructions were lowered (see LoweringStatistics).
+     * They are always emitted if the LLVMContext has a diagnostic handler (default: false).
+     */
+    void setLoweringRemarks(bool enable) { loweringRemarks = enable; }
+
     /*
      * Produce vectorized instructions
      */
@@ -91,6 +146,10 @@ public:
 
 private:
     PlatformInfo platInfo;
+    unsigned bosccThreshold;
+    LaneIteration laneIteration;
+    TimeReport * timeReport;
+    bool loweringRemarks;
 
     void addIntrinsics();
 };
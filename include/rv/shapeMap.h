@@ -0,0 +1,113 @@
+//===- shapeMap.h -----------------------------===//
+//
+//                     The Region Vectorizer
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+
+#ifndef INCLUDE_RV_SHAPEMAP_H_
+#define INCLUDE_RV_SHAPEMAP_H_
+
+#include <vector>
+
+#include <llvm/ADT/BitVector.h>
+#include <llvm/ADT/DenseMap.h>
+
+#include "vectorShape.h"
+
+namespace llvm {
+  class Value;
+}
+
+namespace rv {
+
+// dense numbering of values (arguments, blocks, instructions..)
+// values are numbered in the order they are first inserted
+class ValueIndex {
+  llvm::DenseMap<const llvm::Value*, unsigned> index;
+  std::vector<const llvm::Value*> values;
+
+public:
+  static const int NotFound = -1;
+
+  unsigned insert(const llvm::Value & val) {
+    auto it = index.find(&val);
+    if (it != index.end()) return it->second;
+
+    unsigned idx = values.size();
+    index[&val] = idx;
+    values.push_back(&val);
+    return idx;
+  }
+
+  int find(const llvm::Value & val) const {
+    auto it = index.find(&val);
+    return it == index.end() ? NotFound : static_cast<int>(it->second);
+  }
+
+  const llvm::Value * operator[](unsigned idx) const { return values[idx]; }
+  unsigned size() const { return values.size(); }
+};
+
+// vector shapes of values stored in a flat table
+class ShapeMap {
+  ValueIndex index;
+  std::vector<VectorShape> shapes;
+  llvm::BitVector known;
+
+public:
+  unsigned size() const { return index.size(); }
+
+  bool count(const llvm::Value & val) const {
+    int idx = index.find(val);
+    return idx != ValueIndex::NotFound && known.test(idx);
+  }
+
+  // the shape of @val or nullptr if it has none
+  const VectorShape * lookup(const llvm::Value & val) const {
+    int idx = index.find(val);
+    if (idx == ValueIndex::NotFound || !known.test(idx)) return nullptr;
+    return &shapes[idx];
+  }
+
+  // the shape of @val. an undefined shape is inserted if it has none
+  VectorShape & operator[](const llvm::Value & val) {
+    unsigned idx = index.insert(val);
+    if (idx >= shapes.size()) {
+      shapes.resize(idx + 1);
+      known.resize(idx + 1);
+    }
+    known.set(idx);
+    return shapes[idx];
+  }
+
+  void erase(const llvm::Value & val) {
+    int idx = index.find(val);
+    if (idx != ValueIndex::NotFound) known.reset(idx);
+  }
+
+  // visit all values with a shape
+  template<class Func>
+  void forEach(Func func) const {
+    for (int idx = known.find_first(); idx != -1; idx = known.find_next(idx)) {
+      func(*index[idx], shapes[idx]);
+    }
+  }
+};
+
+// a set of blocks as a bit vector over a block numbering
+class BlockFlags {
+  llvm::BitVector flags;
+
+public:
+  bool test(int idx) const { return idx != ValueIndex::NotFound && idx < static_cast<int>(flags.size()) && flags.test(idx); }
+  void set(unsigned idx) {
+    if (idx >= flags.size()) flags.resize(idx + 1);
+    flags.set(idx);
+  }
+};
+
+}
+
+#endif /* INCLUDE_RV_SHAPEMAP_H_ */
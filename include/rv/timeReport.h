@@ -0,0 +1,114 @@
+//===- timeReport.h -----------------------------===//
+//
+//                     The Region Vectorizer
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+
+#ifndef INCLUDE_RV_TIMEREPORT_H_
+#define INCLUDE_RV_TIMEREPORT_H_
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <llvm/ADT/StringMap.h>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/Timer.h>
+
+namespace llvm {
+  class Function;
+  class raw_ostream;
+}
+
+namespace rv {
+
+class Region;
+
+// accumulated cost of one vectorizer phase (VectorizationAnalysis, MaskGenerator, ..)
+struct PhaseRecord {
+  std::string name;
+  unsigned numRuns;
+  double wallTime;  // seconds
+  double userTime;  // seconds
+  int64_t memGrowth; // bytes still allocated when the phase ends (summed over all runs)
+  int64_t peakMemUsed; // highest heap usage sampled at the phase boundaries
+
+  PhaseRecord(llvm::StringRef _name)
+  : name(_name.str()), numRuns(0), wallTime(0.0), userTime(0.0), memGrowth(0), peakMemUsed(0)
+  {}
+};
+
+// size of a function when it was analyzed
+struct FunctionRecord {
+  std::string name;
+  unsigned numBlocks;
+  unsigned numInstructions;
+  unsigned numRegionBlocks;       // equals numBlocks for whole-function vectorization
+  unsigned numRegionInstructions;
+};
+
+/*
+ * Compile time statistics of the vectorizer.
+ *
+ * Attach a TimeReport to a VectorizerInterface (setTimeReport) to time its phases.
+ * Every phase has an llvm::Timer in the "Region Vectorizer" TimerGroup (printed with the usual LLVM
+ * timing table when the report is destroyed) and a PhaseRecord with the same data for
+ * programmatic access. Heap usage is sampled at the start and the end of each phase
+ * (llvm::TimeRecord::getMemUsed), so peak usage inside a phase is not visible.
+ */
+class TimeReport {
+  llvm::TimerGroup timerGroup;
+
+  std::vector<PhaseRecord> phases; // in order of their first run
+  std::vector<std::unique_ptr<llvm::Timer>> timers;
+  llvm::StringMap<unsigned> phaseIndex;
+
+  std::vector<FunctionRecord> functions;
+  std::map<std::string, uint64_t> counters;
+
+  // the phase that is running
+  int activePhase;
+  llvm::TimeRecord startTime;
+
+public:
+  TimeReport();
+
+  // time the phase @name until stopPhase is called. phases must not overlap
+  void startPhase(llvm::StringRef name);
+  void stopPhase();
+
+  void recordFunction(const llvm::Function & func, const Region * region);
+  void addCounter(llvm::StringRef name, uint64_t inc = 1);
+
+  const std::vector<PhaseRecord> & getPhases() const { return phases; }
+  const std::vector<FunctionRecord> & getFunctions() const { return functions; }
+  const std::map<std::string, uint64_t> & getCounters() const { return counters; }
+  const PhaseRecord * getPhase(llvm::StringRef name) const;
+
+  void printJSON(llvm::raw_ostream & out) const;
+  void print(llvm::raw_ostream & out) const;
+};
+
+// times one phase of @report for the life time of this object (does nothing if @report is nullptr)
+class PhaseTimer {
+  TimeReport * report;
+
+public:
+  PhaseTimer(TimeReport * _report, llvm::StringRef name)
+  : report(_report)
+  {
+    if (report) report->startPhase(name);
+  }
+
+  ~PhaseTimer() {
+    if (report) report->stopPhase();
+  }
+};
+
+}
+
+#endif /* INCLUDE_RV_TIMEREPORT_H_ */
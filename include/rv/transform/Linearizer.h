@@ -361,8 +361,27 @@ namespace rv {
 
   // re-establish SSA form by inserting phis + undef
     void fixSSA();
+
+  // branch-on-superword-condition-code (BOSCC) fast paths
+    // chains of predicated blocks with a higher estimated cost get guarded (0 disables BOSCC)
+    uint bosccThreshold;
+
+    // estimated cost of executing @block under a mask
+    uint getBlockCost(const llvm::BasicBlock & block) const;
+
+    // collect the chain of straight-line blocks starting at @head that all execute under the predicate of @head
+    // @return false if @head does not start a chain that can be guarded
+    bool collectPredicatedChain(llvm::BasicBlock & head, std::vector<llvm::BasicBlock*> & oChain);
+
+    // skip @chain with a rv_any branch if no lane is active
+    // if @unmaskedClone, also branch to an unpredicated copy of @chain with a rv_all branch
+    void insertBOSCCGuard(std::vector<llvm::BasicBlock*> & chain, bool unmaskedClone);
+
+    // guard all costly predicated chains in the linearized region
+    void insertBOSCC();
+
   public:
-    Linearizer(VectorizationInfo & _vecInfo, MaskAnalysis & _maskAnalysis, llvm::DominatorTree & _dt, llvm::LoopInfo & _li)
+    Linearizer(VectorizationInfo & _vecInfo, MaskAnalysis & _maskAnalysis, llvm::DominatorTree & _dt, llvm::LoopInfo & _li, uint _bosccThreshold = 0)
     : vecInfo(_vecInfo)
     , maskAnalysis(_maskAnalysis)
     , region(vecInfo.getRegion())
@@ -370,6 +389,7 @@ namespace rv {
     , li(_li)
     , func(vecInfo.getScalarFunction()) // TODO really always our target?
     , context(func.getContext())
+    , bosccThreshold(_bosccThreshold)
     {}
 
     void run();
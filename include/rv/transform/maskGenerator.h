@@ -9,7 +9,11 @@
 #ifndef _MASKGENERATOR_H
 #define	_MASKGENERATOR_H
 
+#include <map>
+#include <tuple>
+
 #include <llvm/Pass.h>
+#include <llvm/IR/Dominators.h>
 
 #include "rv/analysis/maskAnalysis.h"
 
@@ -37,6 +41,20 @@ private:
     Value * mConstBoolTrue;
     Value * mConstBoolFalse;
 
+    // structurally identical mask operations are only created once (hash-consing).
+    // key: opcode and operands (ordered for commutative operations)
+    typedef std::tuple<unsigned, Value*, Value*, Value*> MaskOpKey;
+    std::map<MaskOpKey, SmallVector<Instruction*, 2>> mMaskOps;
+    DominatorTree mDomTree;
+
+    Instruction* findMaskOp(const MaskOpKey& key, Instruction* insertPoint);
+    void addMaskOp(const MaskOpKey& key, Instruction& maskOp);
+
+    // constant folding, complement and absorption laws.
+    // returns an existing value equivalent to the operation or nullptr.
+    Value* simplifyAnd(Value* operand0, Value* operand1);
+    Value* simplifyOr (Value* operand0, Value* operand1);
+
     void markMaskOperation(Instruction& maskOp);
     void materializeMasks(Function& f);
     bool entryMaskIsUsed(const BasicBlock& block) const;
@@ -14,7 +14,6 @@
 #include <llvm/ADT/Twine.h>
 #include <llvm/Support/raw_ostream.h>
 
-#include <memory> // shared_ptr, weak_ptr
 
 namespace llvm {
 class Value;
@@ -46,29 +45,23 @@ enum NodeType
     REFERENCE
 };
 
-// Use shared_ptr for Mask objects that can
-// directly be deleted via MaskAnalysis::mMaskMap.
-// Use weak_ptr for operands to cope with cycles.
-// This means that when deleting the object,
-// the operands may already have been deleted,
-// but in that case the operand is set to
-// nullptr.
+// Mask nodes are allocated from the arena of the MaskAnalysis that
+// created them and live as long as the analysis (the graph may be cyclic).
+// mID is the index of the node in MaskAnalysis::mMasks.
 struct Mask;
-typedef std::shared_ptr<Mask> MaskPtr;
-typedef std::weak_ptr<Mask>   MaskWeakPtr;
+typedef Mask* MaskPtr;
 
 struct Mask
 {
     const unsigned              mID;
     const NodeType              mType;
-    SmallVector<MaskWeakPtr, 2> mOperands;
+    SmallVector<MaskPtr, 2>     mOperands;
     SmallVector<BasicBlock*, 2> mIncomingDirs;
     Value*                      mValue;
     Instruction*                mInsertPoint;
     std::string                 mName = "";
 
-    Mask(const NodeType type, Instruction* insertPoint);
-    ~Mask();
+    Mask(const unsigned id, const NodeType type, Instruction* insertPoint);
     bool operator==(const Mask& other) const;
     void print(raw_ostream& o) const;
 };
@@ -80,7 +73,6 @@ struct BlockMaskInfo
     MaskPtr                 mEntryMask;
     SmallVector<MaskPtr, 2> mExitMasks;
 
-    ~BlockMaskInfo();
     void print(raw_ostream& o) const;
 };
 
@@ -90,7 +82,6 @@ struct LoopMaskInfo
     MaskPtr     mMaskPhi;
     MaskPtr     mCombinedLoopExitMask;
 
-    ~LoopMaskInfo();
     void print(raw_ostream& o) const;
 };
 
@@ -120,7 +111,6 @@ struct LoopExitMaskInfo
 	// NOTE: This also includes the innermost loop.
 	LoopMaskMapType mMaskPhiMap;
 
-    ~LoopExitMaskInfo();
     void print(raw_ostream& o) const;
 };
 
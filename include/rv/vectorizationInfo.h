@@ -23,6 +23,10 @@ using namespace llvm;
 
 #include "vectorShape.h"
 #include "vectorMapping.h"
+#include "shapeMap.h"
+#include "loweringStatistics.h"
+
+#include <llvm/ADT/SmallPtrSet.h>
 
 #include <unordered_map>
 #include <set>
@@ -37,18 +41,24 @@ class VectorizationInfo
 {
     VectorMapping mapping;
     std::unordered_map<const BasicBlock*, WeakVH> predicates;
-    std::unordered_map<const Value*, VectorShape> shapes;
+    ShapeMap shapes;
 
     std::set<const Loop*> mDivergentLoops;
 
-    std::set<const BasicBlock*> ABABlocks;
-    std::set<const BasicBlock*> ABAONBlocks;
-    std::set<const BasicBlock*> NotABABlocks;
+    // block attributes over a numbering of the blocks
+    ValueIndex blockIndex;
+    BlockFlags ABABlocks;
+    BlockFlags ABAONBlocks;
+    BlockFlags NotABABlocks;
 
-    std::set<const BasicBlock*> MandatoryBlocks;
+    BlockFlags MandatoryBlocks;
 
     Region* region;
-    std::set<const Instruction*> MetadataMaskInsts;
+    llvm::SmallPtrSet<const Instruction*, 8> MetadataMaskInsts;
+
+    LoweringStatistics loweringStats;
+
+    void numberBlocks(const llvm::Function & fn);
 
 public:
     bool inRegion(const llvm::Instruction & inst) const;
@@ -76,6 +86,8 @@ public:
     VectorShape getVectorShape(const Value& val) const;
     void setVectorShape(const Value& val, VectorShape shape);
     void dropVectorShape(const Value& val);
+    // replace all vector shapes with @newShapes
+    void setVectorShapes(ShapeMap && newShapes);
 
     // return the predicate value for this instruction
     Value* getPredicate(const BasicBlock& block) const;
@@ -107,6 +119,10 @@ public:
     void markMandatory(const BasicBlock* block);
     void markMetadataMask(const Instruction* inst);
 
+    // how the instructions of the function were lowered (filled during code generation)
+    LoweringStatistics & getLoweringStatistics() { return loweringStats; }
+    const LoweringStatistics & getLoweringStatistics() const { return loweringStats; }
+
     LLVMContext & getContext() const;
     Function & getScalarFunction() { return *mapping.scalarFn; }
     Function & getVectorFunction() { return *mapping.vectorFn; }
@@ -7,17 +7,25 @@
 
 #include "utils/rvTools.h"
 
+#include <llvm/IR/DerivedTypes.h>
+#include <llvm/IR/Module.h>
+
 #include "rvConfig.h"
 
 namespace rv {
 
   PlatformInfo::PlatformInfo(Module & _mod, TargetTransformInfo *TTI, TargetLibraryInfo *TLI) : mod(_mod), mTTI(TTI), mTLI(TLI), avx2Mod(0),
-                                                                                 avxMod(0), sseMod(0) {}
+                                                                                 avxMod(0), sseMod(0) {
+    addVectorABIMappings();
+  }
 
   PlatformInfo::~PlatformInfo() {
     for (auto it : funcMappings) {
       delete it.second;
     }
+    for (auto & it : simdVariants) {
+      for (auto & variant : it.second) delete variant.mapping;
+    }
   }
 
   void PlatformInfo::addMapping(const Function *function, const rv::VectorMapping *mapping) {
@@ -144,6 +152,15 @@ PlatformInfo::addSIMDMapping(const Function& scalarFunction,
     return true;
 }
 
+// number of scalar instances packed into @simdTy
+static unsigned
+GetImpliedWidth(Type & scalarTy, Type & simdTy) {
+  if (!simdTy.isVectorTy()) return 0;
+  unsigned simdElems = simdTy.getVectorNumElements();
+  unsigned scalarElems = scalarTy.isVectorTy() ? scalarTy.getVectorNumElements() : 1;
+  return simdElems / scalarElems;
+}
+
 VectorMapping*
 PlatformInfo::inferMapping(llvm::Function & scalarFnc, llvm::Function & simdFnc, int maskPos) {
 
@@ -199,11 +216,29 @@ PlatformInfo::inferMapping(llvm::Function & scalarFnc, llvm::Function & simdFnc,
 	assert(itScalarArg == scalarArgList.end());
 	assert(itSimdArg == simdArgList.end());
 
-        int vecWidth = 0; // FIXME
+	// the vector width is implied by the vector types that replace varying scalar types
+	unsigned vecWidth = 0;
+	if (resultShape.isVarying()) {
+		vecWidth = GetImpliedWidth(*scalarRetTy, *simdRetTy);
+	}
+	itScalarArg = scalarArgList.begin();
+	itSimdArg = simdArgList.begin();
+	for (uint i = 0; vecWidth == 0 && i < simdArgList.size(); ++i, ++itSimdArg) {
+		if (maskPos >= 0 && (i == (uint) maskPos)) {
+			if (itSimdArg->getType()->isVectorTy()) vecWidth = itSimdArg->getType()->getVectorNumElements();
+			continue;
+		}
+		if (itScalarArg == scalarArgList.end()) continue;
+		if (argShapes[i].isVarying()) {
+			vecWidth = GetImpliedWidth(*itScalarArg->getType(), *itSimdArg->getType());
+		}
+		++itScalarArg;
+	}
+
 	return new rv::VectorMapping(
 				&scalarFnc,
 				&simdFnc,
-				vecWidth, // if all arguments have shapes this function is suitable for all possible widths
+				vecWidth, // if all arguments are uniform this function is suitable for all possible widths
 				maskPos,
 				resultShape,
 				argShapes
@@ -212,4 +247,270 @@ PlatformInfo::inferMapping(llvm::Function & scalarFnc, llvm::Function & simdFnc,
 
 
 
+// x86 vector function ABI
+//   _ZGV <isa> <mask> <vlen> <parameters> _ <scalar name>
+// isa:        b (SSE), c (AVX), d (AVX2), e (AVX-512)
+// mask:       N (unmasked), M (masked, the mask is passed as an additional last argument)
+// parameters: v (varying), u (uniform), l[n]<step> (linear with a constant step), each optionally followed by a<align>
+// consume the decimal number at the start of @text
+static bool
+ConsumeNumber(StringRef & text, unsigned & number) {
+  size_t numDigits = text.find_first_not_of("0123456789");
+  if (numDigits == StringRef::npos) numDigits = text.size();
+  if (numDigits == 0) return false;
+  if (text.substr(0, numDigits).getAsInteger(10, number)) return false;
+  text = text.drop_front(numDigits);
+  return true;
+}
+
+static bool
+ParseVectorABIName(StringRef mangledName, char & isa, unsigned & vectorWidth, bool & isMasked, VectorShapeVec & argShapes, StringRef & scalarName) {
+  StringRef text = mangledName;
+  if (!text.startswith("_ZGV") || text.size() < 7) return false;
+  text = text.drop_front(4);
+
+  isa = text[0];
+  if (isa != 'b' && isa != 'c' && isa != 'd' && isa != 'e') return false;
+  text = text.drop_front(1);
+
+  if (text[0] != 'N' && text[0] != 'M') return false;
+  isMasked = text[0] == 'M';
+  text = text.drop_front(1);
+
+  if (!ConsumeNumber(text, vectorWidth) || vectorWidth == 0) return false;
+
+  argShapes.clear();
+  while (!text.empty() && text[0] != '_') {
+    char kind = text[0];
+    text = text.drop_front(1);
+
+    VectorShape shape;
+    if (kind == 'v') {
+      shape = VectorShape::varying();
+    } else if (kind == 'u') {
+      shape = VectorShape::uni();
+    } else if (kind == 'l') {
+      bool negative = text.startswith("n");
+      if (negative) text = text.drop_front(1);
+      unsigned step = 1;
+      ConsumeNumber(text, step); // l without a number: step 1
+      shape = VectorShape::strided(negative ? -(int) step : (int) step);
+    } else {
+      // variable strides (ls) and reference parameters (R, L, U) do not map to a vector shape
+      return false;
+    }
+
+    if (text.startswith("a")) {
+      text = text.drop_front(1);
+      unsigned alignment;
+      if (!ConsumeNumber(text, alignment)) return false;
+      shape.setAlignment(alignment);
+    }
+
+    argShapes.push_back(shape);
+  }
+
+  if (text.size() < 2) return false;
+  scalarName = text.drop_front(1);
+  return true;
+}
+
+bool
+PlatformInfo::addVectorABIVariant(Function & scalarFnc, Function * simdFnc, StringRef mangledName, StringRef simdName) {
+  char isa;
+  unsigned vectorWidth;
+  bool isMasked;
+  VectorShapeVec argShapes;
+  StringRef scalarName;
+  if (!ParseVectorABIName(mangledName, isa, vectorWidth, isMasked, argShapes, scalarName)) return false;
+  if (scalarName != scalarFnc.getName()) return false;
+
+  auto * scalarFnTy = scalarFnc.getFunctionType();
+  if (scalarFnTy->isVarArg() || argShapes.size() != scalarFnTy->getNumParams()) return false;
+
+  // expected signature of the variant
+  Type * scalarRetTy = scalarFnTy->getReturnType();
+  Type * simdRetTy = scalarRetTy->isVoidTy() ? scalarRetTy : VectorType::get(scalarRetTy, vectorWidth);
+
+  std::vector<Type*> simdParamTys;
+  for (uint i = 0; i < argShapes.size(); ++i) {
+    Type * paramTy = scalarFnTy->getParamType(i);
+    simdParamTys.push_back(argShapes[i].isVarying() ? VectorType::get(paramTy, vectorWidth) : paramTy);
+  }
+
+  if (isMasked) {
+    // the mask is a vector of integers as wide as the characteristic data type
+    Type * charTy = !scalarRetTy->isVoidTy() ? scalarRetTy
+                  : (scalarFnTy->getNumParams() > 0 ? scalarFnTy->getParamType(0) : Type::getInt32Ty(getContext()));
+    unsigned charBits = charTy->isPointerTy() ? getDataLayout().getPointerSizeInBits() : charTy->getPrimitiveSizeInBits();
+    if (charBits == 0) charBits = 32;
+    simdParamTys.push_back(VectorType::get(Type::getIntNTy(getContext(), charBits), vectorWidth));
+  }
+
+  // the declared variant has to match the mangling
+  auto * simdFnTy = simdFnc ? simdFnc->getFunctionType() : FunctionType::get(simdRetTy, simdParamTys, false);
+  if (simdFnTy->getReturnType() != simdRetTy) return false;
+  if (simdFnTy->getNumParams() != simdParamTys.size()) return false;
+  for (uint i = 0; i < simdParamTys.size(); ++i) {
+    Type * paramTy = simdFnTy->getParamType(i);
+    if (isMasked && i + 1 == simdParamTys.size()) {
+      // accept any kind of mask vector of the right width
+      if (!paramTy->isVectorTy() || paramTy->getVectorNumElements() != vectorWidth) return false;
+    } else if (paramTy != simdParamTys[i]) {
+      return false;
+    }
+  }
+
+  int maskPos = isMasked ? (int) argShapes.size() : -1;
+  if (isMasked) argShapes.push_back(VectorShape::varying());
+  VectorShape resultShape = scalarRetTy->isVoidTy() ? VectorShape::uni() : VectorShape::varying();
+
+  IF_DEBUG { errs() << "rv: vector function ABI variant " << simdName << " of " << scalarFnc.getName() << "\n"; }
+  auto * mapping = new VectorMapping(&scalarFnc, simdFnc, vectorWidth, maskPos, resultShape, argShapes);
+  simdVariants[&scalarFnc].push_back(SIMDVariant{mapping, isa, simdName.str(), simdFnTy});
+  return true;
+}
+
+bool
+PlatformInfo::hasTargetFeature(const Function & fn, StringRef feature) {
+  if (!fn.hasFnAttribute("target-features")) return false;
+  return fn.getFnAttribute("target-features").getValueAsString().count(feature) > 0;
+}
+
+bool
+PlatformInfo::hasAVX512(const Function & fn) const {
+  if (mTTI && mTTI->getRegisterBitWidth(true) >= 512) return true;
+
+  // TTI without a target machine: look at the features the function was compiled for
+  return hasTargetFeature(fn, "+avx512f");
+}
+
+bool
+PlatformInfo::hasTargetTTI() const {
+  return mTTI && mTTI->getRegisterBitWidth(true) > 32;
+}
+
+bool
+PlatformInfo::isLegalMaskedMemory(const Function & fn, Type * vecType, bool isLoad) const {
+  if (hasTargetTTI()) return isLoad ? mTTI->isLegalMaskedLoad(vecType) : mTTI->isLegalMaskedStore(vecType);
+
+  // TTI without a target machine (always false): masked moves need AVX ('+avx' is a prefix of '+avx2' and '+avx512f')
+  if (fn.hasFnAttribute("target-features")) return hasTargetFeature(fn, "+avx");
+  return true;
+}
+
+bool
+PlatformInfo::supportsVectorABIISA(const Function & targetFn, char isa) const {
+  const char * feature = nullptr;
+  unsigned regBits = 0;
+  switch (isa) {
+    case 'b': feature = "+sse2"; regBits = 128; break;
+    case 'c': feature = "+avx"; regBits = 256; break;
+    case 'd': feature = "+avx2"; regBits = 256; break;
+    case 'e': feature = "+avx512f"; regBits = 512; break;
+    default: return false;
+  }
+
+  if (targetFn.hasFnAttribute("target-features")) return hasTargetFeature(targetFn, feature);
+  // no features on the function: the vector registers of the target have to be wide enough
+  return !mTTI || mTTI->getRegisterBitWidth(true) >= regBits;
+}
+
+void
+PlatformInfo::addVectorABIMappings() {
+  std::vector<Function*> functions;
+  for (auto & func : mod) functions.push_back(&func);
+
+  for (auto * func : functions) {
+    // SIMD definitions/declarations in the module
+    StringRef name = func->getName();
+    if (name.startswith("_ZGV")) {
+      char isa;
+      unsigned vectorWidth;
+      bool isMasked;
+      VectorShapeVec argShapes;
+      StringRef scalarName;
+      if (!ParseVectorABIName(name, isa, vectorWidth, isMasked, argShapes, scalarName)) continue;
+
+      auto * scalarFnc = mod.getFunction(scalarName);
+      if (!scalarFnc) continue;
+      addVectorABIVariant(*scalarFnc, func, name, name);
+      continue;
+    }
+
+    // "vector-variants"="_ZGVbN4v_foo,_ZGVbM4v_foo(foo_masked)"
+    if (!func->hasFnAttribute("vector-variants")) continue;
+    SmallVector<StringRef, 4> variants;
+    func->getFnAttribute("vector-variants").getValueAsString().split(variants, ",", -1, false);
+
+    for (StringRef variant : variants) {
+      variant = variant.trim();
+      StringRef mangledName = variant;
+      StringRef simdName = variant;
+
+      // custom name of the SIMD function in parentheses
+      size_t openPos = variant.find('(');
+      if (openPos != StringRef::npos && variant.endswith(")")) {
+        mangledName = variant.substr(0, openPos);
+        simdName = variant.slice(openPos + 1, variant.size() - 1);
+      }
+
+      // variants that are also present under their mangled name were registered above
+      if (simdName == mangledName && mod.getFunction(mangledName)) continue;
+
+      addVectorABIVariant(*func, mod.getFunction(simdName), mangledName, simdName);
+    }
+  }
+}
+
+const VectorMapping *
+PlatformInfo::getSIMDVariant(const Function & scalarFn, unsigned vectorWidth, const VectorShapeVec & argShapes, bool predicated,
+                             const Function & targetFn) {
+  auto it = simdVariants.find(&scalarFn);
+  if (it == simdVariants.end()) return nullptr;
+
+  SIMDVariant * best = nullptr;
+  int bestScore = -1;
+  for (auto & variant : it->second) {
+    const auto * mapping = variant.mapping;
+    if (mapping->vectorWidth != vectorWidth) continue;
+    if (!supportsVectorABIISA(targetFn, variant.isa)) continue;
+
+    // every argument has to be at least as regular as the variant expects
+    bool compatible = true;
+    int score = 0;
+    for (uint i = 0; compatible && i < argShapes.size(); ++i) {
+      const VectorShape & expected = mapping->argShapes[i];
+      const VectorShape & actual = argShapes[i];
+      if (expected.isVarying()) continue;
+
+      compatible = actual.hasStridedShape() &&
+                   actual.getStride() == expected.getStride() &&
+                   actual.getAlignmentFirst() % expected.getAlignmentFirst() == 0;
+      ++score; // scalar arguments are cheaper than vectors
+    }
+    if (!compatible) continue;
+
+    // prefer the masked variant for predicated calls
+    bool isMasked = mapping->maskPos >= 0;
+    if (isMasked == predicated) score += (int) argShapes.size() + 1;
+
+    if (score > bestScore) {
+      best = &variant;
+      bestScore = score;
+    }
+  }
+  if (!best) return nullptr;
+
+  // declare the variant when it is used for the first time
+  auto * mapping = best->mapping;
+  if (!mapping->vectorFn) {
+    mapping->vectorFn = mod.getFunction(best->simdName);
+    if (!mapping->vectorFn) {
+      mapping->vectorFn = Function::Create(best->simdFnTy, GlobalValue::ExternalLinkage, best->simdName, &mod);
+    }
+  }
+  return mapping;
+}
+
 }
@@ -33,50 +33,6 @@ namespace rv {
 
 ConstBlockSet BranchDependenceAnalysis::emptySet;
 
-inline
-void
-IntersectInPlace(ConstBlockSet & x, const ConstBlockSet & y) {
-  for (auto a : x) {
-    if (!y.count(a)) x.erase(a);
-  }
-}
-
-inline
-ConstBlockSet
-Intersect(const ConstBlockSet & x, const ConstBlockSet & y) {
-  ConstBlockSet res;
-  for (auto a : x) {
-    if (y.count(a)) res.insert(a);
-  }
-  for (auto b : y) {
-    if (x.count(b)) res.insert(b);
-  }
-  return res;
-}
-
-inline
-void MergeIn(ConstBlockSet & m, ConstBlockSet & other) {
-  for (auto b : other) m.insert(b);
-}
-
-inline
-void
-IntersectAndMerge(ConstBlockSet & accu, const ConstBlockSet & a, const ConstBlockSet & b) {
-  for (auto x : a) {
-    if (b.count(x)) {
-      accu.insert(x);
-    }
-  }
-}
-
-inline
-void
-Subtract(ConstBlockSet & a, const ConstBlockSet & b) {
-  for (auto y : b) {
-    a.erase(y);
-  }
-}
-
 inline
 void
 DumpSet(const ConstBlockSet & blocks) {
@@ -97,8 +53,12 @@ GetDomRegion(DomTreeNodeBase<BasicBlock> & domNode, ConstBlockSet & domRegion) {
 }
 
 BranchDependenceAnalysis::BranchDependenceAnalysis(llvm::Function & F, const CDG & _cdg, const DFG & _dfg, const DominatorTree & _domTree, const PostDominatorTree & _postDomTree, const LoopInfo & _loopInfo)
-: pdClosureMap()
-, domClosureMap()
+: blocks()
+, blockIndex()
+, pdClosures()
+, domClosures()
+, hasPdClosure()
+, hasDomClosure()
 , effectedBlocks()
 , cdg(_cdg)
 , dfg(_dfg)
@@ -106,241 +66,202 @@ BranchDependenceAnalysis::BranchDependenceAnalysis(llvm::Function & F, const CDG
 , postDomTree(_postDomTree)
 , loopInfo(_loopInfo)
 {
-
-  IF_DEBUG_BDA errs() << "-- frontiers --\n";
+  // number the blocks. closures and effected blocks are computed when a branch is queried
   for (auto & block : F) {
+    blockIndex[&block] = blocks.size();
+    blocks.push_back(&block);
+  }
 
-    ConstBlockSet pdClosure, domClosure;
-    computePostDomClosure(block, pdClosure);
-    computeDomClosure(block, domClosure);
+  pdClosures.resize(blocks.size());
+  domClosures.resize(blocks.size());
+  hasPdClosure.resize(blocks.size());
+  hasDomClosure.resize(blocks.size());
+}
 
-    domClosure.insert(&block);
-    pdClosure.insert(&block);
+unsigned
+BranchDependenceAnalysis::getIndex(const BasicBlock & block) const {
+  auto it = blockIndex.find(&block);
+  assert(it != blockIndex.end() && "block not in function");
+  return it->second;
+}
 
-    IF_DEBUG_BDA {
-      errs() << block.getName() << " :\n\t DFG: ";
-      DumpSet(domClosure);
-      errs() << "\n\t PDF: ";
-      DumpSet(pdClosure);
-      errs() << "\n";
+/// \brief computes the iterated control dependence relation for @x (including @x)
+const BitVector &
+BranchDependenceAnalysis::getPostDomClosure(const BasicBlock & x) {
+  unsigned xIdx = getIndex(x);
+  BitVector & closure = pdClosures[xIdx];
+  if (hasPdClosure.test(xIdx)) return closure;
+
+  closure.resize(blocks.size());
+  closure.set(xIdx);
+
+  std::vector<const BasicBlock*> stack;
+  stack.push_back(&x);
+  while (!stack.empty()) {
+    const auto * block = stack.back();
+    stack.pop_back();
+
+    auto * cdNode = cdg[block];
+    if (!cdNode) continue;
+
+    for (auto cd_pred : cdNode->preds()) {
+      const auto * cdBlock = cd_pred->getBB();
+      unsigned cdIdx = getIndex(*cdBlock);
+      if (closure.test(cdIdx)) continue;
+
+      if (hasPdClosure.test(cdIdx)) {
+        // the closure of @cdBlock is complete and contained in ours
+        closure |= pdClosures[cdIdx];
+      } else {
+        closure.set(cdIdx);
+        stack.push_back(cdBlock);
+      }
     }
-
-    pdClosureMap[&block] = pdClosure;
-    domClosureMap[&block] = domClosure;
   }
 
-#if 0 //  PDA divergence criterion
-  for (auto & block : F) {
-    const CDNode* cd_node = cdg[&block];
-    if (!cd_node) continue;
-    // Iterate over the predeccessors in the dfg, of the successors in the cdg
-    for (const CDNode* cd_succ : cd_node->succs()) {
-      const DFNode* df_node = dfg[cd_succ->getBB()];
-      for (const DFNode* df_pred : df_node->preds()) {
-        // Get the block BB that is affected by the varying branch
-        const BasicBlock* const BB = df_pred->getBB();
-        effectedBlocks[block.getTerminator()].insert(BB);
+  hasPdClosure.set(xIdx);
+  return closure;
+}
+
+/// \brief computes the iterated dominance frontier of @b (including @b)
+const BitVector &
+BranchDependenceAnalysis::getDomClosure(const BasicBlock & b) {
+  unsigned bIdx = getIndex(b);
+  BitVector & closure = domClosures[bIdx];
+  if (hasDomClosure.test(bIdx)) return closure;
+
+  closure.resize(blocks.size());
+  closure.set(bIdx);
+
+  std::vector<const BasicBlock*> stack;
+  stack.push_back(&b);
+  while (!stack.empty()) {
+    const auto * block = stack.back();
+    stack.pop_back();
+
+    auto * dfNode = dfg[block];
+    if (!dfNode) continue;
+
+    for (auto df_pred : dfNode->preds()) {
+      const auto * dfBlock = df_pred->getBB();
+      unsigned dfIdx = getIndex(*dfBlock);
+      if (closure.test(dfIdx)) continue;
+
+      if (hasDomClosure.test(dfIdx)) {
+        closure |= domClosures[dfIdx];
+      } else {
+        closure.set(dfIdx);
+        stack.push_back(dfBlock);
       }
     }
   }
-#endif
 
-  IF_DEBUG_BDA {
-    errs() << "-- branch dependence analysis --\n";
-    F.dump();
+  hasDomClosure.set(bIdx);
+  return closure;
+}
+
+bool
+BranchDependenceAnalysis::isDivergentJoin(const BasicBlock & brBlock, const BasicBlock & z) {
+  unsigned zIdx = getIndex(z);
+
+  // for all (disjoint) pairs of leaving edges
+  for (auto itSucc = succ_begin(&brBlock), itEndSucc = succ_end(&brBlock); itSucc != itEndSucc; ++itSucc) {
+    auto * b = *itSucc;
+    if (!getDomClosure(*b).test(zIdx)) continue;
+
+    for (auto itOtherSucc = succ_begin(&brBlock); itOtherSucc != itSucc; ++itOtherSucc) {
+      auto * c = *itOtherSucc;
+      if (b == c) continue; // multi exits to the same target (switches)
+
+      if (getDomClosure(*c).test(zIdx)) return true;
+    }
   }
 
-  // maps phi blocks to divergence causing branches
-  DenseMap<const BasicBlock*, ConstBlockSet> inverseMap;
-// compute cd* for all blocks
+  return false;
+}
 
+void
+BranchDependenceAnalysis::computeEffectedBlocks(const BasicBlock & brBlock, ConstBlockSet & phiBlocks) {
+  unsigned brIdx = getIndex(brBlock);
+
+  // candidate join points: the successors of the branch and the blocks in the dominance frontier closures of two successors
+  BitVector candidates(blocks.size());
+  for (auto itSucc = succ_begin(&brBlock), itEndSucc = succ_end(&brBlock); itSucc != itEndSucc; ++itSucc) {
+    auto * b = *itSucc;
+    candidates.set(getIndex(*b));
+
+    for (auto itOtherSucc = succ_begin(&brBlock); itOtherSucc != itSucc; ++itOtherSucc) {
+      auto * c = *itOtherSucc;
+      if (b == c) continue;
+
+      BitVector bcDomClosure = getDomClosure(*b);
+      bcDomClosure &= getDomClosure(*c);
+      candidates |= bcDomClosure;
+    }
+  }
 
-  IF_DEBUG_BDA errs() << "-- branch dependence --\n";
-  for (auto & z : F) {
-    ConstBlockSet branchBlocks;
+  IF_DEBUG_BDA errs() << "-- branch dependence of " << brBlock.getName() << " --\n";
+  for (int zIdx = candidates.find_first(); zIdx != -1; zIdx = candidates.find_next(zIdx)) {
+    const auto & z = *blocks[zIdx];
+    bool effected = false;
 
-    for (auto itPred = pred_begin(&z), itEnd = pred_end(&z); itPred != itEnd; ++itPred) {
+    for (auto itPred = pred_begin(&z), itEnd = pred_end(&z); !effected && itPred != itEnd; ++itPred) {
       auto * x = *itPred;
-      auto xClosure = pdClosureMap[x];
+      const auto & xClosure = getPostDomClosure(*x);
 
-      for (auto itOtherPred = pred_begin(&z); itOtherPred != itPred; ++itOtherPred) {
+      for (auto itOtherPred = pred_begin(&z); !effected && itOtherPred != itPred; ++itOtherPred) {
         auto * y = *itOtherPred;
-        auto yClosure = pdClosureMap[y];
+        const auto & yClosure = getPostDomClosure(*y);
 
         IF_DEBUG_BDA { errs() << "z = " << z.getName() << " with x = " << x->getName() << " , y = " << y->getName() << "\n"; }
 
         // early exit on: x reaches y or y reaches x
-        if (yClosure.count(x)) {
+        if (yClosure.test(getIndex(*x))) {
           // x is in the PDF of y
-          bool added = branchBlocks.insert(x).second;
-          IF_DEBUG_BDA { if (added) errs() << "\tx reaches y: add " << x->getName() << "\n"; }
-        } else if (xClosure.count(y)) {
+          effected = x == &brBlock;
+        } else if (xClosure.test(getIndex(*y))) {
           // y is in the PDF of x
-          bool added = branchBlocks.insert(y).second;
-          IF_DEBUG_BDA { if (added) errs() << "\ty reaches x: add " << y->getName() << "\n"; }
+          effected = y == &brBlock;
         }
 
-        // intersection (set of binary branches that are reachable from both x and y)
-        auto xyPostDomClosure = Intersect(yClosure, xClosure);
-
-        // iterate over list of candidates
-        for (auto * brBlock : xyPostDomClosure) {
-          if (branchBlocks.count(brBlock)) continue; // already added by early exit
-
-          IF_DEBUG_BDA errs() << "# disjoint paths from A = " << brBlock->getName() << " to z = " << z.getName() << "\n";
-
-          // check if there can exist a disjoint path
-          bool foundDisjointPath = false;
-
-          // for all (disjoin) pairs of leaving edges
-          for (auto itSucc = succ_begin(brBlock), itEndSucc = succ_end(brBlock); !foundDisjointPath && itSucc != itEndSucc; ++itSucc) {
-            auto * b = *itSucc;
-            auto bClosure = domClosureMap[b];
-
-            for (auto itOtherSucc = succ_begin(brBlock); !foundDisjointPath && itOtherSucc != itSucc; ++itOtherSucc) {
-              auto * c = *itOtherSucc;
-              if (b == c) continue; // multi exits to the same target (switches)
-
-              auto cClosure = domClosureMap[c];
-              auto bcDomClosure = Intersect(bClosure, cClosure);
-
-              if (bClosure.count(&z) && cClosure.count(&z)) {
-                foundDisjointPath = true;
-                break;
-              }
-            }
-          }
-
-          // we found a disjoint path from brBlock to block
-          if (foundDisjointPath) {
-            IF_DEBUG_BDA errs() << "Adding " << brBlock->getName() << "\n";
-            branchBlocks.insert(brBlock);
-          }
+        // the branch is reachable from x and y. check if there can exist a disjoint path from it to z
+        if (!effected && xClosure.test(brIdx) && yClosure.test(brIdx)) {
+          effected = isDivergentJoin(brBlock, z);
         }
       }
     }
 
-    inverseMap[&z] = branchBlocks;
-  }
-  IF_DEBUG_BDA errs () << "-- DONE --\n";
-
-
-  IF_DEBUG_BDA {
-    errs() << "-- Mapping of phi blocks to branches --\n";
-    for (auto it : inverseMap) {
-      errs() << it.first->getName() << " : ";
-      DumpSet(it.second);
-      errs() << "\n";
+    if (effected) {
+      IF_DEBUG_BDA errs() << "Adding " << z.getName() << "\n";
+      phiBlocks.insert(&z);
     }
   }
 
-// taint LCSSA phis on loop exit divergence
-  std::vector<Loop*> loopStack;
-  for (auto * loop : loopInfo) loopStack.push_back(loop);
-
-  while (!loopStack.empty()) {
-    auto * loop = loopStack.back();
-    loopStack.pop_back();
-
-    for (auto * childLoop : *loop) {
-      loopStack.push_back(childLoop);
-    }
-
-    // tain all exit blocks if any exit is divergent
-    SmallVector<Edge, 4> exitEdges;
-    loop->getExitEdges(exitEdges);
-
-    // the loop header encodes the loop divergence
-    // make the loop header dependent on loop exit conditions
-    auto * loopHeader = loop->getHeader();
-    for (auto ee : exitEdges) {
-      inverseMap[loopHeader].insert(ee.first);
+  // taint LCSSA phis on loop exit divergence
+  // the loop header encodes the loop divergence: make it dependent on all exiting branches of the loop
+  for (const Loop * loop = loopInfo.getLoopFor(&brBlock); loop; loop = loop->getParentLoop()) {
+    for (auto itSucc = succ_begin(&brBlock), itEndSucc = succ_end(&brBlock); itSucc != itEndSucc; ++itSucc) {
+      if (loop->contains(*itSucc)) continue;
+      phiBlocks.insert(loop->getHeader());
+      break;
     }
   }
 
-// invert result for look up table
-  for (auto it : inverseMap) {
-    const auto * phiBlock = it.first;
-    for (auto branchBlock : it.second) {
-      auto * term = branchBlock->getTerminator();
-      auto * branch = dyn_cast<BranchInst>(term);
-      if (branch && !branch->isConditional()) continue; // non conditional branch
-      if (!branch && !isa<SwitchInst>(term)) continue; // otw, must be a switch
-
-      IF_DEBUG_BDA { errs() << branchBlock->getName() << " inf -> " << phiBlock->getName() << "\n"; }
-      effectedBlocks[term].insert(phiBlock);
-    }
-  }
-
-// final result dump
-  IF_DEBUG_BDA {
-    errs() << "-- Mapping of br blocks to phi blocks --\n";
-    for (auto it : effectedBlocks) {
-      auto * brBlock = it.first->getParent();
-      auto phiBlocks = it.second;
-      errs() << brBlock->getName() << " : "; DumpSet(phiBlocks); errs() <<"\n";
-    }
-  }
-
-
-
-  // dump PDA output for comparison
-#if 0
-  IF_DEBUG_PDA {
-    errs() << "-- PDA output --\n";
-    for (auto & block : F) {
-      const CDNode* cd_node = cdg[&block];
-      if (!cd_node) continue;
-
-      bool printed = false;
-      // Iterate over the predeccessors in the dfg, of the successors in the cdg
-      ConstBlockSet seen;
-      for (const CDNode* cd_succ : cd_node->succs()) {
-        const DFNode* df_node = dfg[cd_succ->getBB()];
-        for (const DFNode* df_pred : df_node->preds()) {
-          // Get the block BB that is affected by the varying branch
-          const BasicBlock* const BB = df_pred->getBB();
-          if (!seen.insert(BB).second) continue;
-
-
-          if (!printed) errs() << block.getName() << " : ";
-          printed = true;
-
-          errs() << ", " << BB->getName();
-          // assert(effectedBlocks[block.getTerminator()].count(BB) && "missed a PDA block");
-        }
-      }
-      if (printed) errs() << "\n";
-    }
-  }
-#endif
+  IF_DEBUG_BDA { errs() << brBlock.getName() << " : "; DumpSet(phiBlocks); errs() << "\n"; }
 }
 
-/// \brief computes the iterated control dependence relation for @x
-void
-BranchDependenceAnalysis::computePostDomClosure(const BasicBlock & x, ConstBlockSet & closure) {
-  auto * xcd = cdg[&x];
-  if (!xcd) return;
-
-  for (auto cd_succ : xcd->preds()) {
-    auto * cdBlock = cd_succ->getBB();
-    if (closure.insert(cdBlock).second) {
-      computePostDomClosure(*cdBlock, closure);
-    }
-  }
-}
+const ConstBlockSet &
+BranchDependenceAnalysis::getEffectedBlocks(const TerminatorInst & term) {
+  auto it = effectedBlocks.find(&term);
+  if (it != effectedBlocks.end()) return it->second;
 
-void
-BranchDependenceAnalysis::computeDomClosure(const BasicBlock & b, ConstBlockSet & closure) {
-  auto * bdf = dfg[&b];
-  if (!bdf) return;
-
-  for (auto df_pred : bdf->preds()) {
-    auto * dfBlock = df_pred->getBB();
-    if (closure.insert(dfBlock).second) {
-      computeDomClosure(*dfBlock, closure);
-    }
-  }
+  auto * branch = dyn_cast<BranchInst>(&term);
+  if (branch && !branch->isConditional()) return emptySet; // non conditional branch
+  if (!branch && !isa<SwitchInst>(term)) return emptySet; // otw, must be a switch
+
+  auto & phiBlocks = effectedBlocks[&term];
+  computeEffectedBlocks(*term.getParent(), phiBlocks);
+  return phiBlocks;
 }
 
 
@@ -0,0 +1,391 @@
+//===- CostModel.cpp ----------------*- C++ -*-===//
+//
+//                     The Region Vectorizer
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+
+#include "rv/analysis/CostModel.h"
+
+#include "rv/PlatformInfo.h"
+#include "rv/vectorizationInfo.h"
+
+#include <algorithm>
+
+#include <llvm/ADT/SmallPtrSet.h>
+#include <llvm/Analysis/TargetTransformInfo.h>
+#include <llvm/IR/Dominators.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/IntrinsicInst.h>
+#include <llvm/Support/Format.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include "rvConfig.h"
+
+#if 1
+#define IF_DEBUG_CM IF_DEBUG
+#else
+#define IF_DEBUG_CM if (false)
+#endif
+
+using namespace llvm;
+
+namespace rv {
+
+// cost of a call that was not mapped to anything cheaper (TTI has no call costs for unknown functions)
+static const unsigned ScalarCallCost = 10;
+
+void
+WidthEstimate::print(raw_ostream & out) const {
+  out << "width " << vectorWidth
+      << " : cost " << cost << " (" << format("%.2f", getCostPerLane()) << " per lane)"
+      << ", gathers " << numGathers
+      << ", scatters " << numScatters
+      << ", replicated calls " << numReplicatedCalls
+      << ", cascades " << numCascades
+      << ", blends " << numBlends
+      << ", registers " << registerPressure
+      << ", spills " << numSpills;
+}
+
+// TTI of the platform, falls back to the target independent costs of the module
+static TargetTransformInfo &
+RequestTTI(PlatformInfo & platInfo, std::unique_ptr<TargetTransformInfo> & defaultTTI) {
+  if (auto * platTTI = platInfo.getTTI()) return *platTTI;
+  defaultTTI.reset(new TargetTransformInfo(platInfo.getDataLayout()));
+  return *defaultTTI;
+}
+
+CostModel::CostModel(PlatformInfo & _platInfo, VectorizationInfo & _vecInfo, const DominatorTree & _domTree)
+: platInfo(_platInfo)
+, vecInfo(_vecInfo)
+, domTree(_domTree)
+, defaultTTI()
+, tti(RequestTTI(_platInfo, defaultTTI))
+{}
+
+CostModel::~CostModel() {}
+
+bool
+CostModel::isPredicated(const BasicBlock & block) const {
+  return !vecInfo.isAlwaysByAll(&block) && !vecInfo.isAlwaysByAllOrNone(&block);
+}
+
+bool
+CostModel::isBlendBlock(const BasicBlock & block) const {
+  // phis are folded if control reconverges from a varying branch
+  auto * node = domTree.getNode(const_cast<BasicBlock*>(&block));
+  if (!node || !node->getIDom()) return false;
+  auto * idomTerm = node->getIDom()->getBlock()->getTerminator();
+  return vecInfo.hasKnownShape(*idomTerm) && !vecInfo.getVectorShape(*idomTerm).isUniform();
+}
+
+bool
+CostModel::isVectorized(const Instruction & inst) const {
+  if (!vecInfo.hasKnownShape(inst)) return false;
+  auto shape = vecInfo.getVectorShape(inst);
+  if (shape.isUniform()) return false;
+  // contiguous addresses stay scalar base pointers
+  if (inst.getType()->isPointerTy() && !shape.isVarying()) return false;
+  return true;
+}
+
+unsigned
+CostModel::getNumParts(Type & ty, unsigned vectorWidth) const {
+  unsigned regBits = tti.getRegisterBitWidth(true);
+  unsigned elemBits = ty.isPointerTy() ? 64 : ty.getPrimitiveSizeInBits();
+  if (!regBits || !elemBits) return 1;
+  return std::max<unsigned>(1, (elemBits * vectorWidth + regBits - 1) / regBits);
+}
+
+unsigned
+CostModel::getScalarCost(const Instruction & inst) const {
+  auto * ty = inst.getType();
+  unsigned opcode = inst.getOpcode();
+
+  if (inst.isBinaryOp()) return tti.getArithmeticInstrCost(opcode, ty);
+  if (auto * castInst = dyn_cast<CastInst>(&inst)) return tti.getCastInstrCost(opcode, ty, castInst->getSrcTy());
+  if (isa<CmpInst>(inst)) return tti.getCmpSelInstrCost(opcode, inst.getOperand(0)->getType());
+  if (isa<SelectInst>(inst)) return tti.getCmpSelInstrCost(opcode, ty);
+  if (auto * load = dyn_cast<LoadInst>(&inst)) {
+    return tti.getMemoryOpCost(opcode, ty, load->getAlignment(), load->getPointerAddressSpace());
+  }
+  if (auto * store = dyn_cast<StoreInst>(&inst)) {
+    return tti.getMemoryOpCost(opcode, store->getValueOperand()->getType(), store->getAlignment(), store->getPointerAddressSpace());
+  }
+  if (isa<CallInst>(inst)) return ScalarCallCost;
+  if (isa<PHINode>(inst) || isa<TerminatorInst>(inst) || isa<AllocaInst>(inst)) return 0;
+
+  return 1;
+}
+
+unsigned
+CostModel::getReplicatedCost(const Instruction & inst, unsigned vectorWidth) const {
+  unsigned cost = vectorWidth * getScalarCost(inst);
+
+  // extract the varying operands and insert the results
+  auto * resTy = inst.getType();
+  if (!resTy->isVoidTy() && VectorType::isValidElementType(resTy)) {
+    auto * vecTy = VectorType::get(resTy, vectorWidth);
+    for (unsigned i = 0; i < vectorWidth; ++i) {
+      cost += tti.getVectorInstrCost(Instruction::InsertElement, vecTy, i);
+    }
+  }
+
+  for (auto & op : inst.operands()) {
+    if (!vecInfo.hasKnownShape(*op) || !vecInfo.getVectorShape(*op).isVarying()) continue;
+    auto * opTy = op->getType();
+    if (!VectorType::isValidElementType(opTy)) continue;
+    auto * vecTy = VectorType::get(opTy, vectorWidth);
+    for (unsigned i = 0; i < vectorWidth; ++i) {
+      cost += tti.getVectorInstrCost(Instruction::ExtractElement, vecTy, i);
+    }
+  }
+
+  return cost;
+}
+
+unsigned
+CostModel::getMemoryCost(const Instruction & inst, WidthEstimate & estimate) const {
+  const unsigned vectorWidth = estimate.vectorWidth;
+  auto * load = dyn_cast<LoadInst>(&inst);
+  auto * store = dyn_cast<StoreInst>(&inst);
+  assert((load || store) && "not a memory access");
+
+  Value * ptr = load ? load->getPointerOperand() : store->getPointerOperand();
+  Type * accessedTy = load ? load->getType() : store->getValueOperand()->getType();
+  unsigned alignment = load ? load->getAlignment() : store->getAlignment();
+  unsigned addrSpace = load ? load->getPointerAddressSpace() : store->getPointerAddressSpace();
+  unsigned opcode = inst.getOpcode();
+
+  auto addrShape = vecInfo.hasKnownShape(*ptr) ? vecInfo.getVectorShape(*ptr) : VectorShape::varying();
+  bool needsMask = isPredicated(*inst.getParent());
+
+  // uniform access
+  if (addrShape.isUniform()) {
+    return getScalarCost(inst);
+  }
+
+  if (!VectorType::isValidElementType(accessedTy)) {
+    return getReplicatedCost(inst, vectorWidth);
+  }
+  auto * vecTy = VectorType::get(accessedTy, vectorWidth);
+
+  // contiguous access
+  unsigned storeSize = platInfo.getDataLayout().getTypeStoreSize(accessedTy);
+  if (addrShape.isStrided(storeSize)) {
+    if (!needsMask) return tti.getMemoryOpCost(opcode, vecTy, alignment, addrSpace);
+
+    bool legal = load ? tti.isLegalMaskedLoad(vecTy) : tti.isLegalMaskedStore(vecTy);
+    if (legal) return tti.getMaskedMemoryOpCost(opcode, vecTy, alignment, addrSpace);
+
+    // branch around every lane
+    ++estimate.numCascades;
+    return getReplicatedCost(inst, vectorWidth) + 2 * vectorWidth;
+  }
+
+  // gather/scatter
+  if (load) ++estimate.numGathers; else ++estimate.numScatters;
+  bool legal = load ? tti.isLegalMaskedGather(vecTy) : tti.isLegalMaskedScatter(vecTy);
+  unsigned laneCost = vectorWidth * (getScalarCost(inst) + tti.getAddressComputationCost(vecTy, true));
+  if (legal) return laneCost;
+
+  if (needsMask) ++estimate.numCascades;
+  return getReplicatedCost(inst, vectorWidth) + (needsMask ? 2 * vectorWidth : 0);
+}
+
+unsigned
+CostModel::getCallCost(const Instruction & inst, WidthEstimate & estimate) const {
+  const unsigned vectorWidth = estimate.vectorWidth;
+  auto & call = cast<CallInst>(inst);
+  auto * callee = call.getCalledFunction();
+
+  // SIMD mappings (rv_* intrinsics, user mappings)
+  if (callee && platInfo.getMappingByFunction(callee)) {
+    return ScalarCallCost * getNumParts(*call.getType(), vectorWidth);
+  }
+
+  // SIMD library functions
+  if (callee && platInfo.isFunctionVectorizable(callee->getName(), vectorWidth)) {
+    return ScalarCallCost * getNumParts(*call.getType(), vectorWidth);
+  }
+
+  // vector intrinsics
+  if (auto * intrin = dyn_cast<IntrinsicInst>(&call)) {
+    auto * retTy = call.getType();
+    if (VectorType::isValidElementType(retTy)) {
+      SmallVector<Type*, 4> vecArgTys;
+      bool allValid = true;
+      for (auto & arg : call.arg_operands()) {
+        auto * argTy = arg->getType();
+        if (!VectorType::isValidElementType(argTy)) { allValid = false; break; }
+        vecArgTys.push_back(VectorType::get(argTy, vectorWidth));
+      }
+      if (allValid) {
+        return tti.getIntrinsicInstrCost(intrin->getIntrinsicID(), VectorType::get(retTy, vectorWidth), vecArgTys);
+      }
+    }
+  }
+
+  ++estimate.numReplicatedCalls;
+  unsigned cost = getReplicatedCost(inst, vectorWidth);
+  if (isPredicated(*inst.getParent()) && call.mayHaveSideEffects()) {
+    ++estimate.numCascades;
+    cost += 2 * vectorWidth;
+  }
+  return cost;
+}
+
+unsigned
+CostModel::getVectorCost(const Instruction & inst, Type & vecTy, WidthEstimate & estimate) const {
+  const unsigned vectorWidth = estimate.vectorWidth;
+  unsigned opcode = inst.getOpcode();
+
+  if (inst.isBinaryOp()) return tti.getArithmeticInstrCost(opcode, &vecTy);
+  if (auto * castInst = dyn_cast<CastInst>(&inst)) {
+    auto * srcTy = castInst->getSrcTy();
+    if (!VectorType::isValidElementType(srcTy)) return getReplicatedCost(inst, vectorWidth);
+    return tti.getCastInstrCost(opcode, &vecTy, VectorType::get(srcTy, vectorWidth));
+  }
+  if (auto * cmp = dyn_cast<CmpInst>(&inst)) {
+    auto * opTy = cmp->getOperand(0)->getType();
+    if (!VectorType::isValidElementType(opTy)) return getReplicatedCost(inst, vectorWidth);
+    return tti.getCmpSelInstrCost(opcode, VectorType::get(opTy, vectorWidth), &vecTy);
+  }
+  if (isa<SelectInst>(inst)) return tti.getCmpSelInstrCost(opcode, &vecTy);
+  if (isa<GetElementPtrInst>(inst)) return tti.getAddressComputationCost(&vecTy, true) * getNumParts(*inst.getType(), vectorWidth);
+
+  if (auto * phi = dyn_cast<PHINode>(&inst)) {
+    if (!isBlendBlock(*phi->getParent())) return 0;
+    // each additional incoming value becomes a select
+    unsigned numSelects = phi->getNumIncomingValues() - 1;
+    estimate.numBlends += numSelects;
+    return numSelects * tti.getCmpSelInstrCost(Instruction::Select, &vecTy);
+  }
+
+  return getReplicatedCost(inst, vectorWidth);
+}
+
+void
+CostModel::estimateRegisterPressure(WidthEstimate & estimate) const {
+  // widest type of all vectorized values
+  Type * widestTy = nullptr;
+  unsigned widestBits = 0;
+
+  auto & func = vecInfo.getScalarFunction();
+  for (auto & block : func) {
+    for (auto & inst : block) {
+      if (!vecInfo.inRegion(inst) || !isVectorized(inst)) continue;
+      auto * ty = inst.getType();
+      unsigned bits = ty->isPointerTy() ? 64 : ty->getPrimitiveSizeInBits();
+      if (bits > widestBits) {
+        widestBits = bits;
+        widestTy = ty;
+      }
+    }
+  }
+  if (!widestTy) return;
+
+  // maximal number of varying values that are live at the same time in any block
+  unsigned maxLive = 0;
+  for (auto & block : func) {
+    if (block.empty() || !vecInfo.inRegion(*block.getTerminator())) continue;
+
+    SmallPtrSet<const Value*, 32> live;
+    for (auto itInst = block.rbegin(); itInst != block.rend(); ++itInst) {
+      auto & inst = *itInst;
+      live.erase(&inst);
+
+      // live-outs
+      for (auto * user : inst.users()) {
+        auto * userInst = dyn_cast<Instruction>(user);
+        if (userInst && userInst->getParent() != &block && isVectorized(inst)) {
+          live.insert(&inst);
+        }
+      }
+
+      if (isa<PHINode>(inst)) continue;
+      for (auto & op : inst.operands()) {
+        auto * opInst = dyn_cast<Instruction>(op);
+        if (opInst && isVectorized(*opInst)) live.insert(opInst);
+      }
+      maxLive = std::max<unsigned>(maxLive, live.size());
+    }
+  }
+
+  unsigned numRegs = tti.getNumberOfRegisters(true);
+  estimate.registerPressure = maxLive * getNumParts(*widestTy, estimate.vectorWidth);
+  if (numRegs && estimate.registerPressure > numRegs) {
+    estimate.numSpills = estimate.registerPressure - numRegs;
+    auto * vecTy = VectorType::get(widestTy, std::min<unsigned>(estimate.vectorWidth, tti.getRegisterBitWidth(true) / std::max<unsigned>(widestBits, 1)));
+    unsigned spillCost = tti.getMemoryOpCost(Instruction::Store, vecTy, 0, 0) + tti.getMemoryOpCost(Instruction::Load, vecTy, 0, 0);
+    estimate.cost += estimate.numSpills * spillCost;
+  }
+}
+
+WidthEstimate
+CostModel::estimate(unsigned vectorWidth) const {
+  WidthEstimate estimate(vectorWidth);
+
+  auto & func = vecInfo.getScalarFunction();
+  for (auto & block : func) {
+    for (auto & inst : block) {
+      if (!vecInfo.inRegion(inst)) continue;
+
+      unsigned instCost = 0;
+      if (isa<LoadInst>(inst) || isa<StoreInst>(inst)) {
+        instCost = getMemoryCost(inst, estimate);
+
+      } else if (isa<CallInst>(inst) && isVectorized(inst)) {
+        instCost = getCallCost(inst, estimate);
+
+      } else if (auto * branch = dyn_cast<BranchInst>(&inst)) {
+        // varying branches turn into mask computations
+        if (branch->isConditional() && vecInfo.hasKnownShape(*branch) && !vecInfo.getVectorShape(*branch).isUniform()) {
+          auto * maskTy = VectorType::get(branch->getCondition()->getType(), vectorWidth);
+          instCost = 2 * tti.getArithmeticInstrCost(Instruction::And, maskTy);
+        }
+
+      } else if (isVectorized(inst) && VectorType::isValidElementType(inst.getType())) {
+        auto * vecTy = VectorType::get(inst.getType(), vectorWidth);
+        instCost = getVectorCost(inst, *vecTy, estimate);
+
+      } else if (isVectorized(inst)) {
+        instCost = getReplicatedCost(inst, vectorWidth);
+
+      } else {
+        instCost = getScalarCost(inst);
+      }
+
+      estimate.cost += instCost;
+    }
+  }
+
+  estimateRegisterPressure(estimate);
+
+  IF_DEBUG_CM { errs() << "CostModel: "; estimate.print(errs()); errs() << "\n"; }
+
+  return estimate;
+}
+
+std::vector<WidthEstimate>
+CostModel::rank(ArrayRef<unsigned> candidateWidths) const {
+  std::vector<WidthEstimate> estimates;
+  for (unsigned vectorWidth : candidateWidths) {
+    estimates.push_back(estimate(vectorWidth));
+  }
+
+  // cheapest per lane first, narrower widths win ties
+  std::stable_sort(estimates.begin(), estimates.end(), [](const WidthEstimate & a, const WidthEstimate & b) {
+    double costA = a.getCostPerLane();
+    double costB = b.getCostPerLane();
+    if (costA != costB) return costA < costB;
+    return a.vectorWidth < b.vectorWidth;
+  });
+
+  return estimates;
+}
+
+}
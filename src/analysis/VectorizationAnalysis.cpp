@@ -19,6 +19,7 @@
 #include <llvm/Analysis/PostDominators.h>
 #include <llvm/IR/Dominators.h>
 #include <llvm/Analysis/LoopInfo.h>
+#include <llvm/ADT/PostOrderIterator.h>
 
 #if 1
 #define IF_DEBUG_VA IF_DEBUG
@@ -47,8 +48,6 @@ GenericTransfer(rv::VectorShape a, Shapes... nextShapes) {
 
 namespace rv {
 
-using ValueMap = std::map<const Value*, VectorShape>;
-
 // #define BYTE_SIZE 8
 
 char VAWrapperPass::ID = 0;
@@ -102,8 +101,8 @@ void
 VectorizationAnalysis::analyze(Function& F) {
   assert (!F.isDeclaration());
 
-  // FIXME mWorklist.clear()
   while (!mWorklist.empty()) mWorklist.pop();
+  numberInstructions(F);
 
   init(F);
   compute(F);
@@ -121,15 +120,38 @@ bool VectorizationAnalysis::isInRegion(const Instruction& inst) {
 }
 
 void VectorizationAnalysis::fillVectorizationInfo(Function& F) {
+  // arguments keep the shapes of the VectorizationInfo
+  for (const Argument& arg : F.args()) {
+    if (mVecinfo.hasKnownShape(arg)) {
+      mValue2Shape[arg] = mVecinfo.getVectorShape(arg);
+    } else {
+      mValue2Shape.erase(arg);
+    }
+  }
+
+  // region instructions without a shape and instructions outside of the region are uniform
   for (const BasicBlock& BB : F) {
-    if (!isInRegion(BB)) continue;
-    mVecinfo.setVectorShape(BB, mValue2Shape[&BB]);
-    for (const Instruction& I : BB) {
-      VectorShape& shape = mValue2Shape[&I];
+    if (!isInRegion(BB)) {
+      mValue2Shape.erase(BB);
+      for (const Instruction& I : BB) mValue2Shape[I] = VectorShape::uni();
+      continue;
+    }
 
-      mVecinfo.setVectorShape(I, shape.isDefined() ? shape : VectorShape::uni());
+    for (const Instruction& I : BB) {
+      VectorShape& shape = mValue2Shape[I];
+      if (!shape.isDefined()) shape = VectorShape::uni();
     }
   }
+
+  // drop the cached shapes of constants and globals
+  std::vector<const Value*> constants;
+  mValue2Shape.forEach([&](const Value& val, const VectorShape&) {
+    if (isa<Constant>(val)) constants.push_back(&val);
+  });
+  for (const Value* c : constants) mValue2Shape.erase(*c);
+
+  mVecinfo.setVectorShapes(std::move(mValue2Shape));
+  mValue2Shape = ShapeMap();
 }
 
 unsigned VectorizationAnalysis::getAlignment(const Constant* c) const {
@@ -175,8 +197,8 @@ void VectorizationAnalysis::init(Function& F) {
   layout = DataLayout(F.getParent());
 
   // Initialize with undefined values
-  for (auto& arg : F.args()) mValue2Shape[&arg] = VectorShape::undef();
-  for (auto& BB : F) for (auto& I : BB) mValue2Shape[&I] = VectorShape::undef();
+  for (auto& arg : F.args()) mValue2Shape[arg] = VectorShape::undef();
+  for (auto& BB : F) for (auto& I : BB) mValue2Shape[I] = VectorShape::undef();
 
   // bootstrap with user defined shapes
   for (auto& BB : F) {
@@ -222,7 +244,7 @@ void VectorizationAnalysis::init(Function& F) {
   // - Constants
   // - Calls (theres no connection to them in the iteration if they have no parameters)
   for (const BasicBlock& BB : F) {
-    mValue2Shape[&BB] = VectorShape::uni();
+    mValue2Shape[BB] = VectorShape::uni();
 
     for (const Instruction& I : BB) {
       if (isa<AllocaInst>(&I)) {
@@ -234,12 +256,12 @@ void VectorizationAnalysis::init(Function& F) {
         if (call->getCalledFunction()->getReturnType()->isVoidTy()) continue;
         if (call->getNumArgOperands() != 0) continue;
 
-        mWorklist.push(&I);
+        pushToWorklist(&I);
         IF_DEBUG_VA errs() << "Inserted call in initialization: " << I.getName() << "\n";
       }
         /* Phis that depend on constants are added to the WL */
       else if (isa<PHINode>(I) && any_of(I.operands(), isa<Constant, Use>)) {
-        mWorklist.push(&I);
+        pushToWorklist(&I);
         IF_DEBUG_VA errs() << "Inserted PHI in initialization: " << I.getName() << "\n";
       }
     }
@@ -255,11 +277,11 @@ void VectorizationAnalysis::update(const Value* const V, VectorShape AT) {
 void VectorizationAnalysis::updateShape(const Value* const V, VectorShape AT) {
   const VectorShape& New = VectorShape::join(getShape(V), AT);
 
-  if (mValue2Shape[V] == New) return;// nothing changed
+  if (mValue2Shape[*V] == New) return;// nothing changed
   if (overrides.count(V) && getShape(V).isDefined()) return;//prevented by override
 
   IF_DEBUG_VA errs() << "Marking " << New << ": " << *V << "\n";
-  mValue2Shape[V] = New;
+  mValue2Shape[*V] = New;
 
   /* Add dependent elements to worklist */
   addRelevantUsersToWL(V);
@@ -287,7 +309,7 @@ void VectorizationAnalysis::analyzeDivergence(const BranchInst* const branch) {
     } // filter out irrelevant nodes (FIXME filter out directly in BDA)
 
     // Doesn't matter if already effected previously
-    if (mValue2Shape[BB].isVarying()) continue;
+    if (mValue2Shape[*BB].isVarying()) continue;
 
     IF_DEBUG errs() << "Branch " << *branch << " affects " << *BB << "\n";
 
@@ -332,7 +354,7 @@ void VectorizationAnalysis::analyzeDivergence(const BranchInst* const branch) {
       if (allExitsUniform(endsVaryingLoop)) continue;
     }
 
-    mValue2Shape[BB] = VectorShape::varying();
+    mValue2Shape[*BB] = VectorShape::varying();
 
     IF_DEBUG_VA {
       errs() << "\n"
@@ -344,7 +366,7 @@ void VectorizationAnalysis::analyzeDivergence(const BranchInst* const branch) {
 
     // add phis to worklist
     for (auto it = BB->begin(); BB->getFirstNonPHI() != &*it; ++it) {
-      mWorklist.push(&*it);
+      pushToWorklist(&*it);
       IF_DEBUG_VA errs() << "Inserted PHI: " << (&*it)->getName() << "\n";
     }
   }
@@ -393,9 +415,9 @@ void VectorizationAnalysis::updateAllocaOperands(const Instruction* I) {
 }
 
 void VectorizationAnalysis::eraseUserInfoRecursively(const Value* V) {
-  if (!mValue2Shape[V].isDefined()) return;
+  if (!mValue2Shape[*V].isDefined()) return;
 
-  mValue2Shape[V] = VectorShape::undef();
+  mValue2Shape[*V] = VectorShape::undef();
 
   for (const Value* use : V->users()) {
     eraseUserInfoRecursively(use);
@@ -423,7 +445,7 @@ void VectorizationAnalysis::addRelevantUsersToWL(const Value* V) {
 
     if (!isa<PHINode>(inst) && any_of(inst->operands(), isUndef)) continue;
 
-    mWorklist.push(inst);
+    pushToWorklist(inst);
     IF_DEBUG_VA errs() << "Inserted relevant user of " << V->getName() << ":" << *user << "\n";
   }
 }
@@ -468,23 +490,66 @@ VectorShape VectorizationAnalysis::joinOperands(const Instruction* const I) {
 bool VectorizationAnalysis::allOperandsHaveShape(const Instruction* I) {
   auto hasKnownShape = [this](Value* op)
   {
-    if (isa<Instruction>(op) && !mValue2Shape[op].isDefined()) {
+    if (isa<Instruction>(op) && !mValue2Shape[*op].isDefined()) {
       IF_DEBUG_VA { errs() << "\tmissing op shape " << *op << "!\n"; }
-      mWorklist.push(cast<Instruction>(op));
+      pushToWorklist(cast<Instruction>(op));
     }
 
-    return !isa<Instruction>(op) || mValue2Shape[op].isDefined();
+    return !isa<Instruction>(op) || mValue2Shape[*op].isDefined();
   };
 
   return all_of(I->operands(), hasKnownShape);
 }
 
+void VectorizationAnalysis::numberInstructions(Function& F) {
+  mRPOInsts.clear();
+  mRPOIndex.clear();
+
+  auto numberBlock = [&](const BasicBlock& BB) {
+    for (const Instruction& I : BB) {
+      mRPOIndex[&I] = mRPOInsts.size();
+      mRPOInsts.push_back(&I);
+    }
+  };
+
+  SmallPtrSet<const BasicBlock*, 32> visited;
+  ReversePostOrderTraversal<Function*> RPOT(&F);
+  for (BasicBlock* BB : RPOT) {
+    visited.insert(BB);
+    numberBlock(*BB);
+  }
+
+  // unreachable blocks go last
+  for (const BasicBlock& BB : F) {
+    if (!visited.count(&BB)) numberBlock(BB);
+  }
+
+  mInWorklist.clear();
+  mInWorklist.resize(mRPOInsts.size());
+}
+
+void VectorizationAnalysis::pushToWorklist(const Instruction* I) {
+  auto it = mRPOIndex.find(I);
+  assert(it != mRPOIndex.end() && "instruction not in analyzed function");
+
+  unsigned idx = it->second;
+  if (mInWorklist.test(idx)) return; // already queued
+  mInWorklist.set(idx);
+  mWorklist.push(idx);
+}
+
+const Instruction* VectorizationAnalysis::popFromWorklist() {
+  unsigned idx = mWorklist.top();
+  mWorklist.pop();
+  mInWorklist.reset(idx);
+  return mRPOInsts[idx];
+}
+
 void VectorizationAnalysis::compute(Function& F) {
   IF_DEBUG_VA { errs() << "\n\n-- VA::compute() log -- \n"; }
   /* Worklist algorithm to compute the least fixed-point */
   while (!mWorklist.empty()) {
-    const Instruction* I = mWorklist.front();
-    mWorklist.pop();
+    const Instruction* I = popFromWorklist();
 
     IF_DEBUG_VA { errs() << "# next: " << *I << "\n"; }
 
@@ -963,20 +1028,15 @@ VectorShape VectorizationAnalysis::computeShapeForCastInst(const CastInst* castI
 }
 
 VectorShape VectorizationAnalysis::getShape(const Value* const V) {
-  auto found = mValue2Shape.find(V), end = mValue2Shape.end();
-  if (found != end) return found->second;
+  const VectorShape * found = mValue2Shape.lookup(*V);
+  if (found) return *found;
 
   if (isa<GlobalValue>(V)) return VectorShape::uni(0);
 
   assert (isa<Constant>(V) && "Value is not available");
-  return mValue2Shape[V] = VectorShape::uni(getAlignment(cast<Constant>(V)));
+  return mValue2Shape[*V] = VectorShape::uni(getAlignment(cast<Constant>(V)));
 }
 
-typename ValueMap::iterator VectorizationAnalysis::begin() { return mValue2Shape.begin(); }
-typename ValueMap::iterator VectorizationAnalysis::end() { return mValue2Shape.end(); }
-typename ValueMap::const_iterator VectorizationAnalysis::begin() const { return mValue2Shape.begin(); }
-typename ValueMap::const_iterator VectorizationAnalysis::end() const { return mValue2Shape.end(); }
-
 
 FunctionPass*
 createVectorizationAnalysisPass() {
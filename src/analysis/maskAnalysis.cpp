@@ -10,6 +10,7 @@
 
 #include "rv/analysis/maskAnalysis.h"
 
+#include <algorithm>
 #include <stdexcept>
 
 #include <llvm/IR/Instructions.h>
@@ -62,22 +63,7 @@ MaskAnalysisWrapper::MaskAnalysisWrapper()
 
 MaskAnalysis::~MaskAnalysis()
 {
-    for (auto &it : mBlockMap) {
-        delete it.second;
-    }
-
-    for (auto & it : mLoopMaskMap) {
-        delete it.second;
-    }
-
-    for (auto &it : mLoopExitMap) {
-        LoopExitMaskInfo* li = it.second;
-        delete li;
-    }
-
-    for (auto &mask : mMasks) {
-        mask.reset();
-    }
+    // Mask nodes and mask infos are released with their arenas.
 }
 
 void
@@ -268,10 +254,8 @@ MaskAnalysis::createMask(const NodeType type,
 {
     assert (insertPoint);
 
-    // Create shared pointer.
-    MaskPtr mask = std::make_shared<Mask>(type, insertPoint);
-
-    // Store shared pointer to prevent early deletion.
+    // The ID of a mask is its index in mMasks.
+    MaskPtr mask = new (mMaskArena.Allocate()) Mask(mMasks.size(), type, insertPoint);
     mMasks.push_back(mask);
 
     return mask;
@@ -287,13 +271,48 @@ MaskAnalysis::getOrCreateBMIFor(BasicBlock* block)
         info = itBlockInfo->second;
         info->mExitMasks.clear();
     } else {
-        info = new BlockMaskInfo();
+        info = new (mBlockInfoArena.Allocate()) BlockMaskInfo();
         mBlockMap[block] = info;
     }
 
     return info;
 }
 
+void
+MaskAnalysis::computeBlockOrder(BasicBlock*               start,
+                                SmallVector<BasicBlock*, 32>& blockOrder)
+{
+    Region* region = vecInfo.getRegion();
+
+    // Iterative depth-first search over the region blocks, post order.
+    SmallPtrSet<BasicBlock*, 32> visited;
+    SmallVector<std::pair<BasicBlock*, succ_iterator>, 32> stack;
+    visited.insert(start);
+    stack.push_back(std::make_pair(start, succ_begin(start)));
+
+    while (!stack.empty())
+    {
+        BasicBlock*    block  = stack.back().first;
+        succ_iterator& itSucc = stack.back().second;
+
+        if (itSucc == succ_end(block))
+        {
+            blockOrder.push_back(block);
+            stack.pop_back();
+            continue;
+        }
+
+        BasicBlock* succBB = *itSucc;
+        ++itSucc;
+
+        if (region && !region->contains(succBB)) continue; // Ignore blocks outside of region
+        if (!visited.insert(succBB).second) continue;
+        stack.push_back(std::make_pair(succBB, succ_begin(succBB)));
+    }
+
+    std::reverse(blockOrder.begin(), blockOrder.end());
+}
+
 void
 MaskAnalysis::createMaskGraph(Function& f)
 {
@@ -301,8 +320,38 @@ MaskAnalysis::createMaskGraph(Function& f)
 
     BasicBlock* start = region ? &region->getRegionEntry() : &f.getEntryBlock();
 
-    DenseSet<BasicBlock*> markedBlocks;
-    recCreateMaskGraph(start, markedBlocks);
+    // In reverse post order, all predecessors of a block have their masks
+    // except for the latches of loop headers.
+    SmallVector<BasicBlock*, 32> blockOrder;
+    computeBlockOrder(start, blockOrder);
+
+    for (BasicBlock* block : blockOrder)
+    {
+        createBlockMasks(block);
+    }
+
+    // Now that all latches have exit masks, close the loop mask phis.
+    for (BasicBlock* block : blockOrder)
+    {
+        if (!mLoopInfo.isLoopHeader(block)) continue;
+        Loop* loop = mLoopInfo.getLoopFor(block);
+        if (!vecInfo.isDivergentLoop(loop)) continue;
+
+        // We can now set the incoming value of the loop mask phi
+        // from direction of the latch.
+        BasicBlock* latchBB   = loop->getLoopLatch();
+        MaskPtr     entryMask = getEntryMaskPtr(*block);
+
+        assert (entryMask->mType == LOOPMASKPHI);
+        MaskPtr latchMask = getExitMaskPtr(*latchBB, *block);
+        entryMask->mOperands.push_back(latchMask);
+        entryMask->mIncomingDirs.push_back(latchBB);
+
+        DEBUG_RV(
+            errs() << "  updated loop mask phi in loop header '" << block->getName() << "': ";
+            entryMask->print(errs()); errs() << "\n";
+        );
+    }
 
     // We have to be sure to create loop exit masks for every nested divergent
     // loop. Therefore, we iterate over all those loops that are divergent
@@ -332,30 +381,10 @@ MaskAnalysis::createMaskGraph(Function& f)
 }
 
 void
-MaskAnalysis::recCreateMaskGraph(BasicBlock*            block,
-                                 DenseSet<BasicBlock*>& markedBlocks)
+MaskAnalysis::createBlockMasks(BasicBlock* block)
 {
     assert (block);
 
-    Region* region = vecInfo.getRegion();
-    if (region && !region->contains(block)) return; // Ignore blocks outside of region
-
-    // If we have marked this block already, ignore it.
-    if (markedBlocks.find(block) != markedBlocks.end()) return;
-
-    const bool  isLoopHeader = mLoopInfo.isLoopHeader(block);
-    const Loop* loop         = mLoopInfo.getLoopFor(block);
-    assert (!isLoopHeader || loop);
-
-    // Wait for predecessors to be reached, unless for loop headers (cyclic dependency)
-    if (!isLoopHeader)
-    {
-        for (auto predBB : predecessors(block))
-        {
-            if (!markedBlocks.count(predBB)) return;
-        }
-    }
-
     DEBUG_RV( errs() << "\ngenerating mask information for block '"
             << block->getName() << "'... \n"; );
 
@@ -376,38 +405,10 @@ MaskAnalysis::recCreateMaskGraph(BasicBlock*            block,
         info->mExitMasks.push_back(M);
     }
 
-    // Mark block as finished.
-    markedBlocks.insert(block);
-
     IF_DEBUG_MA {
         errs() << "generated mask information for block '" << block->getName() << "':\n";
         info->print(errs());
     }
-
-    // Recurse into successors
-    for (BasicBlock* succBB : successors(block))
-    {
-        recCreateMaskGraph(succBB, markedBlocks);
-    }
-
-    // Update loop mask phis if present:
-
-    // Only present for divergent loops and located in the header
-    if (!isLoopHeader || !vecInfo.isDivergentLoop(loop)) return;
-
-    // We can now set the incoming value of the loop mask phi
-    // from direction of the latch.
-    BasicBlock* latchBB = loop->getLoopLatch();
-
-    assert (entryMask->mType == LOOPMASKPHI);
-    MaskPtr latchMask = getExitMaskPtr(*latchBB, *block);
-    entryMask->mOperands.push_back(latchMask);
-    entryMask->mIncomingDirs.push_back(latchBB);
-
-    DEBUG_RV(
-        errs() << "  updated loop mask phi in loop header '" << block->getName() << "': ";
-        entryMask->print(errs()); errs() << "\n";
-    );
 }
 
 MaskPtr
@@ -511,7 +512,7 @@ MaskAnalysis::createEntryMask(BasicBlock* block)
             if (itLoopMaskInfo != mLoopMaskMap.end()) {
               loopInfo = itLoopMaskInfo->second;
             } else {
-               loopInfo = new LoopMaskInfo();
+               loopInfo = new (mLoopInfoArena.Allocate()) LoopMaskInfo();
                mLoopMaskMap[loop] = loopInfo;
             }
             loopInfo->mLoop    = loop;
@@ -711,16 +712,16 @@ MaskAnalysis::createExitMasks(BasicBlock*              block,
         // handle it now that we have the case conditions and build the condition for default
         if (isa<SwitchInst>(terminator))
         {
-            MaskPtr disj = exitMasks[1]->mOperands[0].lock();
+            MaskPtr disj = exitMasks[1]->mOperands[0];
             for (unsigned i = 2; i < NumSuccessors; ++i)
             {
                 auto temp = disj;
                 disj = createMask(DISJUNCTION, insertPoint);
                 disj->mOperands.push_back(temp);
-                disj->mOperands.push_back(exitMasks[i]->mOperands[0].lock());
+                disj->mOperands.push_back(exitMasks[i]->mOperands[0]);
             }
 
-            exitMasks[0]->mOperands[0].lock()->mOperands.push_back(disj);
+            exitMasks[0]->mOperands[0]->mOperands.push_back(disj);
         }
 
         return;
@@ -824,16 +825,16 @@ MaskAnalysis::createExitMasks(BasicBlock*              block,
     // handle it now that we have the case conditions and build the condition for default
     if (isa<SwitchInst>(terminator))
     {
-        MaskPtr disj = exitMasks[1]->mOperands[1].lock();
+        MaskPtr disj = exitMasks[1]->mOperands[1];
         for (unsigned i = 2; i < NumSuccessors; ++i)
         {
             auto temp = disj;
             disj = createMask(DISJUNCTION, insertPoint);
             disj->mOperands.push_back(temp);
-            disj->mOperands.push_back(exitMasks[i]->mOperands[1].lock());
+            disj->mOperands.push_back(exitMasks[i]->mOperands[1]);
         }
 
-        exitMasks[0]->mOperands[1].lock()->mOperands.push_back(disj);
+        exitMasks[0]->mOperands[1]->mOperands.push_back(disj);
     }
 }
 
@@ -887,7 +888,7 @@ MaskAnalysis::createLoopExitMasks(Loop* loop)
             }
 
             // Otherwise, create a new entry for the map.
-            LoopExitMaskInfo* info = new LoopExitMaskInfo();
+            LoopExitMaskInfo* info = new (mLoopExitInfoArena.Allocate()) LoopExitMaskInfo();
 
             // Derive & store information about this exit.
             // NOTE: There can be a difference between the top level loop
@@ -1103,15 +1104,15 @@ MaskAnalysis::createLoopExitMasks(Loop* loop)
                 errs() << "\n";
             );
             assert (loopExitMask->mType == LOOPEXITUPDATE);
-            assert (loopExitMask->mOperands[0].lock()->mType == LOOPEXITPHI);
+            assert (loopExitMask->mOperands[0]->mType == LOOPEXITPHI);
 
             // We need only those instances that left the loop in the current iteration
             // of the current loop (which may include multiple iterations of all inner
             // loops of that exit). These instances are given by the update operation
             // of the next nested loop or the exit mask if this is the innermost loop.
             assert (exitInfo->mInnermostLoop == loop ||
-                    loopExitMask->mOperands[1].lock()->mType == LOOPEXITUPDATE);
-            loopExitMask = loopExitMask->mOperands[1].lock();
+                    loopExitMask->mOperands[1]->mType == LOOPEXITUPDATE);
+            loopExitMask = loopExitMask->mOperands[1];
         }
 
         DEBUG_RV( errs() << "  input mask: "; loopExitMask->print(errs()); errs() << "\n"; );
@@ -1168,15 +1169,15 @@ MaskAnalysis::getActualLoopExitMask(BasicBlock & exiting) {
           errs() << "\n";
       );
       assert (loopExitMask->mType == LOOPEXITUPDATE);
-      assert (loopExitMask->mOperands[0].lock()->mType == LOOPEXITPHI);
+      assert (loopExitMask->mOperands[0]->mType == LOOPEXITPHI);
 
       // We need only those instances that left the loop in the current iteration
       // of the current loop (which may include multiple iterations of all inner
       // loops of that exit). These instances are given by the update operation
       // of the next nested loop or the exit mask if this is the innermost loop.
       assert (exitInfo->mInnermostLoop == loop ||
-              loopExitMask->mOperands[1].lock()->mType == LOOPEXITUPDATE);
-      loopExitMask = loopExitMask->mOperands[1].lock();
+              loopExitMask->mOperands[1]->mType == LOOPEXITUPDATE);
+      loopExitMask = loopExitMask->mOperands[1];
   }
 
   return loopExitMask->mValue;
@@ -1456,7 +1457,7 @@ MaskAnalysis::copyMaskInfoToNewBlock(BasicBlock*       newBlock,
     assert (!mBlockMap.count(newBlock));
 
     // Store information in new graph node.
-    BlockMaskInfo* info = new BlockMaskInfo();
+    BlockMaskInfo* info = new (mBlockInfoArena.Allocate()) BlockMaskInfo();
     info->mBlock        = newBlock;
 
     // Copy entry mask.
@@ -1480,7 +1481,7 @@ MaskAnalysis::clearEntryMask(const BasicBlock& block)
 {
     assert (mBlockMap.count(&block));
     BlockMaskInfo* info = mBlockMap[&block];
-    info->mEntryMask.reset();
+    info->mEntryMask = nullptr;
 }
 
 void
@@ -1488,10 +1489,6 @@ MaskAnalysis::clearExitMasks(const BasicBlock& block)
 {
     assert (mBlockMap.count(&block));
     BlockMaskInfo* info = mBlockMap[&block];
-    for (auto &mask : info->mExitMasks)
-    {
-        mask.reset();
-    }
     info->mExitMasks.clear();
 }
 
@@ -1560,7 +1557,6 @@ MaskAnalysis::removeExitMask(const BasicBlock& block,
     assert (mBlockMap[&block]->mExitMasks.size() > index);
 
     BlockMaskInfo* info = mBlockMap[&block];
-    if (info->mExitMasks[index]) info->mExitMasks[index].reset();
     SmallVector<MaskPtr, 2>::iterator it = info->mExitMasks.begin();
     std::advance(it, index);
     info->mExitMasks.erase(it);
@@ -1597,10 +1593,6 @@ MaskAnalysis::setEntryMaskPtr(const BasicBlock& block,
     assert (mBlockMap.find(&block)->second);
 
     BlockMaskInfo* info = mBlockMap[&block];
-
-    MaskPtr oldMask = info->mEntryMask;
-    if (oldMask) oldMask.reset();
-
     info->mEntryMask = mask;
 }
 
@@ -1614,10 +1606,6 @@ MaskAnalysis::setExitMaskPtr(const BasicBlock& block,
     assert (mBlockMap.find(&block)->second->mExitMasks.size() > index);
 
     BlockMaskInfo* info = mBlockMap[&block];
-
-    MaskPtr oldMask = info->mExitMasks[index];
-    if (oldMask) oldMask.reset();
-
     info->mExitMasks[index] = mask;
 }
 
@@ -1653,13 +1641,6 @@ MaskAnalysis::setLoopExitMaskPtrPhi(const Loop&       loop,
     assert (mLoopExitMap.count(&exitingBlock));
 
     LoopExitMaskInfo* info = mLoopExitMap[&exitingBlock];
-
-    if (info->mMaskPhiMap.count(&loop))
-    {
-        MaskPtr oldMask = info->mMaskPhiMap[&loop];
-        oldMask.reset();
-    }
-
     info->mMaskPhiMap[&loop] = mask;
 }
 
@@ -1671,13 +1652,6 @@ MaskAnalysis::setLoopExitMaskPtrUpdate(const Loop&       loop,
     assert (mLoopExitMap.count(&exitingBlock));
 
     LoopExitMaskInfo* info = mLoopExitMap[&exitingBlock];
-
-    if (info->mMaskUpdateOpMap.count(&loop))
-    {
-        MaskPtr oldMask = info->mMaskUpdateOpMap[&loop];
-        oldMask.reset();
-    }
-
     info->mMaskUpdateOpMap[&loop] = mask;
 }
 
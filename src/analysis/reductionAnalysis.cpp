@@ -8,8 +8,13 @@
 
 #include "rv/analysis/reductionAnalysis.h"
 
+#include <vector>
+
 #include <llvm/IR/Function.h>
 #include <llvm/IR/Constants.h>
+#include <llvm/IR/IntrinsicInst.h>
+#include <llvm/Analysis/ValueTracking.h>
+#include <llvm/Analysis/ScalarEvolutionExpressions.h>
 #include <llvm/Support/raw_ostream.h>
 
 #include "rvConfig.h"
@@ -26,10 +31,54 @@ using namespace llvm;
 
 // struct Reduction
 
+const char *
+rv::to_string(RedKind kind) {
+  switch (kind) {
+    case RedKind::Binary: return "binary";
+    case RedKind::SMin: return "smin";
+    case RedKind::SMax: return "smax";
+    case RedKind::UMin: return "umin";
+    case RedKind::UMax: return "umax";
+    case RedKind::FMin: return "fmin";
+    case RedKind::FMax: return "fmax";
+    case RedKind::Index: return "index";
+    default: return "<invalid>";
+  }
+}
+
+// returns the single incoming value of @updatePhi that is not @headerPhi (or nullptr)
+static Instruction *
+LookThroughUpdatePhi(PHINode & updatePhi, PHINode & headerPhi) {
+  Instruction * updateInst = nullptr;
+  for (unsigned i = 0; i < updatePhi.getNumIncomingValues(); ++i) {
+    auto * inVal = updatePhi.getIncomingValue(i);
+    if (inVal == &headerPhi) continue;
+
+    auto * inInst = dyn_cast<Instruction>(inVal);
+    if (!inInst || (updateInst && updateInst != inInst)) return nullptr;
+    updateInst = inInst;
+  }
+  return updateInst;
+}
+
+Instruction &
+Reduction::getReductOp() {
+  auto & reductInst = getReductInst();
+  auto * updatePhi = dyn_cast<PHINode>(&reductInst);
+  if (!updatePhi) return reductInst;
+
+  auto * reductOp = LookThroughUpdatePhi(*updatePhi, phi);
+  assert(reductOp && "not a predicated reduction update");
+  return *reductOp;
+}
 
 void
 Reduction::dump() const {
-  errs() << "Reduction { " << phi.getName() << " reductInst " << redInput << " with neutral elem " << neutralElem << "}\n";
+  errs() << "Reduction { " << to_string(kind) << " " << phi.getName() << " reductInst " << redInput << " with neutral elem " << neutralElem;
+  if (pairedRed) {
+    errs() << " index of " << pairedRed->phi.getName() << (takeFirstIndex ? " (first" : " (last") << (increasingIndex ? ", increasing)" : ", decreasing)");
+  }
+  errs() << "}\n";
 }
 
 
@@ -38,9 +87,10 @@ Reduction::dump() const {
 // ReductionAnalysis
 
 
-ReductionAnalysis::ReductionAnalysis(Function & _func, const LoopInfo & _loopInfo)
+ReductionAnalysis::ReductionAnalysis(Function & _func, const LoopInfo & _loopInfo, ScalarEvolution & _SE)
 : func(_func)
 , loopInfo(_loopInfo)
+, SE(_SE)
 {}
 
 ReductionAnalysis::~ReductionAnalysis() {
@@ -65,11 +115,75 @@ ReductionAnalysis::inferNeutralElement(Instruction & reductInst) {
     case Instruction::FMul:
       return ConstantFP::get(reductTy, 1.0);
 
+    case Instruction::And:
+      return Constant::getAllOnesValue(reductTy);
+    case Instruction::Or:
+    case Instruction::Xor:
+      return Constant::getNullValue(reductTy);
+
     default:
       return nullptr;
   };
 }
 
+Constant *
+ReductionAnalysis::inferNeutralElement(RedKind kind, Type & reductTy) {
+  if (reductTy.isIntegerTy()) {
+    unsigned bits = reductTy.getIntegerBitWidth();
+    switch (kind) {
+      case RedKind::SMin: return ConstantInt::get(&reductTy, APInt::getSignedMaxValue(bits));
+      case RedKind::SMax: return ConstantInt::get(&reductTy, APInt::getSignedMinValue(bits));
+      case RedKind::UMin: return ConstantInt::get(&reductTy, APInt::getMaxValue(bits));
+      case RedKind::UMax: return ConstantInt::get(&reductTy, APInt::getMinValue(bits));
+      default: return nullptr;
+    }
+
+  } else if (reductTy.isFloatingPointTy()) {
+    const auto & sem = reductTy.getFltSemantics();
+    switch (kind) {
+      case RedKind::FMin: return ConstantFP::get(reductTy.getContext(), APFloat::getInf(sem, false));
+      case RedKind::FMax: return ConstantFP::get(reductTy.getContext(), APFloat::getInf(sem, true));
+      default: return nullptr;
+    }
+  }
+
+  return nullptr;
+}
+
+bool
+ReductionAnalysis::matchMinMax(Instruction & reductInst, PHINode & headerPhi, RedKind & kind) {
+// llvm.minnum / llvm.maxnum
+  if (auto * intrin = dyn_cast<IntrinsicInst>(&reductInst)) {
+    switch (intrin->getIntrinsicID()) {
+      case Intrinsic::minnum: kind = RedKind::FMin; break;
+      case Intrinsic::maxnum: kind = RedKind::FMax; break;
+      default: return false;
+    }
+
+    // binary intrinsic: the phi must be an operand
+    return intrin->getArgOperand(0) == &headerPhi || intrin->getArgOperand(1) == &headerPhi;
+  }
+
+// select (cmp a b) a b idiom
+  auto * sel = dyn_cast<SelectInst>(&reductInst);
+  if (!sel) return false;
+  if (sel->getTrueValue() != &headerPhi && sel->getFalseValue() != &headerPhi) return false;
+
+  Value * lhs = nullptr, * rhs = nullptr;
+  auto pattern = matchSelectPattern(sel, lhs, rhs);
+  if (lhs != &headerPhi && rhs != &headerPhi) return false;
+
+  switch (pattern.Flavor) {
+    case SPF_SMIN: kind = RedKind::SMin; return true;
+    case SPF_SMAX: kind = RedKind::SMax; return true;
+    case SPF_UMIN: kind = RedKind::UMin; return true;
+    case SPF_UMAX: kind = RedKind::UMax; return true;
+    case SPF_FMINNUM: kind = RedKind::FMin; return true;
+    case SPF_FMAXNUM: kind = RedKind::FMax; return true;
+    default: return false;
+  }
+}
+
 Reduction*
 ReductionAnalysis::tryInferReduction(PHINode & headerPhi) {
 // phi must be loop carried
@@ -99,8 +213,30 @@ ReductionAnalysis::tryInferReduction(PHINode & headerPhi) {
     return nullptr;
   }
 
-//
-  auto * neutralElem = inferNeutralElement(*reductInput);
+// look through the phi of a predicated update
+  auto * reductOp = reductInput;
+  if (auto * updatePhi = dyn_cast<PHINode>(reductInput)) {
+    reductOp = reductLoop->contains(updatePhi->getParent()) ? LookThroughUpdatePhi(*updatePhi, headerPhi) : nullptr;
+    if (!reductOp || isa<PHINode>(reductOp)) {
+      IF_DEBUG_RED { errs() << "red: loop carried phi is not a predicated update " << headerPhi.getName() << "\n"; }
+      return nullptr;
+    }
+  }
+
+// classify the reduction operation
+  RedKind kind = RedKind::Binary;
+  Constant * neutralElem = nullptr;
+
+  if (matchMinMax(*reductOp, headerPhi, kind)) {
+    neutralElem = inferNeutralElement(kind, *headerPhi.getType());
+
+  } else if (isa<BinaryOperator>(reductOp)) {
+    // the phi must be an operand (and the minuend of subtractions)
+    bool isSub = reductOp->getOpcode() == Instruction::Sub || reductOp->getOpcode() == Instruction::FSub;
+    bool phiOperand = reductOp->getOperand(0) == &headerPhi || (!isSub && reductOp->getOperand(1) == &headerPhi);
+    if (phiOperand) neutralElem = inferNeutralElement(*reductOp);
+  }
+
   if (!neutralElem) {
     IF_DEBUG_RED { errs() << "red: neutral element for reduction unknown " << headerPhi.getName() << "\n"; }
     return nullptr;
@@ -110,6 +246,7 @@ ReductionAnalysis::tryInferReduction(PHINode & headerPhi) {
 
   auto *red = new
     Reduction(
+        kind,
         *neutralElem,
         *reductInput,
         *reductLoop,
@@ -123,15 +260,102 @@ ReductionAnalysis::tryInferReduction(PHINode & headerPhi) {
   return red;
 }
 
+Reduction*
+ReductionAnalysis::tryInferIndexReduction(PHINode & headerPhi) {
+  auto * reductLoop = loopInfo.getLoopFor(headerPhi.getParent());
+  if (!reductLoop || headerPhi.getNumIncomingValues() != 2) return nullptr;
+
+  int initIndex = 0, loopIndex = 1;
+  if (reductLoop->contains(headerPhi.getIncomingBlock(initIndex))) {
+      std::swap<>(initIndex, loopIndex);
+  }
+
+// the index is updated by a select on the condition of a min/max select
+  auto * idxSel = dyn_cast<SelectInst>(headerPhi.getIncomingValue(loopIndex));
+  if (!idxSel || !idxSel->getType()->isIntegerTy()) return nullptr;
+
+  bool idxNewOnTrue = idxSel->getFalseValue() == &headerPhi;
+  if (!idxNewOnTrue && idxSel->getTrueValue() != &headerPhi) return nullptr;
+
+  auto * cmp = dyn_cast<CmpInst>(idxSel->getCondition());
+  if (!cmp) return nullptr;
+
+// the lanes are combined by the value of their index: it has to be monotonic in the iteration (an induction)
+  auto & payload = idxNewOnTrue ? *idxSel->getTrueValue() : *idxSel->getFalseValue();
+  int direction = getInductionDirection(payload, *reductLoop);
+  if (!direction) {
+    IF_DEBUG_RED { errs() << "red: index is not an induction with a known step direction " << headerPhi.getName() << "\n"; }
+    return nullptr;
+  }
+
+  for (auto itRed : reductMap) {
+    auto & valRed = *itRed.second;
+    if (valRed.kind == RedKind::Binary || valRed.kind == RedKind::Index) continue;
+    if (&valRed.redLoop != reductLoop) continue;
+
+    auto * valSel = dyn_cast<SelectInst>(&valRed.getReductOp());
+    if (!valSel || valSel->getCondition() != cmp) continue;
+
+    // both selects have to take the new value in the same direction
+    bool valNewOnTrue = valSel->getFalseValue() == &valRed.phi;
+    if (valNewOnTrue != idxNewOnTrue) {
+      IF_DEBUG_RED { errs() << "red: index select does not match min/max select " << headerPhi.getName() << "\n"; }
+      return nullptr;
+    }
+
+    // a strict comparison keeps the first occurence of the min/max
+    bool updateOnEqual = cmp->isTrueWhenEqual() == valNewOnTrue;
+
+    auto * neutralElem = Constant::getNullValue(headerPhi.getType());
+    auto * red = new Reduction(RedKind::Index, *neutralElem, *idxSel, *reductLoop, headerPhi, initIndex, loopIndex);
+    red->pairedRed = &valRed;
+    red->takeFirstIndex = !updateOnEqual;
+    red->increasingIndex = direction > 0;
+
+    IF_DEBUG_RED { errs() << "red: recognized: "; red->dump(); }
+    return red;
+  }
+
+  return nullptr;
+}
+
+int
+ReductionAnalysis::getInductionDirection(Value & val, Loop & loop) {
+  if (!SE.isSCEVable(val.getType())) return 0;
+
+  auto * addRec = dyn_cast<SCEVAddRecExpr>(SE.getSCEV(&val));
+  if (!addRec || !addRec->isAffine()) return 0;
+
+  // SE may have been computed on a LoopInfo of its own
+  if (addRec->getLoop()->getHeader() != loop.getHeader()) return 0;
+
+  auto * step = addRec->getStepRecurrence(SE);
+  if (SE.isKnownPositive(step)) return 1;
+  if (SE.isKnownNegative(step)) return -1;
+  return 0;
+}
+
 void
 ReductionAnalysis::analyze(Loop & loop) {
   for (auto * childLoop : loop) analyze(*childLoop);
 
+  std::vector<PHINode*> unmatchedPhis;
   for (auto & inst : *loop.getHeader()) {
     auto * phi = dyn_cast<PHINode>(&inst);
     if (!phi) break;
 
     auto * red = tryInferReduction(*phi);
+    if (!red) {
+      unmatchedPhis.push_back(phi);
+      continue;
+    }
+
+    reductMap[phi] = red;
+  }
+
+// paired index reductions refer to the min/max reductions found above
+  for (auto * phi : unmatchedPhis) {
+    auto * red = tryInferIndexReduction(*phi);
     if (!red) continue;
 
     reductMap[phi] = red;
@@ -0,0 +1,100 @@
+//===- loweringStatistics.cpp -----------------------------===//
+//
+//                     The Region Vectorizer
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+
+#include "rv/loweringStatistics.h"
+
+#include <algorithm>
+
+#include <llvm/IR/DiagnosticInfo.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/Instruction.h>
+#include <llvm/Support/raw_ostream.h>
+
+using namespace llvm;
+
+namespace rv {
+
+const char *
+GetLoweringKindName(LoweringKind kind) {
+  switch (kind) {
+    case LoweringKind::ContiguousLoad: return "contiguous load";
+    case LoweringKind::ContiguousStore: return "contiguous store";
+    case LoweringKind::MaskedLoad: return "masked load";
+    case LoweringKind::MaskedStore: return "masked store";
+    case LoweringKind::InterleavedLoad: return "interleaved load";
+    case LoweringKind::InterleavedStore: return "interleaved store";
+    case LoweringKind::Gather: return "gather";
+    case LoweringKind::Scatter: return "scatter";
+    case LoweringKind::CascadeLoad: return "cascade load";
+    case LoweringKind::CascadeStore: return "cascade store";
+    case LoweringKind::Fallback: return "replicated instruction";
+    case LoweringKind::ReplicatedCall: return "replicated call";
+    case LoweringKind::VectorCall: return "vector variant call";
+    case LoweringKind::SleefCall: return "SLEEF call";
+    case LoweringKind::BlendSelect: return "blend select";
+    case LoweringKind::Reduction: return "reduction";
+    default: return "unknown";
+  }
+}
+
+LoweringStatistics::LoweringStatistics() {
+  std::fill(totals, totals + NumKinds, 0);
+}
+
+void
+LoweringStatistics::add(LoweringKind kind, const DebugLoc & loc) {
+  auto it = locationIndex.find(loc.getAsMDNode());
+  if (it == locationIndex.end()) {
+    unsigned idx = locations.size();
+    locations.emplace_back();
+    locations.back().loc = loc;
+    std::fill(locations.back().counts, locations.back().counts + NumKinds, 0);
+    it = locationIndex.insert(std::make_pair(loc.getAsMDNode(), idx)).first;
+  }
+
+  unsigned k = static_cast<unsigned>(kind);
+  locations[it->second].counts[k]++;
+  totals[k]++;
+}
+
+void
+LoweringStatistics::add(LoweringKind kind, const Instruction & origin) {
+  add(kind, origin.getDebugLoc());
+}
+
+static void
+PrintCounts(raw_ostream & out, const unsigned * counts, unsigned numKinds) {
+  bool first = true;
+  for (unsigned k = 0; k < numKinds; ++k) {
+    if (!counts[k]) continue;
+    out << (first ? "" : ", ") << GetLoweringKindName(static_cast<LoweringKind>(k)) << ": " << counts[k];
+    first = false;
+  }
+  if (first) out << "nothing";
+}
+
+void
+LoweringStatistics::emitRemarks(const Function & func) const {
+  LLVMContext & context = func.getContext();
+
+  for (const auto & location : locations) {
+    std::string msg;
+    raw_string_ostream msgStream(msg);
+    msgStream << "lowered as ";
+    PrintCounts(msgStream, location.counts, NumKinds);
+    emitOptimizationRemarkAnalysis(context, "rv", func, location.loc, msgStream.str());
+  }
+
+  std::string msg;
+  raw_string_ostream msgStream(msg);
+  msgStream << "vector code of " << func.getName() << ": ";
+  PrintCounts(msgStream, totals, NumKinds);
+  emitOptimizationRemarkAnalysis(context, "rv", func, DebugLoc(), msgStream.str());
+}
+
+}
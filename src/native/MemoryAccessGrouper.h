@@ -10,6 +10,9 @@
 #ifndef RV_MEMORYACCESSGROUPER_H
 #define RV_MEMORYACCESSGROUPER_H
 
+#include <map>
+#include <vector>
+
 #include <llvm/Analysis/ScalarEvolution.h>
 #include <llvm/Analysis/MemoryDependenceAnalysis.h>
 
@@ -45,6 +48,12 @@ namespace native {
     MemoryGroup getMemoryGroup(const llvm::SCEV *scev);
   };
 
+  // strided memory accesses with constant offsets to each other (one interleaved access)
+  struct InterleaveGroup {
+    MemoryGroup memGroup;
+    std::map<const llvm::SCEV *, llvm::Instruction *> members;
+  };
+
   class InstructionGroup {
     bool isStoreGroup;
     llvm::Type *groupType;
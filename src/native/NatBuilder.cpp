@@ -11,6 +11,9 @@
 
 #include <llvm/ADT/PostOrderIterator.h>
 #include <llvm/IR/Module.h>
+#include <llvm/IR/IntrinsicInst.h>
+#include <llvm/Support/ErrorHandling.h>
+#include <llvm/Support/MathExtras.h>
 
 #include "NatBuilder.h"
 #include "Utils.h"
@@ -33,9 +36,75 @@ NatBuilder::getShape(const Value & val) {
   else return VectorShape::uni();
 }
 
+// unrolled cascades test every lane and grow by two blocks per lane, a loop over the active lanes is smaller and
+// skips inactive lanes. Auto keeps the unrolled cascades until the cost model weighs both lowerings.
+static bool
+UseActiveLaneLoops(LaneIteration laneIteration) {
+  return laneIteration == LaneIteration::Loop;
+}
+
+// loop over the active lanes of the <W x i1> mask @vecMask
+//   header: bits = phi [bitcast(vecMask), entry], [bits & (bits - 1), latch]
+//           carried = phi [carriedInit, entry], [carriedNext, latch]
+//           br (bits != 0), body, exit
+//   body:   lane = cttz(bits)
+struct ActiveLaneLoop {
+  BasicBlock *header;
+  BasicBlock *exit;
+  PHINode *bits;
+  PHINode *carried;
+  Value *lane;
+};
+
+// emit the loop header and position @builder in the loop body
+static ActiveLaneLoop
+OpenActiveLaneLoop(IRBuilder<> &builder, Value &vecMask, Value *carriedInit) {
+  LLVMContext &context = builder.getContext();
+  BasicBlock *entry = builder.GetInsertBlock();
+  Function *func = entry->getParent();
+  Type *bitsTy = Type::getIntNTy(context, vecMask.getType()->getVectorNumElements());
+
+  ActiveLaneLoop loop;
+  Value *initBits = builder.CreateBitCast(&vecMask, bitsTy, "lane_bits_init");
+  loop.header = BasicBlock::Create(context, "active_lane_header", func);
+  BasicBlock *body = BasicBlock::Create(context, "active_lane_body", func);
+  loop.exit = BasicBlock::Create(context, "active_lane_end", func);
+  builder.CreateBr(loop.header);
+
+  builder.SetInsertPoint(loop.header);
+  loop.bits = builder.CreatePHI(bitsTy, 2, "lane_bits");
+  loop.bits->addIncoming(initBits, entry);
+  loop.carried = nullptr;
+  if (carriedInit) {
+    loop.carried = builder.CreatePHI(carriedInit->getType(), 2, "lane_res");
+    loop.carried->addIncoming(carriedInit, entry);
+  }
+  Value *anyLeft = builder.CreateICmpNE(loop.bits, ConstantInt::get(bitsTy, 0), "lanes_left");
+  builder.CreateCondBr(anyLeft, body, loop.exit);
+
+  builder.SetInsertPoint(body);
+  Function *cttzDecl = Intrinsic::getDeclaration(func->getParent(), Intrinsic::cttz, bitsTy);
+  Value *laneIdx = builder.CreateCall(cttzDecl, {loop.bits, builder.getTrue()}, "lane_idx");
+  loop.lane = builder.CreateZExtOrTrunc(laneIdx, builder.getInt32Ty(), "lane");
+  return loop;
+}
+
+// clear the current lane, branch back to the header and position @builder in the exit block
+static void
+CloseActiveLaneLoop(IRBuilder<> &builder, ActiveLaneLoop &loop, Value *carriedNext) {
+  BasicBlock *latch = builder.GetInsertBlock();
+  Value *bitsMinusOne = builder.CreateSub(loop.bits, ConstantInt::get(loop.bits->getType(), 1));
+  Value *nextBits = builder.CreateAnd(loop.bits, bitsMinusOne, "lane_bits_next");
+  builder.CreateBr(loop.header);
+
+  loop.bits->addIncoming(nextBits, latch);
+  if (loop.carried) loop.carried->addIncoming(carriedNext, latch);
+  builder.SetInsertPoint(loop.exit);
+}
+
 NatBuilder::NatBuilder(PlatformInfo &platformInfo, VectorizationInfo &vectorizationInfo,
                        const DominatorTree &dominatorTree, MemoryDependenceAnalysis &memDepAnalysis,
-                       ScalarEvolution &SE, ReductionAnalysis & _reda) :
+                       ScalarEvolution &SE, ReductionAnalysis & _reda, LaneIteration laneIteration) :
     builder(vectorizationInfo.getMapping().vectorFn->getContext()),
     platformInfo(platformInfo),
     vectorizationInfo(vectorizationInfo),
@@ -48,16 +117,20 @@ NatBuilder::NatBuilder(PlatformInfo &platformInfo, VectorizationInfo &vectorizat
     i32Ty(IntegerType::get(vectorizationInfo.getMapping().vectorFn->getContext(), 32)),
     region(vectorizationInfo.getRegion()),
     useScatterGatherIntrinsics(true),
-    vectorizeInterleavedAccess(false),
+    vectorizeInterleavedAccess(true),
+    useMaskRegisters(platformInfo.hasAVX512(vectorizationInfo.getScalarFunction())),
+    useActiveLaneLoops(UseActiveLaneLoops(laneIteration)),
     cascadeLoadMap(),
     cascadeStoreMap(),
     vectorValueMap(),
     scalarValueMap(),
     basicBlockMap(),
-    grouperMap(),
+    interleaveGroups(),
+    interleaveGroupIndex(),
     phiVector(),
-    willNotVectorize(),
-    lazyInstructions() {}
+    lazyInstructions(),
+    decisions(),
+    decisionIndex() {}
 
 void NatBuilder::vectorize() {
   const Function *func = vectorizationInfo.getMapping().scalarFn;
@@ -94,6 +167,7 @@ void NatBuilder::vectorize() {
   }
 
   // traverse dominator tree in pre-order to ensure all uses have definitions vectorized first
+  std::vector<BasicBlock *> blockOrder;
   std::deque<const DomTreeNode *> nodeQueue;
   const DomTreeNode *rootNode = region ? dominatorTree.getNode(&region->getRegionEntry()) : dominatorTree.getRootNode();
   nodeQueue.push_back(rootNode);
@@ -102,12 +176,9 @@ void NatBuilder::vectorize() {
     const DomTreeNode *node = nodeQueue.front();
     nodeQueue.pop_front();
 
-    // vectorize
     BasicBlock *bb = node->getBlock();
     if (region && !region->contains(bb)) continue;
-
-    BasicBlock *vecBlock = cast<BasicBlock>(getVectorValue(bb));
-    vectorize(bb, vecBlock);
+    blockOrder.push_back(bb);
 
     // populate queue with pre-order dominators
     for (auto it = node->getChildren().begin(), et = node->getChildren().end(); it != et; ++it) {
@@ -115,12 +186,23 @@ void NatBuilder::vectorize() {
     }
   }
 
+  // decide how every instruction is lowered (uses see the decisions of their operands)
+  computeDecisions(blockOrder);
+  IF_DEBUG_NAT { dumpDecisions(errs()); }
+
+  // vectorize
+  for (BasicBlock *bb : blockOrder) {
+    BasicBlock *vecBlock = cast<BasicBlock>(getVectorValue(bb));
+    vectorize(bb, vecBlock);
+  }
+
   // revisit PHINodes now and add the mapped incoming values
   if (!phiVector.empty()) addValuesToPHINodes();
 
   if (!region) return;
 
-  // TODO what about outside uses?
+  // remap outside uses (reductions were materialized with the phis)
+  remapOutsideUses();
 
   // rewire branches outside the region to go to the region instead
   std::vector<BasicBlock *> oldBlocks;
@@ -152,6 +234,9 @@ void NatBuilder::vectorize() {
 void NatBuilder::vectorize(BasicBlock *const bb, BasicBlock *vecBlock) {
   assert(vecBlock && "no block to insert vector code");
   builder.SetInsertPoint(vecBlock);
+
+  // lazy memory accesses of this block may be merged into interleaved groups
+  if (vectorizeInterleavedAccess) groupMemoryAccesses(*bb);
   for (BasicBlock::iterator it = bb->begin(), ie = bb->end(); it != ie; ++it) {
     Instruction *inst = &*it;
 
@@ -172,7 +257,7 @@ void NatBuilder::vectorize(BasicBlock *const bb, BasicBlock *vecBlock) {
 
     // loads and stores need special treatment (masking, shuffling, etc) (build them lazily)
     if (canVectorize(inst) && (load || store))
-      if (vectorizeInterleavedAccess) lazyInstructions.push_back(inst);
+      if (getDecision(inst)->lazy) lazyInstructions.push_back(inst);
       else vectorizeMemoryInstruction(inst);
     else if (call) {
       // calls need special treatment
@@ -185,7 +270,7 @@ void NatBuilder::vectorize(BasicBlock *const bb, BasicBlock *vecBlock) {
       else if (call->getCalledFunction()->getName() == "rv_ballot")
         vectorizeBallotCall(call);
       else
-        if (vectorizeInterleavedAccess) lazyInstructions.push_back(inst);
+        if (getDecision(inst)->lazy) lazyInstructions.push_back(inst);
         else {
           if (shouldVectorize(call))
             vectorizeCallInstruction(call);
@@ -411,6 +496,7 @@ void NatBuilder::fallbackVectorize(Instruction *const inst) {
   // map operands into instruction
   // if !void: insert into result vector
   // repeat from line 3 for all lanes
+  countLowering(LoweringKind::Fallback, *inst);
   Type *type = inst->getType();
   bool notVectorTy = type->isVoidTy() || !(type->isIntegerTy() || type->isFloatingPointTy());
   Value *resVec = notVectorTy ? nullptr : UndefValue::get(
@@ -500,10 +586,18 @@ NatBuilder::vectorizeBallotCall(CallInst *rvCall) {
   Module *mod = vectorizationInfo.getMapping().vectorFn->getParent();
 
   auto vecWidth = vectorizationInfo.getVectorWidth();
-  assert((vecWidth == 4 || vecWidth == 8) && "rv_ballot only supports SSE and AVX instruction sets");
 
 // non-uniform arg
   auto * vecVal = maskInactiveLanes(requestVectorValue(condArg), rvCall->getParent(), false);
+
+// mask registers hold the ballot already, widths other than SSE and AVX use the bit cast of the mask as well
+  if ((useMaskRegisters || (vecWidth != 4 && vecWidth != 8)) && vecWidth <= 32) {
+    auto * maskBits = builder.CreateBitCast(vecVal, builder.getIntNTy(vecWidth), "rv_ballot");
+    mapScalarValue(rvCall, builder.CreateZExtOrTrunc(maskBits, i32Ty, "rv_ballot"));
+    return;
+  }
+
+  assert((vecWidth == 4 || vecWidth == 8) && "rv_ballot supports at most 32 lanes");
   auto * intVecTy = VectorType::get(i32Ty, vecWidth);
 
   auto * extVal = builder.CreateSExt(vecVal, intVecTy, "rv_ballot");
@@ -519,12 +613,67 @@ static bool HasSideEffects(CallInst &call) {
   return call.mayHaveSideEffects();
 }
 
+// call the vector function ABI variant @mapping with one vector call for all lanes
+void NatBuilder::vectorizeCallWithVariant(CallInst *const scalCall, const VectorMapping &mapping) {
+  Function *simdFunc = mapping.vectorFn;
+  auto *simdFnTy = simdFunc->getFunctionType();
+
+  std::vector<Value *> args;
+  for (unsigned i = 0; i < scalCall->getNumArgOperands(); ++i) {
+    Value *scalArg = scalCall->getArgOperand(i);
+    // uniform and linear arguments are passed as the value of the first lane
+    if (mapping.argShapes[i].isVarying())
+      args.push_back(requestVectorValue(scalArg));
+    else
+      args.push_back(requestScalarValue(scalArg));
+  }
+
+  if (mapping.maskPos >= 0) {
+    Value *predicate = vectorizationInfo.getPredicate(*scalCall->getParent());
+    Value *mask = predicate ? requestVectorValue(predicate)
+                            : Constant::getAllOnesValue(getVectorType(i1Ty, vectorWidth()));
+
+    // the ABI passes the mask as a vector of the characteristic type, all ones for active lanes
+    Type *maskTy = simdFnTy->getParamType(mapping.maskPos);
+    if (maskTy != mask->getType()) {
+      Type *intMaskTy = VectorType::get(builder.getIntNTy(maskTy->getScalarSizeInBits()), vectorWidth());
+      mask = builder.CreateSExt(mask, intMaskTy, "abi_mask");
+      if (maskTy != intMaskTy) mask = builder.CreateBitCast(mask, maskTy, "abi_mask");
+    }
+    args.insert(args.begin() + mapping.maskPos, mask);
+  }
+
+  StringRef callName = simdFnTy->getReturnType()->isVoidTy() ? StringRef() : scalCall->getName();
+  CallInst *call = builder.CreateCall(simdFunc, args, callName);
+  call->setCallingConv(simdFunc->getCallingConv());
+  mapVectorValue(scalCall, call);
+}
+
 void NatBuilder::vectorizeCallInstruction(CallInst *const scalCall) {
   Function *callee = scalCall->getCalledFunction();
   StringRef calleeName = callee->getName();
 
+  // a variant of the vector function ABI (_ZGV..) exists for the shapes of the arguments
+  Value *blockPredicate = vectorizationInfo.getPredicate(*scalCall->getParent());
+  bool predicated = blockPredicate && !isa<Constant>(blockPredicate);
+  VectorShapeVec argShapes;
+  for (unsigned i = 0; i < scalCall->getNumArgOperands(); ++i)
+    argShapes.push_back(getShape(*scalCall->getArgOperand(i)));
+
+  const VectorMapping *variant = platformInfo.getSIMDVariant(*callee, vectorWidth(), argShapes, predicated,
+                                                             vectorizationInfo.getScalarFunction());
+  // unmasked variants may only execute inactive lanes if that is unobservable
+  if (variant && variant->maskPos < 0 && predicated && HasSideEffects(*scalCall))
+    variant = nullptr;
+
+  if (variant) {
+    IF_DEBUG_NAT { errs() << "nat: vector function ABI call " << variant->vectorFn->getName() << "\n"; }
+    countLowering(LoweringKind::VectorCall, *scalCall);
+    vectorizeCallWithVariant(scalCall, *variant);
+
   // is func is vectorizable (standard mapping exists for given vector width), create new call to vector func
-  if (platformInfo.isFunctionVectorizable(calleeName, vectorWidth())) {
+  } else if (platformInfo.isFunctionVectorizable(calleeName, vectorWidth())) {
+    countLowering(LoweringKind::SleefCall, *scalCall);
 
     CallInst *call = cast<CallInst>(scalCall->clone());
     bool doublePrecision = false;
@@ -539,6 +688,7 @@ void NatBuilder::vectorizeCallInstruction(CallInst *const scalCall) {
     builder.Insert(call, scalCall->getName());
 
   } else {
+    countLowering(LoweringKind::ReplicatedCall, *scalCall);
 
     // check if we need cascade first
     Value *predicate = vectorizationInfo.getPredicate(*scalCall->getParent());
@@ -546,6 +696,9 @@ void NatBuilder::vectorizeCallInstruction(CallInst *const scalCall) {
     assert(predicate->getType()->isIntegerTy(1) && "predicate must be i1 type!");
     bool needCascade = !isa<Constant>(predicate) && HasSideEffects(*scalCall);
 
+    if (needCascade && useActiveLaneLoops && replicateCallForActiveLanes(scalCall))
+      return;
+
     // if we need cascading, we need the vectorized predicate and the cascading blocks
     std::vector<BasicBlock *> condBlocks;
     std::vector<BasicBlock *> maskedBlocks;
@@ -628,6 +781,49 @@ void NatBuilder::vectorizeCallInstruction(CallInst *const scalCall) {
   }
 }
 
+// call @scalCall once for every active lane in a loop over the set bits of the predicate
+bool NatBuilder::replicateCallForActiveLanes(CallInst *const scalCall) {
+  Type *callType = scalCall->getType();
+  if (callType->isVectorTy() || callType->isStructTy()) return false;
+
+  // lanes are selected at runtime: varying arguments have to be extracted from vectors
+  for (unsigned i = 0; i < scalCall->getNumArgOperands(); ++i) {
+    Value *scalArg = scalCall->getArgOperand(i);
+    if (!getShape(*scalArg).isUniform() && !VectorType::isValidElementType(scalArg->getType()))
+      return false;
+  }
+
+  std::vector<Value *> laneArgs;
+  for (unsigned i = 0; i < scalCall->getNumArgOperands(); ++i) {
+    Value *scalArg = scalCall->getArgOperand(i);
+    laneArgs.push_back(getShape(*scalArg).isUniform() ? requestScalarValue(scalArg) : requestVectorValue(scalArg));
+  }
+
+  Value *predicate = vectorizationInfo.getPredicate(*scalCall->getParent());
+  Value *vecMask = requestVectorValue(predicate);
+  bool hasResult = !callType->isVoidTy();
+  Value *resInit = hasResult ? UndefValue::get(getVectorType(callType, vectorWidth())) : nullptr;
+
+  ActiveLaneLoop loop = OpenActiveLaneLoop(builder, *vecMask, resInit);
+
+  std::vector<Value *> args;
+  for (unsigned i = 0; i < laneArgs.size(); ++i) {
+    bool isUniform = getShape(*scalCall->getArgOperand(i)).isUniform();
+    args.push_back(isUniform ? laneArgs[i] : builder.CreateExtractElement(laneArgs[i], loop.lane, "lane_arg"));
+  }
+
+  Function *callee = scalCall->getCalledFunction();
+  StringRef callName = hasResult ? scalCall->getName() : StringRef();
+  Value *call = builder.CreateCall(callee, args, callName);
+  Value *resNext = hasResult ? builder.CreateInsertElement(loop.carried, call, loop.lane, "insert_lane") : nullptr;
+
+  CloseActiveLaneLoop(builder, loop, resNext);
+
+  if (hasResult) mapVectorValue(scalCall, loop.carried);
+  mapVectorValue(scalCall->getParent(), loop.exit);
+  return true;
+}
+
 void NatBuilder::copyCallInstruction(CallInst *const scalCall, unsigned laneIdx) {
   // copying call instructions:
   // 1) get scalar callee
@@ -686,10 +882,12 @@ void NatBuilder::vectorizeMemoryInstruction(Instruction *const inst) {
 
   // used for memory-interleaving
   bool isInterleaved = false;
+  bool hasGaps = false;
+  unsigned interleaveFactor = 0;
   MemoryGroup memGroup;
   std::map<const SCEV *, Instruction *> scevInstrMap;
   std::vector<Value *> sourceAddrs;
-  std::vector<Value *> sources;
+  std::vector<Instruction *> sources;
 
   if (addrShape.isContiguous() || byteContiguous) {
     // cast pointer to vector-width pointer
@@ -703,75 +901,52 @@ void NatBuilder::vectorizeMemoryInstruction(Instruction *const inst) {
     alignment = instrShape.getAlignmentFirst();
 
   } else if (addrShape.isStrided()) {
-    // group memory instructions based on their dependencies
-    InstructionGrouper instructionGrouper;
-    instructionGrouper.add(inst, memDepAnalysis);
-    for (Instruction *instr : lazyInstructions) {
-      instructionGrouper.add(instr, memDepAnalysis);
-    }
-    InstructionGroup instrGroup = instructionGrouper.getInstructionGroup(inst);
-    if (instrGroup.size() > 1) {
-      // group our group based on memory layout next
-      MemoryAccessGrouper memoryGrouper(SE, static_cast<unsigned>(layout.getTypeStoreSize(accessedType)));
-      std::map<Value *, const SCEV *> addrSCEVMap;
-      for (Instruction *instr : instrGroup) {
-        Value *addrVal = getPointerOperand(instr);
-        assert(addrVal && "grouped instruction was not a memory instruction!!");
-        // only group strided accesses
-        VectorShape shape = getShape(*addrVal);
-        bool groupByteContiguous = addrShape.isStrided(static_cast<int>(layout.getTypeStoreSize(cast<PointerType>(accessedPtr->getType())->getElementType())));
-        if (!shape.isStrided() || groupByteContiguous)
-          continue;
-        const SCEV *scev = memoryGrouper.add(addrVal);
-        addrSCEVMap[addrVal] = scev;
-        scevInstrMap[scev] = instr;
-      }
-
-      // check if there is an interleaved memory group for our base address
-      memGroup = memoryGrouper.getMemoryGroup(addrSCEVMap[accessedPtr]);
-      int stride = addrShape.getStride() / (accessedType->getScalarSizeInBits() / 8);
-      bool hasGaps = false;
+    // look up the interleave group computed for this block
+    const InterleaveGroup *group = getInterleaveGroup(inst);
+    if (group && isInterleaveGroupPending(*group, inst)) {
+      memGroup = group->memGroup;
+      scevInstrMap = group->members;
+      unsigned laneByteSize = static_cast<unsigned>(layout.getTypeStoreSize(accessedType));
+
+      // every lane accesses <factor> consecutive elements (array elements or struct fields of the same type)
+      int byteStride = addrShape.getStride();
+      interleaveFactor = byteStride > 0 && byteStride % laneByteSize == 0 ? byteStride / laneByteSize : 0;
+
+      // members that are not accessed are gaps in the group
+      hasGaps = memGroup.size() < interleaveFactor;
       for (unsigned i = 0; i < memGroup.size(); ++i) {
-        if (!memGroup[i]) {
-          hasGaps = true;
-          break;
-        }
+        if (!memGroup[i]) hasGaps = true;
       }
 
-      // we have found a memory group if it has no gaps and the size is bigger than 1
-      isInterleaved = !hasGaps && memGroup.size() > 1 && static_cast<int>(memGroup.size()) == stride;
+      isInterleaved = memGroup.size() > 1 && interleaveFactor >= memGroup.size() &&
+                      interleaveFactor <= vectorWidth();
 
-      // TODO: support interleaved for structs
-      if (isStructAccess(accessedPtr))
+      // gaps and inactive lanes must not be accessed
+      if (isInterleaved && (needsMask || hasGaps) && !isLegalMaskedMemory(vecType, load != nullptr))
         isInterleaved = false;
+
+      if (isInterleaved) {
+        std::vector<unsigned> memberIndices;
+        for (unsigned i = 0; i < memGroup.size(); ++i) {
+          if (memGroup[i]) memberIndices.push_back(i);
+        }
+        isInterleaved = isInterleavedAccessProfitable(*inst, accessedType, interleaveFactor, memberIndices, needsMask || hasGaps);
+      }
     }
 
     if (isInterleaved) {
-      // build as many contiguous GEPs as there are members of the group and shuffle them
-      unsigned offset = 0;
-      unsigned maskIdx = 0;
-      for (auto SCEV : memGroup) {
-        Instruction *sourceMem = scevInstrMap[SCEV];
+      // one vector per member, starting at the address of the first member in lane 0
+      for (unsigned i = 0; i < interleaveFactor; ++i) {
+        Instruction *sourceMem = i < memGroup.size() && memGroup[i] ? scevInstrMap[memGroup[i]] : nullptr;
         sources.push_back(sourceMem);
-        assert(sourceMem && "no source instruction available for this SCEV");
-        if (!offset)
-          accessedPtr = getPointerOperand(sourceMem);
-        Value *mappedPtr;
-
-        // generate scalar gep on the fly (because we need offsets)
-        if (isa<GetElementPtrInst>(accessedPtr))
-          mappedPtr = vectorizeGEPInstruction(cast<GetElementPtrInst>(accessedPtr), false, offset, true);
-        else {
-          mappedPtr = requestScalarValue(accessedPtr);
-          if (offset > 0)
-            mappedPtr = builder.CreateGEP(mappedPtr, ConstantInt::get(i32Ty, offset, true));
-        }
-        PointerType *vecPtrType = PointerType::getUnqual(vecType);
-        vecPtr = builder.CreatePointerCast(mappedPtr, vecPtrType, "vec_cast");
-        sourceAddrs.push_back(vecPtr);
+      }
+      assert(sources[0] && "interleaved group does not start with a member");
 
-        offset += vectorWidth();
-        ++maskIdx;
+      Value *basePtr = requestScalarValue(getPointerOperand(sources[0]));
+      basePtr = builder.CreatePointerCast(basePtr, PointerType::getUnqual(accessedType), "interleaved_base");
+      for (unsigned i = 0; i < interleaveFactor; ++i) {
+        Value *chunkPtr = i == 0 ? basePtr : builder.CreateGEP(basePtr, ConstantInt::get(i32Ty, i * vectorWidth()));
+        sourceAddrs.push_back(builder.CreatePointerCast(chunkPtr, PointerType::getUnqual(vecType), "vec_cast"));
       }
     }
 
@@ -800,29 +975,18 @@ void NatBuilder::vectorizeMemoryInstruction(Instruction *const inst) {
   Value *vecMem = nullptr;
   if (load) {
     if (isInterleaved) {
-      ShuffleBuilder maskShuffler(vectorWidth());
-      if (needsMask) {
-        mask = requestVectorValue(predicate);
-        for (unsigned i = 0; needsMask && i < memGroup.size(); ++i) {
-          maskShuffler.add(mask);
-        }
-      }
+      std::vector<Value *> masks = createInterleavedMasks(sources, predicate, needsMask || hasGaps);
 
       assert(sourceAddrs.size() == sources.size() && "too few or too many sources!");
 
+      unsigned baseAlignment = getInterleavedAlignment(*sources[0]);
       std::vector<Value *> loads;
       for (unsigned i = 0; i < sources.size(); ++i) {
-        Value *sourceLoad = sources[i];
-
-        // need to recompute alignment
-        alignment = getShape(*sourceLoad).getAlignmentFirst();
-        origAlignment = cast<LoadInst>(sourceLoad)->getAlignment();
-        alignment = std::max<uint>(origAlignment, alignment);
+        alignment = MinAlign(baseAlignment, i * vectorWidth() * layout.getTypeStoreSize(accessedType));
 
         vecPtr = sourceAddrs[i];
-        if (needsMask) {
-          mask = maskShuffler.shuffleToInterleaved(builder, memGroup.size(), i);
-          loads.push_back(builder.CreateMaskedLoad(vecPtr, alignment, mask, nullptr, "interleaved_load"));
+        if (!masks.empty()) {
+          loads.push_back(builder.CreateMaskedLoad(vecPtr, alignment, masks[i], nullptr, "interleaved_load"));
         } else {
           Value *interLoad = builder.CreateLoad(vecPtr, "interleaved_load");
           cast<LoadInst>(interLoad)->setAlignment(alignment);
@@ -832,13 +996,15 @@ void NatBuilder::vectorizeMemoryInstruction(Instruction *const inst) {
 
       assert(loads.size() == sources.size() && "not enough interleaved loads");
 
-      // create as many shuffles as there are loads
+      // create one shuffle per member of the group
       ShuffleBuilder shuffleBuilder(loads, vectorWidth());
       unsigned stride = static_cast<unsigned>(loads.size());
       for (unsigned i = 0; i < sources.size(); ++i) {
-        // start = 0, stride = sources.size
+        if (!sources[i]) continue;
+        // start = i, stride = sources.size
         Value *shuffle = shuffleBuilder.shuffleFromInterleaved(builder, stride, i);
         mapVectorValue(sources[i], shuffle);
+        countLowering(LoweringKind::InterleavedLoad, *sources[i]);
       }
 
       // early return because everything is done
@@ -876,6 +1042,7 @@ void NatBuilder::vectorizeMemoryInstruction(Instruction *const inst) {
       std::string name = addrShape.isUniform() ? "scal_load" : "vec_load";
       vecMem = builder.CreateLoad(vecPtr, name);
       cast<LoadInst>(vecMem)->setAlignment(alignment);
+      if (!addrShape.isUniform()) countLowering(LoweringKind::ContiguousLoad, *inst);
 
     } else {
 
@@ -893,11 +1060,20 @@ void NatBuilder::vectorizeMemoryInstruction(Instruction *const inst) {
           Function *gatherIntr = Intrinsic::getDeclaration(mod, Intrinsic::masked_gather, vecType);
           assert(gatherIntr && "masked gather not found!");
           vecMem = builder.CreateCall(gatherIntr, args, "gather");
-        } else
+          countLowering(LoweringKind::Gather, *inst);
+        } else {
           vecMem = requestCascadeLoad(vecPtr, alignment, mask);
+          countLowering(LoweringKind::CascadeLoad, *inst);
+        }
 
-      } else
+      } else if (isLegalMaskedMemory(vecType, true)) {
         vecMem = builder.CreateMaskedLoad(vecPtr, alignment, mask, 0, "masked_vec_load");
+        countLowering(LoweringKind::MaskedLoad, *inst);
+      } else {
+        // no native masked loads on this target
+        vecMem = requestCascadeLoad(createLanePointers(vecPtr, accessedType), MinAlign(alignment, layout.getTypeStoreSize(accessedType)), mask);
+        countLowering(LoweringKind::CascadeLoad, *inst);
+      }
     }
   } else {
 
@@ -905,21 +1081,19 @@ void NatBuilder::vectorizeMemoryInstruction(Instruction *const inst) {
                                                    : requestVectorValue(storedValue);
 
     if (isInterleaved) {
-      ShuffleBuilder maskShuffler(vectorWidth());
-      if (needsMask) {
-        mask = requestVectorValue(predicate);
-        for (unsigned i = 0; needsMask && i < memGroup.size(); ++i) {
-          maskShuffler.add(mask);
-        }
-      }
+      std::vector<Value *> masks = createInterleavedMasks(sources, predicate, needsMask || hasGaps);
 
       assert(sourceAddrs.size() == sources.size() && "too few or too many sources!");
 
-      // shuffle the source values
+      // shuffle the source values, gaps are masked out
       ShuffleBuilder shuffleBuilder(vectorWidth());
       unsigned stride = static_cast<unsigned>(sources.size());
       for (unsigned i = 0; i < sources.size(); ++i) {
         Value *sourceStore = sources[i];
+        if (!sourceStore) {
+          shuffleBuilder.add(UndefValue::get(vecType));
+          continue;
+        }
         storedValue = cast<StoreInst>(sourceStore)->getValueOperand();
         mappedStoredVal = requestVectorValue(storedValue);
         shuffleBuilder.add(mappedStoredVal);
@@ -927,29 +1101,27 @@ void NatBuilder::vectorizeMemoryInstruction(Instruction *const inst) {
 
       std::vector<Value *> valShuffles;
       for (unsigned i = 0; i < sources.size(); ++i) {
-        // start = 0, stride = sources.size
+        // start = i, stride = sources.size
         valShuffles.push_back(shuffleBuilder.shuffleToInterleaved(builder, stride, i));
       }
 
+      unsigned baseAlignment = getInterleavedAlignment(*sources[0]);
       for (unsigned i = 0; i < sources.size(); ++i) {
-        Value *sourceStore = sources[i];
-
-        // need to recompute alignment
-        alignment = getShape(*sourceStore).getAlignmentFirst();
-        origAlignment = cast<StoreInst>(sourceStore)->getAlignment();
-        alignment = std::max<uint>(origAlignment, alignment);
+        alignment = MinAlign(baseAlignment, i * vectorWidth() * layout.getTypeStoreSize(accessedType));
 
         vecPtr = sourceAddrs[i];
         mappedStoredVal = valShuffles[i];
-        if (needsMask) {
-          mask = maskShuffler.shuffleToInterleaved(builder, stride, i);
-          vecMem = builder.CreateMaskedStore(mappedStoredVal, vecPtr, alignment, mask);
+        if (!masks.empty()) {
+          vecMem = builder.CreateMaskedStore(mappedStoredVal, vecPtr, alignment, masks[i]);
         } else {
           vecMem = builder.CreateStore(mappedStoredVal, vecPtr);
           cast<StoreInst>(vecMem)->setAlignment(alignment);
         }
 
-        mapVectorValue(sourceStore, vecMem);
+        if (sources[i]) {
+          mapVectorValue(sources[i], vecMem);
+          countLowering(LoweringKind::InterleavedStore, *sources[i]);
+        }
       }
 
       // early return because everything is done
@@ -980,6 +1152,7 @@ void NatBuilder::vectorizeMemoryInstruction(Instruction *const inst) {
     } else if ((addrShape.isUniform() || addrShape.isContiguous() || byteContiguous) && !needsMask) {
       vecMem = builder.CreateStore(mappedStoredVal, vecPtr);
       cast<StoreInst>(vecMem)->setAlignment(alignment);
+      if (!addrShape.isUniform()) countLowering(LoweringKind::ContiguousStore, *inst);
 
     } else {
       if (needsMask) mask = requestVectorValue(predicate);
@@ -996,11 +1169,20 @@ void NatBuilder::vectorizeMemoryInstruction(Instruction *const inst) {
           Function *scatterIntr = Intrinsic::getDeclaration(mod, Intrinsic::masked_scatter, vecType);
           assert(scatterIntr && "masked scatter not found!");
           vecMem = builder.CreateCall(scatterIntr, args);
-        } else
+          countLowering(LoweringKind::Scatter, *inst);
+        } else {
           vecMem = requestCascadeStore(mappedStoredVal, vecPtr, alignment, mask);
+          countLowering(LoweringKind::CascadeStore, *inst);
+        }
 
-      } else
+      } else if (isLegalMaskedMemory(vecType, false)) {
         vecMem = builder.CreateMaskedStore(mappedStoredVal, vecPtr, alignment, mask);
+        countLowering(LoweringKind::MaskedStore, *inst);
+      } else {
+        // no native masked stores on this target
+        vecMem = requestCascadeStore(mappedStoredVal, createLanePointers(vecPtr, accessedType), MinAlign(alignment, layout.getTypeStoreSize(accessedType)), mask);
+        countLowering(LoweringKind::CascadeStore, *inst);
+      }
     }
   }
 
@@ -1010,16 +1192,83 @@ void NatBuilder::vectorizeMemoryInstruction(Instruction *const inst) {
     mapVectorValue(inst, vecMem);
 }
 
+void NatBuilder::groupMemoryAccesses(BasicBlock &bb) {
+  interleaveGroups.clear();
+  interleaveGroupIndex.clear();
+
+  // group the deferred instructions of the block based on their dependencies (in program order)
+  InstructionGrouper instructionGrouper;
+  for (Instruction &inst : bb) {
+    const Decision *decision = getDecision(&inst);
+    if (decision && decision->lazy) instructionGrouper.add(&inst, memDepAnalysis);
+  }
+
+  // group each group based on memory layout next (strided accesses of 4 and 8 byte elements)
+  for (InstructionGroup &instrGroup : instructionGrouper.instructionGroups) {
+    if (instrGroup.size() < 2) continue;
+
+    Instruction *first = *instrGroup.begin();
+    if (!isa<LoadInst>(first) && !isa<StoreInst>(first)) continue;
+    Value *firstPtr = getPointerOperand(first);
+    Type *accessedType = cast<PointerType>(firstPtr->getType())->getElementType();
+    unsigned laneByteSize = static_cast<unsigned>(layout.getTypeStoreSize(accessedType));
+    if (laneByteSize != 4 && laneByteSize != 8) continue;
+
+    MemoryAccessGrouper memoryGrouper(SE, laneByteSize);
+    std::map<const SCEV *, Instruction *> scevInstrMap;
+    for (Instruction *instr : instrGroup) {
+      Value *addrVal = getPointerOperand(instr);
+      assert(addrVal && "grouped instruction was not a memory instruction!!");
+      // only group strided accesses
+      VectorShape shape = getShape(*addrVal);
+      if (!shape.isStrided() || shape.isStrided(static_cast<int>(laneByteSize)))
+        continue;
+      scevInstrMap[memoryGrouper.add(addrVal)] = instr;
+    }
+
+    for (MemoryGroup &memGroup : memoryGrouper.memoryGroups) {
+      if (memGroup.size() < 2) continue;
+
+      InterleaveGroup group;
+      group.memGroup = memGroup;
+      for (unsigned i = 0; i < memGroup.size(); ++i) {
+        if (!memGroup[i]) continue;
+        Instruction *member = scevInstrMap[memGroup[i]];
+        group.members[memGroup[i]] = member;
+        interleaveGroupIndex[member] = interleaveGroups.size();
+      }
+      interleaveGroups.push_back(group);
+    }
+  }
+}
+
+const InterleaveGroup *NatBuilder::getInterleaveGroup(const Instruction *inst) const {
+  auto it = interleaveGroupIndex.find(inst);
+  if (it == interleaveGroupIndex.end()) return nullptr;
+  return &interleaveGroups[it->second];
+}
+
+bool NatBuilder::isInterleaveGroupPending(const InterleaveGroup &group, const Instruction *inst) const {
+  // all members are emitted together: none of them may have been generated or still be unvisited
+  for (auto &it : group.members) {
+    if (it.second != inst && !lazyInstructions.contains(it.second)) return false;
+  }
+  return true;
+}
+
 void NatBuilder::requestLazyInstructions(Instruction *const upToInstruction) {
   assert(!lazyInstructions.empty() && "no lazy instructions to generate!");
 
-  Instruction *lazyInstr = lazyInstructions.front();
-  lazyInstructions.pop_front();
+  Instruction *lazyInstr = lazyInstructions.pop_front();
 
   while (lazyInstr != upToInstruction) {
     // skip if already generated (only happens for interleaving)
-    if (getVectorValue(lazyInstr))
+    if (getVectorValue(lazyInstr)) {
+      if (lazyInstructions.empty())
+        return;
+      lazyInstr = lazyInstructions.pop_front();
       continue;
+    }
 
     assert(!getVectorValue(lazyInstr) && !getScalarValue(lazyInstr) && "instruction already generated!");
 
@@ -1039,8 +1288,7 @@ void NatBuilder::requestLazyInstructions(Instruction *const upToInstruction) {
     if (lazyInstructions.empty())
       return;
 
-    lazyInstr = lazyInstructions.front();
-    lazyInstructions.pop_front();
+    lazyInstr = lazyInstructions.pop_front();
   }
 
   // if we reach this point this should be guaranteed:
@@ -1064,7 +1312,7 @@ void NatBuilder::requestLazyInstructions(Instruction *const upToInstruction) {
 Value *NatBuilder::requestVectorValue(Value *const value) {
   if (isa<Instruction>(value)) {
     Instruction *lazyMemInstr = cast<Instruction>(value);
-    if (std::find(lazyInstructions.begin(), lazyInstructions.end(), lazyMemInstr) != lazyInstructions.end())
+    if (lazyInstructions.contains(lazyMemInstr))
       requestLazyInstructions(lazyMemInstr);
   }
 
@@ -1127,7 +1375,7 @@ Value *NatBuilder::requestVectorValue(Value *const value) {
 Value *NatBuilder::requestScalarValue(Value *const value, unsigned laneIdx, bool skipMappingWhenDone) {
   if (isa<Instruction>(value)) {
     Instruction *lazyMemInstr = cast<Instruction>(value);
-    if (std::find(lazyInstructions.begin(), lazyInstructions.end(), lazyMemInstr) != lazyInstructions.end())
+    if (lazyInstructions.contains(lazyMemInstr))
       requestLazyInstructions(lazyMemInstr);
   }
 
@@ -1212,6 +1460,78 @@ Value *NatBuilder::requestScalarValue(Value *const value, unsigned laneIdx, bool
   return reqVal;
 }
 
+bool NatBuilder::isLegalMaskedMemory(Type *vecType, bool isLoad) {
+  return platformInfo.isLegalMaskedMemory(vectorizationInfo.getScalarFunction(), vecType, isLoad);
+}
+
+bool NatBuilder::isInterleavedAccessProfitable(Instruction &inst, Type *accessedType, unsigned factor,
+                                               ArrayRef<unsigned> memberIndices, bool masked) {
+  TargetTransformInfo *TTI = platformInfo.getTTI();
+  if (!TTI) return true;
+
+  bool isLoad = isa<LoadInst>(inst);
+  unsigned opcode = inst.getOpcode();
+  unsigned alignment = isLoad ? cast<LoadInst>(inst).getAlignment() : cast<StoreInst>(inst).getAlignment();
+  unsigned addrSpace = cast<PointerType>(getPointerOperand(&inst)->getType())->getAddressSpace();
+  Type *vecType = getVectorType(accessedType, vectorWidth());
+  Type *wideType = getVectorType(accessedType, vectorWidth() * factor);
+
+  // wide accesses + shuffles
+  int interleavedCost = TTI->getInterleavedMemoryOpCost(opcode, wideType, factor, memberIndices, alignment, addrSpace);
+  if (masked) {
+    int maskedCost = TTI->getMaskedMemoryOpCost(opcode, vecType, alignment, addrSpace);
+    int plainCost = TTI->getMemoryOpCost(opcode, vecType, alignment, addrSpace);
+    interleavedCost += factor * std::max(0, maskedCost - plainCost);
+  }
+
+  // one gather/scatter per member
+  int laneCost = TTI->getMemoryOpCost(opcode, accessedType, alignment, addrSpace) +
+                 TTI->getAddressComputationCost(vecType, true);
+  int gatherCost = memberIndices.size() * vectorWidth() * laneCost;
+
+  IF_DEBUG_NAT { errs() << "nat: interleaved group of " << memberIndices.size() << "/" << factor
+                        << ": cost " << interleavedCost << " vs. " << gatherCost << " (gather/scatter)\n"; }
+  return interleavedCost <= gatherCost;
+}
+
+std::vector<Value *> NatBuilder::createInterleavedMasks(ArrayRef<Instruction *> sources, Value *predicate, bool masked) {
+  std::vector<Value *> masks;
+  if (!masked) return masks;
+
+  // the predicate for every present member, all-false for gaps, interleaved like the data
+  Value *activeMask = isa<Constant>(predicate) ? ConstantVector::getSplat(vectorWidth(), builder.getTrue())
+                                               : requestVectorValue(predicate);
+  Value *gapMask = Constant::getNullValue(activeMask->getType());
+
+  ShuffleBuilder maskShuffler(vectorWidth());
+  for (Instruction *source : sources) {
+    maskShuffler.add(source ? activeMask : gapMask);
+  }
+
+  unsigned stride = static_cast<unsigned>(sources.size());
+  for (unsigned i = 0; i < sources.size(); ++i) {
+    masks.push_back(maskShuffler.shuffleToInterleaved(builder, stride, i));
+  }
+  return masks;
+}
+
+unsigned NatBuilder::getInterleavedAlignment(Instruction &source) {
+  unsigned origAlignment = isa<LoadInst>(source) ? cast<LoadInst>(source).getAlignment()
+                                                 : cast<StoreInst>(source).getAlignment();
+  return std::max<uint>(origAlignment, getShape(source).getAlignmentFirst());
+}
+
+Value *NatBuilder::createLanePointers(Value *vecPtr, Type *accessedType) {
+  // vector of the element addresses covered by the vector-width pointer
+  Value *basePtr = builder.CreatePointerCast(vecPtr, PointerType::getUnqual(accessedType), "lane_base");
+  Value *lanePtrs = UndefValue::get(getVectorType(basePtr->getType(), vectorWidth()));
+  for (unsigned i = 0; i < vectorWidth(); ++i) {
+    Value *lanePtr = builder.CreateGEP(basePtr, ConstantInt::get(i32Ty, i), "lane_ptr");
+    lanePtrs = builder.CreateInsertElement(lanePtrs, lanePtr, ConstantInt::get(i32Ty, i));
+  }
+  return lanePtrs;
+}
+
 Value *NatBuilder::requestCascadeLoad(Value *vecPtr, unsigned alignment, Value *mask) {
   Type *elementPtrType = cast<VectorType>(vecPtr->getType())->getElementType();
   Type *accessedType = cast<PointerType>(elementPtrType)->getElementType();
@@ -1313,6 +1633,29 @@ Function *NatBuilder::createCascadeMemory(VectorType *pointerVectorType, unsigne
   ptrVec->setName("ptrVec");
   mask->setName("mask");
 
+  if (useActiveLaneLoops) {
+    // for each active lane l of m: r.l = *(a.l) (or *(a.l) = v.l)
+    builder.SetInsertPoint(BasicBlock::Create(mod->getContext(), "entry", func));
+    Value *resInit = store ? nullptr : UndefValue::get(resType);
+    ActiveLaneLoop loop = OpenActiveLaneLoop(builder, *mask, resInit);
+
+    Value *pointerLaneVal = builder.CreateExtractElement(ptrVec, loop.lane, "ptr_lane");
+    Value *resNext = nullptr;
+    if (store) {
+      Value *storeLaneVal = builder.CreateExtractElement(valVec, loop.lane, "val_lane");
+      builder.CreateStore(storeLaneVal, pointerLaneVal)->setAlignment(alignment);
+    } else {
+      LoadInst *loadInst = builder.CreateLoad(pointerLaneVal, "load_lane");
+      loadInst->setAlignment(alignment);
+      resNext = builder.CreateInsertElement(loop.carried, loadInst, loop.lane, "insert_lane");
+    }
+
+    CloseActiveLaneLoop(builder, loop, resNext);
+    if (store) builder.CreateRetVoid();
+    else builder.CreateRet(loop.carried);
+    return func;
+  }
+
   // create body
   // following function:
   // vector a, mask m, vector r = undef
@@ -1401,6 +1744,15 @@ llvm::Value *NatBuilder::createPTest(llvm::Value *vector, bool isRv_all) {
   assert(cast<VectorType>(vector->getType())->getElementType()->isIntegerTy(1) &&
          "vector elements must have i1 type!");
 
+  // <W x i1> is a mask register: compare its bits directly (kortest)
+  if (useMaskRegisters) {
+    Type *maskIntTy = Type::getIntNTy(vector->getContext(), vectorWidth());
+    Value *bc = builder.CreateBitCast(vector, maskIntTy, "ptest_bc");
+    if (isRv_all)
+      return builder.CreateICmpEQ(bc, Constant::getAllOnesValue(maskIntTy), "ptest_all");
+    return builder.CreateICmpNE(bc, Constant::getNullValue(maskIntTy), "ptest_any");
+  }
+
   // rv_all(x) == !rv_any(!x)
   Type *i32VecType = VectorType::get(i32Ty, vectorWidth());
   Type *intSIMDType = Type::getIntNTy(vector->getContext(), vectorWidth() * 32);
@@ -1426,20 +1778,163 @@ llvm::Value *NatBuilder::maskInactiveLanes(llvm::Value *const value, const Basic
     }
 }
 
+bool
+NatBuilder::canReassociateReduction(Reduction & red) {
+  auto & reductInst = red.getReductOp();
+
+  switch (red.kind) {
+    case RedKind::SMin:
+    case RedKind::SMax:
+    case RedKind::UMin:
+    case RedKind::UMax:
+      return true;
+
+    case RedKind::FMin:
+    case RedKind::FMax: {
+      // minnum/maxnum are order independent. The fcmp+select idiom only if there are no NaNs
+      if (isa<IntrinsicInst>(reductInst)) return true;
+      auto & cmp = *cast<SelectInst>(reductInst).getCondition();
+      if (!isa<FPMathOperator>(cmp)) return false;
+      auto fmf = cast<Instruction>(cmp).getFastMathFlags();
+      return fmf.noNaNs() || fmf.unsafeAlgebra();
+    }
+
+    case RedKind::Binary: {
+      auto & binOp = cast<BinaryOperator>(reductInst);
+      // subtractions accumulate negated partial sums (see createReduceStep)
+      bool isSub = binOp.getOpcode() == Instruction::Sub || binOp.getOpcode() == Instruction::FSub;
+      if (!isSub && !binOp.isCommutative()) return false;
+
+      // floating point reductions may only be re-ordered under fast-math
+      if (isa<FPMathOperator>(binOp)) {
+        return binOp.getFastMathFlags().unsafeAlgebra();
+      }
+
+      return isSub || binOp.isAssociative();
+    }
+
+    default:
+      return false;
+  }
+}
+
 Value&
-NatBuilder::materializeVectorReduce(IRBuilder<> & builder, Value & initVal, Value & vecVal, Instruction & reductOp) {
-  Value * accu = &initVal;
-  for (int i = 0; i < vectorizationInfo.getVectorWidth(); ++i) {
-    auto * laneVal = builder.CreateExtractElement(&vecVal, i, "red_ext");
+NatBuilder::createReduceStep(IRBuilder<> & builder, RedKind kind, Instruction & reductInst, Value & a, Value & b) {
+  switch (kind) {
+    case RedKind::Binary: {
+      // lanes of a subtraction hold negated partial results
+      auto opcode = cast<BinaryOperator>(reductInst).getOpcode();
+      bool isSub = opcode == Instruction::Sub || opcode == Instruction::FSub;
+      if (opcode == Instruction::Sub) opcode = Instruction::Add;
+      else if (opcode == Instruction::FSub) opcode = Instruction::FAdd;
+
+      auto * step = builder.CreateBinOp(opcode, &a, &b, "red");
+      auto * stepInst = dyn_cast<Instruction>(step);
+      if (stepInst && (!isSub || isa<FPMathOperator>(stepInst))) stepInst->copyIRFlags(&reductInst);
+      return *step;
+    }
 
-    Instruction * copy = reductOp.clone();
-    copy->setOperand(0, accu);
-    copy->setOperand(1, laneVal);
-    builder.Insert(copy, "red");
-    accu = copy;
+    case RedKind::SMin: return *builder.CreateSelect(builder.CreateICmpSLT(&a, &b), &a, &b, "red_smin");
+    case RedKind::SMax: return *builder.CreateSelect(builder.CreateICmpSGT(&a, &b), &a, &b, "red_smax");
+    case RedKind::UMin: return *builder.CreateSelect(builder.CreateICmpULT(&a, &b), &a, &b, "red_umin");
+    case RedKind::UMax: return *builder.CreateSelect(builder.CreateICmpUGT(&a, &b), &a, &b, "red_umax");
+
+    case RedKind::FMin:
+    case RedKind::FMax: {
+      bool isMin = kind == RedKind::FMin;
+      if (auto * intrin = dyn_cast<IntrinsicInst>(&reductInst)) {
+        // keep minnum/maxnum semantics
+        Module * mod = vectorizationInfo.getMapping().vectorFn->getParent();
+        Function * intrinDecl = Intrinsic::getDeclaration(mod, intrin->getIntrinsicID(), a.getType());
+        return *builder.CreateCall(intrinDecl, {&a, &b}, isMin ? "red_fmin" : "red_fmax");
+      }
+
+      auto * cmp = isMin ? builder.CreateFCmpOLT(&a, &b) : builder.CreateFCmpOGT(&a, &b);
+      return *builder.CreateSelect(cmp, &a, &b, isMin ? "red_fmin" : "red_fmax");
+    }
+
+    default:
+      llvm_unreachable("no reduction step for this kind (index reductions are materialized in materializeIndexReduce)");
+  }
+}
+
+Value&
+NatBuilder::createHorizontalReduce(IRBuilder<> & builder, Value & vecVal, RedKind kind, Instruction & reductInst) {
+  const unsigned vectorWidth = vectorizationInfo.getVectorWidth();
+  assert(vectorWidth > 0 && (vectorWidth & (vectorWidth - 1)) == 0 && "vector width must be a power of two");
+
+  // fold the upper half onto the lower half (log2(W) steps)
+  Value * accuVec = &vecVal;
+  for (unsigned half = vectorWidth / 2; half >= 1; half /= 2) {
+    SmallVector<Constant*, 16> shuffleMask;
+    for (unsigned i = 0; i < vectorWidth; ++i) {
+      if (i < half) shuffleMask.push_back(builder.getInt32(half + i));
+      else shuffleMask.push_back(UndefValue::get(i32Ty));
+    }
+
+    auto * upperHalf = builder.CreateShuffleVector(accuVec, UndefValue::get(accuVec->getType()),
+                                                   ConstantVector::get(shuffleMask), "red_shuf");
+    accuVec = &createReduceStep(builder, kind, reductInst, *accuVec, *upperHalf);
   }
 
-  return *accu;
+  return *builder.CreateExtractElement(accuVec, builder.getInt32(0), "red_ext");
+}
+
+Value&
+NatBuilder::materializeVectorReduce(IRBuilder<> & builder, Value & initVal, Value & vecVal, Reduction & red) {
+  const unsigned vectorWidth = vectorizationInfo.getVectorWidth();
+  const bool isPowerOfTwo = vectorWidth > 0 && (vectorWidth & (vectorWidth - 1)) == 0;
+  auto & reductInst = red.getReductOp();
+
+  // strict (ordered) reduction: serial chain lane 0 .. W-1
+  if (!isPowerOfTwo || !canReassociateReduction(red)) {
+    Value * accu = &initVal;
+    for (unsigned i = 0; i < vectorWidth; ++i) {
+      auto * laneVal = builder.CreateExtractElement(&vecVal, builder.getInt32(i), "red_ext");
+      accu = &createReduceStep(builder, red.kind, reductInst, *accu, *laneVal);
+    }
+
+    return *accu;
+  }
+
+  // reassociable reduction: tree reduce the lanes, then fold in the initial value
+  auto & reducedVal = createHorizontalReduce(builder, vecVal, red.kind, reductInst);
+  return createReduceStep(builder, red.kind, reductInst, initVal, reducedVal);
+}
+
+Value&
+NatBuilder::materializeIndexReduce(IRBuilder<> & builder, Reduction & red, Value & initIdx, Value & vecIdx, Value & initVal, Value & vecVal) {
+  assert(red.kind == RedKind::Index && red.pairedRed);
+  auto & valRed = *red.pairedRed;
+  auto & valSel = cast<SelectInst>(valRed.getReductOp());
+  auto & cmp = *cast<CmpInst>(valSel.getCondition());
+  const unsigned vectorWidth = vectorizationInfo.getVectorWidth();
+
+// best value over all lanes (the order of lanes is irrelevant here)
+  auto & bestVal = createHorizontalReduce(builder, vecVal, valRed.kind, valSel);
+  auto * bestValVec = builder.CreateVectorSplat(vectorWidth, &bestVal, "red_best");
+
+// lowest (or highest) index of the lanes that hold the best value (the first or last occurence, depending on the step)
+  auto * idxTy = cast<IntegerType>(red.phi.getType());
+  unsigned bits = idxTy->getBitWidth();
+  auto * sentinel = ConstantInt::get(idxTy, red.takeLowestIndex() ? APInt::getSignedMaxValue(bits) : APInt::getSignedMinValue(bits));
+
+  auto * isBest = bestVal.getType()->isFloatingPointTy() ? builder.CreateFCmpOEQ(&vecVal, bestValVec, "red_isbest")
+                                                         : builder.CreateICmpEQ(&vecVal, bestValVec, "red_isbest");
+  auto * candIdx = builder.CreateSelect(isBest, &vecIdx, ConstantVector::getSplat(vectorWidth, sentinel), "red_cand");
+  auto & bestIdx = createHorizontalReduce(builder, *candIdx, red.takeLowestIndex() ? RedKind::SMin : RedKind::SMax, valSel);
+
+// the lanes only win if the scalar loop would have updated the initial value
+  auto * updateCmp = cmp.clone();
+  for (unsigned i = 0; i < updateCmp->getNumOperands(); ++i) {
+    updateCmp->setOperand(i, cmp.getOperand(i) == &valRed.phi ? &initVal : &bestVal);
+  }
+  builder.Insert(updateCmp, "red_update");
+
+  bool newOnTrue = valSel.getFalseValue() == &valRed.phi;
+  Value * update = newOnTrue ? updateCmp : builder.CreateNot(updateCmp);
+
+  return *builder.CreateSelect(update, &bestIdx, &initIdx, "red_idx");
 }
 
 void
@@ -1464,57 +1959,87 @@ NatBuilder::materializeReduction(Reduction & red) {
   auto & reductInst = red.getReductInst();
   auto & vecReductInst = *cast<Instruction>(getVectorValue(&reductInst));
 
-// reduce reduction phi for outside users
-  for (auto & use : red.phi.uses()) {
-    int opIdx = use.getOperandNo();
-    auto & userInst = cast<Instruction>(*use.getUser());
+// reduce the reduction phi (atLoopEntry) or the reduction operation for outside users
+  for (bool atLoopEntry : {true, false}) {
+    Instruction & scalInst = atLoopEntry ? cast<Instruction>(red.phi) : reductInst;
+    Value & vecVal = atLoopEntry ? *vecPhi : vecReductInst;
 
-    if (vectorizationInfo.inRegion(userInst)) {
-      continue; // regular remapping
+    SmallVector<Use*, 4> outsideUses;
+    for (auto & use : scalInst.uses()) {
+      if (vectorizationInfo.inRegion(*cast<Instruction>(use.getUser()))) {
+        continue; // regular remapping
+      }
+      outsideUses.push_back(&use);
     }
 
-    auto * userPhi = dyn_cast<PHINode>(&userInst);
-    assert((!userPhi || (userPhi->getNumIncomingValues() == 1)) && "expected an LCSSA phi");
-
-    // otw, replace with reduced value
-    IRBuilder<> builder(userInst.getParent(), userInst.getIterator());
-    auto & reducedVector = materializeVectorReduce(builder, phiInitVal, *vecPhi, reductInst);
+    for (auto * use : outsideUses) {
+      int opIdx = use->getOperandNo();
+      auto & userInst = cast<Instruction>(*use->getUser());
+
+      auto * userPhi = dyn_cast<PHINode>(&userInst);
+      assert((!userPhi || (userPhi->getNumIncomingValues() == 1)) && "expected an LCSSA phi");
+
+      // otw, replace with reduced value (behind all phis of the block for LCSSA phis)
+      auto insertPt = userPhi ? userInst.getParent()->getFirstInsertionPt() : userInst.getIterator();
+      IRBuilder<> builder(userInst.getParent(), insertPt);
+      Value * reducedVector = nullptr;
+      if (red.kind == RedKind::Index) {
+        // the paired min/max reduction provides the values to compare
+        auto & valRed = *red.pairedRed;
+        auto & vecPairedVal = atLoopEntry ? *getVectorValue(&valRed.phi) : *getVectorValue(&valRed.getReductInst());
+        reducedVector = &materializeIndexReduce(builder, red, phiInitVal, vecVal, valRed.getInitValue(), vecPairedVal);
+      } else {
+        reducedVector = &materializeVectorReduce(builder, phiInitVal, vecVal, red);
+      }
 
-    if (userPhi) {
-      // LCSSA phi (purge)
-      userPhi->replaceAllUsesWith(&reducedVector);
-      userPhi->eraseFromParent();
+      if (userPhi) {
+        // LCSSA phi (purge)
+        userPhi->replaceAllUsesWith(reducedVector);
+        userPhi->eraseFromParent();
 
-    } else {
-      // regular use
-      userInst.setOperand(opIdx, &reducedVector);
+      } else {
+        // regular use
+        userInst.setOperand(opIdx, reducedVector);
+      }
     }
   }
+}
 
-// reduct result of reduction operation for outside users
-  for (auto & use : reductInst.uses()) {
-    int opIdx = use.getOperandNo();
-    auto & userInst = cast<Instruction>(*use.getUser());
-
-    if (vectorizationInfo.inRegion(userInst)) {
-      continue; // regular remapping
+void NatBuilder::remapOutsideUses() {
+  std::vector<BasicBlock *> regionBlocks;
+  for (auto &BB : *vectorizationInfo.getMapping().vectorFn) {
+    if (region->contains(&BB)) {
+      regionBlocks.push_back(&BB);
+      continue;
     }
 
-    auto * userPhi = dyn_cast<PHINode>(&userInst);
-    assert((!userPhi || (userPhi->getNumIncomingValues() == 1)) && "expected an LCSSA phi");
+    // phis outside of the region have their incoming blocks in the region (LCSSA and exit phis)
+    for (auto &inst : BB) {
+      auto *phi = dyn_cast<PHINode>(&inst);
+      if (!phi) break;
+      for (uint i = 0; i < phi->getNumIncomingValues(); ++i) {
+        auto *inBlock = phi->getIncomingBlock(i);
+        if (region->contains(inBlock)) phi->setIncomingBlock(i, cast<BasicBlock>(getVectorValue(inBlock, true)));
+      }
+    }
+  }
 
-    // otw, replace with reduced value
-    IRBuilder<> builder(userInst.getParent(), userInst.getIterator());
-    auto & reducedVector = materializeVectorReduce(builder, phiInitVal, vecReductInst, reductInst);
+  for (auto *block : regionBlocks) {
+    for (auto &inst : *block) {
+      SmallVector<Use *, 4> outsideUses;
+      for (auto &use : inst.uses()) {
+        auto *userInst = cast<Instruction>(use.getUser());
+        if (!region->contains(userInst->getParent())) outsideUses.push_back(&use);
+      }
+      if (outsideUses.empty()) continue;
 
-    if (userPhi) {
-      // LCSSA phi (purge)
-      userPhi->replaceAllUsesWith(&reducedVector);
-      userPhi->eraseFromParent();
+      // uniform and strided values continue with their first lane (the iteration that leaves the region)
+      assert(!getShape(inst).isVarying() && "varying value used outside of the region");
 
-    } else {
-      // regular use
-      userInst.setOperand(opIdx, &reducedVector);
+      auto *vecBlock = cast<BasicBlock>(getVectorValue(block, true));
+      builder.SetInsertPoint(vecBlock->getTerminator());
+      Value *laneVal = requestScalarValue(&inst, 0);
+      for (auto *use : outsideUses) use->set(laneVal);
     }
   }
 }
@@ -1629,11 +2154,15 @@ BasicBlockVector &NatBuilder::getAllBasicBlocksFor(llvm::BasicBlock *basicBlock)
   return blockIt->second;
 }
 
+void NatBuilder::countLowering(LoweringKind kind, const Instruction &inst) {
+  vectorizationInfo.getLoweringStatistics().add(kind, inst);
+}
+
 unsigned NatBuilder::vectorWidth() {
   return vectorizationInfo.getMapping().vectorWidth;
 }
 
-bool NatBuilder::canVectorize(Instruction *const inst) {
+bool NatBuilder::decideCanVectorize(Instruction *const inst) {
   // whitelisting approach. for direct vectorization we support:
   // binary operations (normal & bitwise), memory access operations, conversion operations and other operations
 
@@ -1668,7 +2197,7 @@ bool NatBuilder::canVectorize(Instruction *const inst) {
   }
 }
 
-bool NatBuilder::shouldVectorize(Instruction *inst) {
+bool NatBuilder::decideShouldVectorize(Instruction *inst) {
   // we should vectorize iff
   // 1) varying vector shape OR
   // 2) Alloca AND contiguous
@@ -1679,21 +2208,15 @@ bool NatBuilder::shouldVectorize(Instruction *inst) {
   // 6) has an operand that will be vectorized
 
   if (isa<GetElementPtrInst>(inst)) {
+    // arguments are mapped before the decisions are computed, other bases are checked again during code generation
+    // (see shouldVectorize)
     GetElementPtrInst *gep = cast<GetElementPtrInst>(inst);
-    Value *pointer = gep->getPointerOperand();
-    Value *mappedPtr = getScalarValue(pointer);
-    if (mappedPtr) {
-      PointerType *pty = cast<PointerType>(mappedPtr->getType());
-      if (pty->getElementType()->isVectorTy()) {
-        willNotVectorize.push_back(inst);
-        return false;
-      }
-    }
+    if (hasVectorPointerBase(gep))
+      return false;
     VectorShape shape = getShape(*gep);
-    if (shape.isStrided(gep->getResultElementType()->getPrimitiveSizeInBits() / 8)) {
-      willNotVectorize.push_back(inst);
+    if (shape.isStrided(gep->getResultElementType()->getPrimitiveSizeInBits() / 8))
       return false;
-    } else if (shape.isStrided() || shape.isVarying())
+    else if (shape.isStrided() || shape.isVarying())
       return true;
   }
 
@@ -1714,10 +2237,8 @@ bool NatBuilder::shouldVectorize(Instruction *inst) {
     VectorShape shape = getShape(*inst);
     if (isa<AllocaInst>(inst) || isa<LoadInst>(inst) ? !shape.isUniform() : shape.isVarying())
       return true;
-    else if (shape.isUniform()) {
-      willNotVectorize.push_back(inst);
+    else if (shape.isUniform())
       return false;
-    }
 
   }
 
@@ -1732,13 +2253,79 @@ bool NatBuilder::shouldVectorize(Instruction *inst) {
       if (shape.isVarying() || (isa<StoreInst>(inst) && !shape.isUniform())) return true;
     }
 
-    // if we already checked this instruction, return the last value. by construction, all operands that are
-    // instructions will have been checked already. therefore we do not need to save the concrete <true/false> value
-    // and instead will insert into a vector if we should not vectorize and then check if this instruction is inside
-    if (isa<Instruction>(val) && std::find(willNotVectorize.begin(), willNotVectorize.end(), cast<Instruction>(val)) == willNotVectorize.end())
-      return true;
+    // by construction, all operands that are instructions of the region have been decided already
+    // (instructions outside the region and back edges of phis count as vectorized)
+    if (isa<Instruction>(val)) {
+      const Decision *opDecision = getDecision(cast<Instruction>(val));
+      if (!opDecision || opDecision->shouldVectorize)
+        return true;
+    }
   }
   // all operands uniform, should not be vectorized
-  willNotVectorize.push_back(inst);
   return false;
 }
+
+bool NatBuilder::isLazyInstruction(Instruction *const inst) {
+  if (!vectorizeInterleavedAccess) return false;
+  if (isa<LoadInst>(inst) || isa<StoreInst>(inst)) return decideCanVectorize(inst);
+
+  // all calls except for the rv_* intrinsics
+  auto *call = dyn_cast<CallInst>(inst);
+  if (!call) return false;
+  StringRef calleeName = call->getCalledFunction()->getName();
+  return calleeName != "rv_any" && calleeName != "rv_all" && calleeName != "rv_extract" && calleeName != "rv_ballot";
+}
+
+void NatBuilder::computeDecisions(ArrayRef<BasicBlock *> blockOrder) {
+  decisions.clear();
+  decisionIndex.clear();
+
+  for (BasicBlock *bb : blockOrder) {
+    for (Instruction &inst : *bb) {
+      Decision decision;
+      decision.inst = &inst;
+      decision.canVectorize = decideCanVectorize(&inst);
+      decision.shouldVectorize = decideShouldVectorize(&inst);
+      decision.lazy = isLazyInstruction(&inst);
+      decisionIndex[&inst] = decisions.size();
+      decisions.push_back(decision);
+    }
+  }
+}
+
+const NatBuilder::Decision *NatBuilder::getDecision(const Instruction *inst) const {
+  auto it = decisionIndex.find(inst);
+  if (it == decisionIndex.end()) return nullptr;
+  return &decisions[it->second];
+}
+
+bool NatBuilder::canVectorize(Instruction *const inst) {
+  const Decision *decision = getDecision(inst);
+  return decision ? decision->canVectorize : decideCanVectorize(inst);
+}
+
+bool NatBuilder::shouldVectorize(Instruction *inst) {
+  if (auto *gep = dyn_cast<GetElementPtrInst>(inst)) {
+    if (hasVectorPointerBase(gep)) return false;
+  }
+
+  const Decision *decision = getDecision(inst);
+  return decision ? decision->shouldVectorize : decideShouldVectorize(inst);
+}
+
+bool NatBuilder::hasVectorPointerBase(GetElementPtrInst *gep) {
+  Value *mappedPtr = getScalarValue(gep->getPointerOperand());
+  if (!mappedPtr) return false;
+  PointerType *pty = cast<PointerType>(mappedPtr->getType());
+  return pty->getElementType()->isVectorTy();
+}
+
+void NatBuilder::dumpDecisions(raw_ostream &out) const {
+  out << "NatBuilder decisions {\n";
+  for (const Decision &decision : decisions) {
+    const char *lowering = !decision.shouldVectorize ? "scalar"
+                         : decision.canVectorize ? "vectorize" : "replicate";
+    out << "\t" << lowering << (decision.lazy ? " (lazy)" : "") << "\t" << *decision.inst << "\n";
+  }
+  out << "}\n";
+}
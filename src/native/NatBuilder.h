@@ -12,11 +12,15 @@
 
 #include "MemoryAccessGrouper.h"
 
+#include <deque>
 #include <vector>
 
+#include <llvm/ADT/SmallPtrSet.h>
+
 #include <rv/analysis/maskAnalysis.h>
 #include <rv/vectorizationInfo.h>
 #include <rv/PlatformInfo.h>
+#include <rv/rv.h>
 
 #include <llvm/Analysis/MemoryDependenceAnalysis.h>
 #include <llvm/IR/Dominators.h>
@@ -27,6 +31,7 @@ namespace rv {
   class Region;
   class ReductionAnalysis;
   class Reduction;
+  enum class RedKind;
 }
 
 namespace native {
@@ -34,6 +39,30 @@ namespace native {
   typedef std::vector<llvm::Value *> LaneValueVector;
   typedef std::vector<llvm::BasicBlock *> BasicBlockVector;
 
+  // deferred (memory and call) instructions in program order with O(1) membership
+  class LazyInstructionQueue {
+    std::deque<llvm::Instruction *> order;
+    llvm::SmallPtrSet<const llvm::Instruction *, 32> members;
+
+  public:
+    void push_back(llvm::Instruction *inst) {
+      order.push_back(inst);
+      members.insert(inst);
+    }
+    llvm::Instruction *pop_front() {
+      llvm::Instruction *inst = order.front();
+      order.pop_front();
+      members.erase(inst);
+      return inst;
+    }
+    bool contains(const llvm::Instruction *inst) const { return members.count(inst); }
+    bool empty() const { return order.empty(); }
+    llvm::Instruction *back() const { return order.back(); }
+
+    std::deque<llvm::Instruction *>::const_iterator begin() const { return order.begin(); }
+    std::deque<llvm::Instruction *>::const_iterator end() const { return order.end(); }
+  };
+
   class NatBuilder {
     llvm::IRBuilder<> builder;
 
@@ -53,17 +82,29 @@ namespace native {
 
     bool useScatterGatherIntrinsics;
     bool vectorizeInterleavedAccess;
+    // the target has predicate registers (AVX-512 k-registers): keep <W x i1> masks, test them with a plain bitcast
+    bool useMaskRegisters;
+    // replicate predicated code in a loop over the active lanes instead of unrolled per-lane cascades
+    bool useActiveLaneLoops;
 
     rv::VectorShape getShape(const Value & val);
 
     // generate reduction code (after all other instructions have been vectorized)
     void materializeReduction(rv::Reduction & red);
-    llvm::Value& materializeVectorReduce(llvm::IRBuilder<> & builder, llvm::Value & phiInitVal, llvm::Value & vecVal, llvm::Instruction & reduceOp);
+    llvm::Value& materializeVectorReduce(llvm::IRBuilder<> & builder, llvm::Value & phiInitVal, llvm::Value & vecVal, rv::Reduction & red);
+    llvm::Value& materializeIndexReduce(llvm::IRBuilder<> & builder, rv::Reduction & red, llvm::Value & initIdx, llvm::Value & vecIdx, llvm::Value & initVal, llvm::Value & vecVal);
+    // log2(W) shuffle tree reducing all lanes of @vecVal
+    llvm::Value& createHorizontalReduce(llvm::IRBuilder<> & builder, llvm::Value & vecVal, rv::RedKind kind, llvm::Instruction & reductInst);
+    // one reduction step (scalar or vector) for the given kind of reduction
+    llvm::Value& createReduceStep(llvm::IRBuilder<> & builder, rv::RedKind kind, llvm::Instruction & reductInst, llvm::Value & a, llvm::Value & b);
+    // whether the reduction may be evaluated in tree order (integer ops, min/max or fast-math FP ops)
+    bool canReassociateReduction(rv::Reduction & red);
 
   public:
     NatBuilder(rv::PlatformInfo &platformInfo, VectorizationInfo &vectorizationInfo,
                const llvm::DominatorTree &dominatorTree, llvm::MemoryDependenceAnalysis &memDepAnalysis,
-               llvm::ScalarEvolution &SE, rv::ReductionAnalysis & _reda);
+               llvm::ScalarEvolution &SE, rv::ReductionAnalysis & _reda,
+               rv::LaneIteration laneIteration = rv::LaneIteration::Auto);
 
     void vectorize();
 
@@ -73,12 +114,16 @@ namespace native {
     llvm::Value *getVectorValue(llvm::Value *const value, bool getLastBlock = false);
     llvm::Value *getScalarValue(llvm::Value *const value, unsigned laneIdx = 0);
 
+    void dumpDecisions(llvm::raw_ostream &out) const;
+
   private:
     void vectorize(llvm::BasicBlock *const bb, llvm::BasicBlock *vecBlock);
     void vectorize(llvm::Instruction *const inst);
     void vectorizePHIInstruction(llvm::PHINode *const scalPhi);
     void vectorizeMemoryInstruction(llvm::Instruction *const inst);
     void vectorizeCallInstruction(llvm::CallInst *const scalCall);
+    void vectorizeCallWithVariant(llvm::CallInst *const scalCall, const rv::VectorMapping &mapping);
+    bool replicateCallForActiveLanes(llvm::CallInst *const scalCall);
     void vectorizeAllocaInstruction(llvm::AllocaInst *const alloca);
     void vectorizeReductionCall(CallInst *rvCall, bool isRv_all);
     void vectorizeExtractCall(CallInst *rvCall);
@@ -92,6 +137,8 @@ namespace native {
     void fallbackVectorize(llvm::Instruction *const inst);
 
     void addValuesToPHINodes();
+    // remap uses outside of the region to the lane 0 values of the vectorized region
+    void remapOutsideUses();
 
     void mapOperandsInto(llvm::Instruction *const scalInst, llvm::Instruction *inst, bool vectorizedInst,
                          unsigned laneIdx = 0);
@@ -101,15 +148,32 @@ namespace native {
     llvm::DenseMap<const llvm::Value *, llvm::Value *> vectorValueMap;
     std::map<const llvm::Value *, LaneValueVector> scalarValueMap;
     std::map<const llvm::BasicBlock *, BasicBlockVector> basicBlockMap;
-    std::map<const llvm::Type *, MemoryAccessGrouper> grouperMap;
+    // interleave groups of the current block
+    std::vector<InterleaveGroup> interleaveGroups;
+    llvm::DenseMap<const llvm::Instruction *, unsigned> interleaveGroupIndex;
     std::vector<llvm::PHINode *> phiVector;
-    std::vector<llvm::Instruction *> willNotVectorize;
-    std::deque<llvm::Instruction *> lazyInstructions;
+    LazyInstructionQueue lazyInstructions;
+
+    // compute the interleave groups of @bb once before its code is generated
+    void groupMemoryAccesses(llvm::BasicBlock &bb);
+    const InterleaveGroup *getInterleaveGroup(const llvm::Instruction *inst) const;
+    // whether every member of @group but @inst is still waiting in the lazy queue
+    bool isInterleaveGroupPending(const InterleaveGroup &group, const llvm::Instruction *inst) const;
 
     void requestLazyInstructions(llvm::Instruction *const upToInstruction);
     llvm::Value *requestVectorValue(llvm::Value *const value);
     llvm::Value *requestScalarValue(llvm::Value *const value, unsigned laneIdx = 0,
                                     bool skipMappingWhenDone = false);
+    // whether the target supports llvm.masked.load/store for this type (cascades are used otherwise)
+    bool isLegalMaskedMemory(llvm::Type *vecType, bool isLoad);
+    // whether one interleaved access of the group beats a gather/scatter per member (TTI costs)
+    bool isInterleavedAccessProfitable(llvm::Instruction &inst, llvm::Type *accessedType, unsigned factor,
+                                       llvm::ArrayRef<unsigned> memberIndices, bool masked);
+    // per wide access: the interleaved predicate of the group members (gaps are inactive). empty if !masked
+    std::vector<llvm::Value *> createInterleavedMasks(llvm::ArrayRef<llvm::Instruction *> sources, llvm::Value *predicate,
+                                                      bool masked);
+    unsigned getInterleavedAlignment(llvm::Instruction &source);
+    llvm::Value *createLanePointers(llvm::Value *vecPtr, llvm::Type *accessedType);
     llvm::Value *requestCascadeLoad(llvm::Value *vecPtr, unsigned alignment, llvm::Value *mask);
     llvm::Value *requestCascadeStore(llvm::Value *vecVal, llvm::Value *vecPtr, unsigned alignment, llvm::Value *mask);
     llvm::Function *createCascadeMemory(llvm::VectorType *pointerVectorType, unsigned alignment,
@@ -125,9 +189,33 @@ namespace native {
 
     unsigned vectorWidth();
 
+    // record how @inst was lowered (see rv::LoweringStatistics)
+    void countLowering(rv::LoweringKind kind, const llvm::Instruction &inst);
+
+    // lowering of a single instruction. computed once for the whole region before code generation
+    //   !shouldVectorize                  -> keep scalar (copy)
+    //   shouldVectorize && canVectorize   -> vectorize
+    //   shouldVectorize && !canVectorize  -> replicate per lane
+    // lazy instructions (memory accesses and calls) are deferred until their first use
+    struct Decision {
+      llvm::Instruction *inst;
+      bool canVectorize;
+      bool shouldVectorize;
+      bool lazy;
+    };
+    std::vector<Decision> decisions;
+    llvm::DenseMap<const llvm::Instruction *, unsigned> decisionIndex;
+
+    void computeDecisions(llvm::ArrayRef<llvm::BasicBlock *> blockOrder);
+    const Decision *getDecision(const llvm::Instruction *inst) const;
+    bool decideCanVectorize(llvm::Instruction *const inst);
+    bool decideShouldVectorize(llvm::Instruction *inst);
+    bool isLazyInstruction(llvm::Instruction *const inst);
+
     bool canVectorize(llvm::Instruction *inst);
     bool shouldVectorize(llvm::Instruction *inst);
-
+    // GEP on a base that is mapped to a pointer to vector (only known during code generation)
+    bool hasVectorPointerBase(llvm::GetElementPtrInst *gep);
   };
 }
 
@@ -22,16 +22,19 @@ namespace rv {
       : FunctionPass(ID),
         vi(0),
         pi(0),
-        domTree(0) {
+        domTree(0),
+        laneIteration(LaneIteration::Auto) {
 
   }
 
-  NativeBackendPass::NativeBackendPass(VectorizationInfo *vi, PlatformInfo *pi, DominatorTree const *domTree, ReductionAnalysis * _reda)
+  NativeBackendPass::NativeBackendPass(VectorizationInfo *vi, PlatformInfo *pi, DominatorTree const *domTree, ReductionAnalysis * _reda,
+                                       LaneIteration _laneIteration)
   : FunctionPass(ID)
   , vi(vi)
   , pi(pi)
   , domTree(domTree)
   , reda(_reda)
+  , laneIteration(_laneIteration)
   {}
 
   NativeBackendPass::~NativeBackendPass() {}
@@ -79,7 +82,7 @@ namespace rv {
     assert((vecInfo.getRegion() ||
                (!vecInfo.getRegion() && (vecInfo.getMapping().scalarFn != vecInfo.getMapping().vectorFn)))
                && "scalar function and simd function must not be the same");
-    native::NatBuilder builder(platformInfo, vecInfo, dtree, mda, se, *reda);
+    native::NatBuilder builder(platformInfo, vecInfo, dtree, mda, se, *reda, laneIteration);
     builder.vectorize();
 
     return true;
@@ -11,6 +11,8 @@
 
 #include <llvm/Pass.h>
 
+#include "rv/rv.h"
+
 namespace rv {
 
 class ReductionAnalysis;
@@ -21,12 +23,14 @@ class ReductionAnalysis;
     PlatformInfo *pi;
     DominatorTree const *domTree;
     ReductionAnalysis * reda;
+    LaneIteration laneIteration;
 
   public:
     static char ID;
 
     NativeBackendPass();
-    NativeBackendPass(VectorizationInfo *vi, PlatformInfo *pi, DominatorTree const *domTree, ReductionAnalysis * _reda);
+    NativeBackendPass(VectorizationInfo *vi, PlatformInfo *pi, DominatorTree const *domTree, ReductionAnalysis * _reda,
+                      LaneIteration _laneIteration = LaneIteration::Auto);
 
     ~NativeBackendPass();
 
@@ -12,6 +12,9 @@
 #include <llvm/IR/LegacyPassManager.h>
 
 #include <llvm/Analysis/LoopInfo.h>
+#include <llvm/Analysis/AssumptionCache.h>
+#include <llvm/Analysis/ScalarEvolution.h>
+#include <llvm/Analysis/TargetLibraryInfo.h>
 #include <llvm/IR/Dominators.h>
 #include <llvm/Analysis/PostDominators.h>
 #include <llvm/IR/Verifier.h>
@@ -24,6 +27,7 @@
 #include "rv/transform/maskGenerator.h"
 #include "rv/transform/loopExitCanonicalizer.h"
 #include "rv/analysis/ABAAnalysis.h"
+#include "rv/analysis/CostModel.h"
 
 #include "rv/PlatformInfo.h"
 #include "rv/vectorizationInfo.h"
@@ -35,6 +39,8 @@
 
 #include "rv/transform/structOpt.h"
 
+#include "rv/timeReport.h"
+
 #include "native/nativeBackendPass.h"
 #include "native/NatBuilder.h"
 
@@ -98,6 +104,10 @@ namespace rv {
 
 VectorizerInterface::VectorizerInterface(PlatformInfo & _platInfo)
         : platInfo(_platInfo)
+        , bosccThreshold(0)
+        , laneIteration(LaneIteration::Auto)
+        , timeReport(nullptr)
+        , loweringRemarks(false)
 {
   addIntrinsics();
 }
@@ -148,31 +158,73 @@ VectorizerInterface::analyze(VectorizationInfo& vecInfo,
                              const PostDominatorTree& postDomTree,
                              const DominatorTree& domTree)
 {
-    VectorizationAnalysis vea(platInfo,
-                                  vecInfo,
-                                  cdg,
-                                  dfg,
-                                  loopInfo,
-                                  domTree, postDomTree);
+    auto & scalarFn = vecInfo.getScalarFunction();
+    if (timeReport) {
+      timeReport->recordFunction(scalarFn, vecInfo.getRegion());
+      timeReport->addCounter("analyzed functions");
+    }
 
-    MandatoryAnalysis man(vecInfo, loopInfo, cdg);
+    {
+      PhaseTimer phase(timeReport, "VectorizationAnalysis");
+      VectorizationAnalysis vea(platInfo,
+                                    vecInfo,
+                                    cdg,
+                                    dfg,
+                                    loopInfo,
+                                    domTree, postDomTree);
+      vea.analyze(scalarFn);
+    }
 
-    ABAAnalysis abaAnalysis(platInfo,
-                            vecInfo,
-                            loopInfo,
-                            postDomTree,
-                            domTree);
+    {
+      PhaseTimer phase(timeReport, "MandatoryAnalysis");
+      MandatoryAnalysis man(vecInfo, loopInfo, cdg);
+      man.analyze(scalarFn);
+    }
 
-    auto & scalarFn = vecInfo.getScalarFunction();
-    vea.analyze(scalarFn);
-  man.analyze(scalarFn);
-    abaAnalysis.analyze(scalarFn);
+    {
+      PhaseTimer phase(timeReport, "ABAAnalysis");
+      ABAAnalysis abaAnalysis(platInfo,
+                              vecInfo,
+                              loopInfo,
+                              postDomTree,
+                              domTree);
+      abaAnalysis.analyze(scalarFn);
+    }
+}
+
+std::vector<WidthEstimate>
+VectorizerInterface::rankVectorWidths(VectorizationInfo& vecInfo,
+                                      const CDG& cdg,
+                                      const DFG& dfg,
+                                      const LoopInfo& loopInfo,
+                                      const PostDominatorTree& postDomTree,
+                                      const DominatorTree& domTree,
+                                      ArrayRef<unsigned> candidateWidths)
+{
+    analyze(vecInfo, cdg, dfg, loopInfo, postDomTree, domTree);
+
+    std::vector<WidthEstimate> estimates;
+    {
+      PhaseTimer phase(timeReport, "CostModel");
+      CostModel costModel(platInfo, vecInfo, domTree);
+      estimates = costModel.rank(candidateWidths);
+    }
 
+    IF_DEBUG {
+      errs() << "--- Vector width ranking ---\n";
+      for (auto & estimate : estimates) {
+        estimate.print(errs());
+        errs() << "\n";
+      }
+    }
+
+    return estimates;
 }
 
 MaskAnalysis*
 VectorizerInterface::analyzeMasks(VectorizationInfo& vecInfo, const LoopInfo& loopinfo)
 {
+    PhaseTimer phase(timeReport, "MaskAnalysis");
     MaskAnalysis* maskAnalysis = new MaskAnalysis(platInfo, vecInfo, loopinfo);
     maskAnalysis->analyze(vecInfo.getScalarFunction());
     return maskAnalysis;
@@ -183,6 +235,7 @@ VectorizerInterface::generateMasks(VectorizationInfo& vecInfo,
                                    MaskAnalysis& maskAnalysis,
                                    const LoopInfo& loopInfo)
 {
+    PhaseTimer phase(timeReport, "MaskGenerator");
     MaskGenerator maskgenerator(vecInfo, maskAnalysis, loopInfo);
     return maskgenerator.generate(vecInfo.getScalarFunction());
 }
@@ -193,10 +246,12 @@ VectorizerInterface::linearizeCFG(VectorizationInfo& vecInfo,
                                   LoopInfo& loopInfo,
                                   DominatorTree& domTree)
 {
+    PhaseTimer phase(timeReport, "Linearizer");
+
     // use a fresh domtree here
     DominatorTree fixedDomTree(vecInfo.getScalarFunction()); // FIXME someone upstream broke the domtree
     domTree.recalculate(vecInfo.getScalarFunction());
-    Linearizer linearizer(vecInfo, maskAnalysis, fixedDomTree, loopInfo);
+    Linearizer linearizer(vecInfo, maskAnalysis, fixedDomTree, loopInfo, bosccThreshold);
 
     IF_DEBUG {
       errs() << "--- VecInfo before Linearizer ---\n";
@@ -216,22 +271,65 @@ VectorizerInterface::linearizeCFG(VectorizationInfo& vecInfo,
 bool
 VectorizerInterface::vectorize(VectorizationInfo &vecInfo, const DominatorTree &domTree, const LoopInfo & loopInfo)
 {
-  StructOpt sopt(vecInfo, platInfo.getDataLayout());
-  sopt.run();
+  {
+    PhaseTimer phase(timeReport, "StructOpt");
+    StructOpt sopt(vecInfo, platInfo.getDataLayout());
+    sopt.run();
+  }
+
+  // scalar evolution for the reduction analysis (on a fresh domtree, see linearizeCFG)
+  Function & scalarFn = vecInfo.getScalarFunction();
+  DominatorTree scevDomTree(scalarFn);
+  LoopInfo scevLoopInfo(scevDomTree);
+  AssumptionCache assumptionCache(scalarFn);
+  TargetLibraryInfoImpl defaultTLII(Triple(scalarFn.getParent()->getTargetTriple()));
+  TargetLibraryInfo defaultTLI(defaultTLII);
+  ScalarEvolution SE(scalarFn, platInfo.getTLI() ? *platInfo.getTLI() : defaultTLI, assumptionCache, scevDomTree, scevLoopInfo);
+
+  ReductionAnalysis reda(scalarFn, loopInfo, SE);
+  {
+    PhaseTimer phase(timeReport, "ReductionAnalysis");
+    reda.analyze();
+  }
 
-  ReductionAnalysis reda(vecInfo.getScalarFunction(), loopInfo);
-  reda.analyze();
+  // varying values carried by the vector loop have to be reductions (the lanes of a vector phi are independent)
+  if (auto * region = vecInfo.getRegion()) {
+    for (auto & inst : region->getRegionEntry()) {
+      auto * phi = dyn_cast<PHINode>(&inst);
+      if (!phi) break;
+      if (vecInfo.getVectorShape(*phi).isVarying() && !reda.getReductionInfo(*phi)) {
+        errs() << "rv: unsupported loop carried value " << phi->getName() << " (not a reduction)\n";
+        return false;
+      }
+    }
+  }
 
 // vectorize with native
 //    native::NatBuilder natBuilder(platInfo, vecInfo, domTree);
 //    natBuilder.vectorize();
-  legacy::FunctionPassManager fpm(vecInfo.getScalarFunction().getParent());
-  fpm.add(new MemoryDependenceAnalysis());
-  fpm.add(new ScalarEvolutionWrapperPass());
-  fpm.add(new NativeBackendPass(&vecInfo, &platInfo, &domTree, &reda));
-  fpm.doInitialization();
-  fpm.run(vecInfo.getScalarFunction());
-  fpm.doFinalization();
+  {
+    PhaseTimer phase(timeReport, "NativeBackend");
+    legacy::FunctionPassManager fpm(vecInfo.getScalarFunction().getParent());
+    fpm.add(new MemoryDependenceAnalysis());
+    fpm.add(new ScalarEvolutionWrapperPass());
+    fpm.add(new NativeBackendPass(&vecInfo, &platInfo, &domTree, &reda, laneIteration));
+    fpm.doInitialization();
+    fpm.run(vecInfo.getScalarFunction());
+    fpm.doFinalization();
+  }
+
+  // report how the instructions were lowered (if requested or a diagnostic handler collects the remarks)
+  const auto & loweringStats = vecInfo.getLoweringStatistics();
+  Function & vecFn = vecInfo.getVectorFunction();
+  if (loweringRemarks || vecFn.getContext().getDiagnosticHandler()) loweringStats.emitRemarks(vecFn);
+
+  if (timeReport) {
+    timeReport->addCounter("vectorized functions");
+    for (unsigned k = 0; k < static_cast<unsigned>(LoweringKind::NumKinds); ++k) {
+      auto kind = static_cast<LoweringKind>(k);
+      timeReport->addCounter(std::string("lowered as ") + GetLoweringKindName(kind), loweringStats.getTotal(kind));
+    }
+  }
 
   IF_DEBUG verifyFunction(vecInfo.getVectorFunction());
 
@@ -16,21 +16,85 @@
 #include "utils/rvTools.h"
 
 #define SLEEF_FILES RV_SLEEF_BC_DIR
+#define SLEEF_AVX512_SP SLEEF_FILES"/avx512_sleef_sp.bc"
 #define SLEEF_AVX2_SP SLEEF_FILES"/avx2_sleef_sp.bc"
 #define SLEEF_AVX_SP SLEEF_FILES"/avx_sleef_sp.bc"
 #define SLEEF_SSE_SP SLEEF_FILES"/sse_sleef_sp.bc"
+#define SLEEF_AVX512_DP SLEEF_FILES"/avx512_sleef_dp.bc"
 #define SLEEF_AVX2_DP SLEEF_FILES"/avx2_sleef_dp.bc"
 #define SLEEF_AVX_DP SLEEF_FILES"/avx_sleef_dp.bc"
 #define SLEEF_SSE_DP SLEEF_FILES"/sse_sleef_dp.bc"
 
 using namespace llvm;
 
-static Module const *avx2ModSP, *avxModSP, *sseModSP;
-static Module const *avx2ModDP, *avxModDP, *sseModDP;
+static Module const *avx512ModSP, *avx2ModSP, *avxModSP, *sseModSP;
+static Module const *avx512ModDP, *avx2ModDP, *avxModDP, *sseModDP;
 
 namespace rv {
-  bool addSleefMappings(const bool useSSE, const bool useAVX, const bool useAVX2, PlatformInfo &platformInfo,
-                          bool useImpreciseFunctions) {
+  bool addSleefMappings(const bool useSSE, const bool useAVX, const bool useAVX2, const bool useAVX512,
+                        PlatformInfo &platformInfo, bool useImpreciseFunctions) {
+    if (useAVX512) {
+      const VecDesc VecFuncs[] = {
+          {"atanf", "xatanf_avx512", 16},
+          {"asinf", "xasinf_avx512", 16},
+          {"acosf", "xacosf_avx512", 16},
+          {"sqrtf", "xsqrtf_avx512", 16},
+          {"tanhf", "xtanhf_avx512", 16},
+          {"atanhf", "xatanhf_avx512", 16},
+          {"exp2f", "xexp2f_avx512", 16},
+          {"exp10f", "xexp10f_avx512", 16},
+          {"expm1f", "xexpm1f_avx512", 16},
+          {"log10f", "xlog10f_avx512", 16},
+          {"log1pf", "xlog1pf_avx512", 16},
+          {"atan", "xatan_avx512", 8},
+          {"asin", "xasin_avx512", 8},
+          {"acos", "xacos_avx512", 8},
+          {"sqrt", "xsqrt_avx512", 8},
+          {"tanh", "xtanh_avx512", 8},
+          {"atanh", "xatanh_avx512", 8},
+          {"exp2", "xexp2_avx512", 8},
+          {"exp10", "xexp10_avx512", 8},
+          {"expm1", "xexpm1_avx512", 8},
+          {"log10", "xlog10_avx512", 8},
+          {"log1p", "xlog1p_avx512", 8}
+      };
+      platformInfo.addVectorizableFunctions(VecFuncs);
+
+      if (useImpreciseFunctions) {
+        const VecDesc ImprecVecFuncs[] = {
+            {"ldexpf", "xldexpf_avx512", 16},
+            {"sinf", "xsinf_avx512", 16},
+            {"cosf", "xcosf_avx512", 16},
+            {"sincosf", "xsincosf_avx512", 16},
+            {"tanf", "xtanf_avx512", 16},
+            {"atan2f", "xatan2f_avx512", 16},
+            {"logf", "xlogf_avx512", 16},
+            {"expf", "xexpf_avx512", 16},
+            {"cbrtf", "xcbrtf_avx512", 16},
+            {"powf", "xpowf_avx512", 16},
+            {"sinhf", "xsinhf_avx512", 16},
+            {"coshf", "xcoshf_avx512", 16},
+            {"asinhf", "xasinhf_avx512", 16},
+            {"acoshf", "xacoshf_avx512", 16},
+            {"ldexp", "xldexp_avx512", 8},
+            {"sin", "xsin_avx512", 8},
+            {"cos", "xcos_avx512", 8},
+            {"sincos", "xsincos_avx512", 8},
+            {"tan", "xtan_avx512", 8},
+            {"atan2", "xatan2_avx512", 8},
+            {"log", "xlog_avx512", 8},
+            {"exp", "xexp_avx512", 8},
+            {"cbrt", "xcbrt_avx512", 8},
+            {"pow", "xpow_avx512", 8},
+            {"sinh", "xsinh_avx512", 8},
+            {"cosh", "xcosh_avx512", 8},
+            {"asinh", "xasinh_avx512", 8},
+            {"acosh", "xacosh_avx512", 8}
+        };
+        platformInfo.addVectorizableFunctions(ImprecVecFuncs);
+      }
+    }
+
     if (useAVX2) {
       const VecDesc VecFuncs[] = {
           {"atanf", "xatanf_avx2", 8},
@@ -155,7 +219,7 @@ namespace rv {
       }
     }
 
-    if (useSSE || useAVX || useAVX2) {
+    if (useSSE || useAVX || useAVX2 || useAVX512) {
       const VecDesc VecFuncs[] = {
           {"atanf", "xatanf_sse", 4},
           {"asinf", "xasinf_sse", 4},
@@ -216,7 +280,7 @@ namespace rv {
         platformInfo.addVectorizableFunctions(ImprecVecFuncs);
       }
     }
-    return useAVX || useAVX2 || useSSE;
+    return useAVX512 || useAVX || useAVX2 || useSSE;
   }
 
   Function *cloneFunctionIntoModule(Function *func, Module *cloneInto, StringRef name) {
@@ -261,7 +325,13 @@ namespace rv {
 
     // load module and function, copy function to insertInto, return copy
     if (doublePrecision) {
-      if (vecFuncName.count("avx2")) { // avx2
+      if (vecFuncName.count("avx512")) { // avx512
+        if (!avx512ModDP) avx512ModDP = createModuleFromFile(SLEEF_AVX512_DP, context);
+        Function *vecFunc = avx512ModDP->getFunction("x" + funcName.str());
+        assert(vecFunc);
+        clonedFn = cloneFunctionIntoModule(vecFunc, insertInto, vecFuncName);
+
+      } else if (vecFuncName.count("avx2")) { // avx2
         if (!avx2ModDP) avx2ModDP = createModuleFromFile(SLEEF_AVX2_DP, context);
         Function *vecFunc = avx2ModDP->getFunction("x" + funcName.str()); // sleef naming: xlog, xtan, xsin, etc
         assert(vecFunc);
@@ -280,7 +350,13 @@ namespace rv {
         clonedFn = cloneFunctionIntoModule(vecFunc, insertInto, vecFuncName);
       }
     } else {
-      if (vecFuncName.count("avx2")) { // avx2
+      if (vecFuncName.count("avx512")) { // avx512
+        if (!avx512ModSP) avx512ModSP = createModuleFromFile(SLEEF_AVX512_SP, context);
+        Function *vecFunc = avx512ModSP->getFunction("x" + funcName.str());
+        assert(vecFunc);
+        clonedFn = cloneFunctionIntoModule(vecFunc, insertInto, vecFuncName);
+
+      } else if (vecFuncName.count("avx2")) { // avx2
         if (!avx2ModSP) avx2ModSP = createModuleFromFile(SLEEF_AVX2_SP, context);
         Function *vecFunc = avx2ModSP->getFunction("x" + funcName.str()); // sleef naming: xlog, xtan, xsin, etc
         assert(vecFunc);
@@ -0,0 +1,166 @@
+//===- timeReport.cpp -----------------------------===//
+//
+//                     The Region Vectorizer
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+
+#include "rv/timeReport.h"
+#include "rv/region/Region.h"
+
+#include <algorithm>
+#include <cassert>
+
+#include <llvm/IR/Function.h>
+#include <llvm/Support/Format.h>
+#include <llvm/Support/raw_ostream.h>
+
+using namespace llvm;
+
+namespace rv {
+
+TimeReport::TimeReport()
+: timerGroup("Region Vectorizer")
+, activePhase(-1)
+{}
+
+void
+TimeReport::startPhase(StringRef name) {
+  assert(activePhase < 0 && "phases must not overlap");
+
+  auto it = phaseIndex.find(name);
+  if (it == phaseIndex.end()) {
+    unsigned idx = phases.size();
+    phases.emplace_back(name);
+    timers.emplace_back(new Timer(name, timerGroup));
+    it = phaseIndex.insert(std::make_pair(name, idx)).first;
+  }
+
+  activePhase = it->second;
+  timers[activePhase]->startTimer();
+  startTime = TimeRecord::getCurrentTime(true);
+}
+
+void
+TimeReport::stopPhase() {
+  assert(activePhase >= 0 && "no phase running");
+
+  TimeRecord endTime = TimeRecord::getCurrentTime(false);
+  timers[activePhase]->stopTimer();
+
+  auto & phase = phases[activePhase];
+  phase.numRuns++;
+  phase.wallTime += endTime.getWallTime() - startTime.getWallTime();
+  phase.userTime += endTime.getUserTime() - startTime.getUserTime();
+  phase.memGrowth += endTime.getMemUsed() - startTime.getMemUsed();
+  phase.peakMemUsed = std::max<int64_t>(phase.peakMemUsed, std::max(startTime.getMemUsed(), endTime.getMemUsed()));
+
+  activePhase = -1;
+}
+
+void
+TimeReport::recordFunction(const Function & func, const Region * region) {
+  FunctionRecord record;
+  record.name = func.getName().str();
+  record.numBlocks = 0;
+  record.numInstructions = 0;
+  record.numRegionBlocks = 0;
+  record.numRegionInstructions = 0;
+
+  for (auto & block : func) {
+    record.numBlocks++;
+    record.numInstructions += block.size();
+    if (!region || region->contains(&block)) {
+      record.numRegionBlocks++;
+      record.numRegionInstructions += block.size();
+    }
+  }
+
+  functions.push_back(record);
+}
+
+void
+TimeReport::addCounter(StringRef name, uint64_t inc) {
+  counters[name.str()] += inc;
+}
+
+const PhaseRecord *
+TimeReport::getPhase(StringRef name) const {
+  auto it = phaseIndex.find(name);
+  if (it == phaseIndex.end()) return nullptr;
+  return &phases[it->second];
+}
+
+static void
+PrintJSONString(raw_ostream & out, StringRef text) {
+  out << '"';
+  for (char c : text) {
+    switch (c) {
+      case '"': out << "\\\""; break;
+      case '\\': out << "\\\\"; break;
+      case '\n': out << "\\n"; break;
+      case '\t': out << "\\t"; break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20) {
+          out << format("\\u%04x", static_cast<unsigned>(c));
+        } else {
+          out << c;
+        }
+    }
+  }
+  out << '"';
+}
+
+void
+TimeReport::printJSON(raw_ostream & out) const {
+  out << "{\n  \"phases\": [";
+  for (unsigned i = 0; i < phases.size(); ++i) {
+    const auto & phase = phases[i];
+    out << (i ? ",\n" : "\n") << "    {\"name\": ";
+    PrintJSONString(out, phase.name);
+    out << ", \"runs\": " << phase.numRuns
+        << ", \"wall_seconds\": " << format("%.6f", phase.wallTime)
+        << ", \"user_seconds\": " << format("%.6f", phase.userTime)
+        << ", \"mem_growth_bytes\": " << phase.memGrowth
+        << ", \"peak_mem_bytes\": " << phase.peakMemUsed << "}";
+  }
+  out << "\n  ],\n  \"functions\": [";
+  for (unsigned i = 0; i < functions.size(); ++i) {
+    const auto & func = functions[i];
+    out << (i ? ",\n" : "\n") << "    {\"name\": ";
+    PrintJSONString(out, func.name);
+    out << ", \"blocks\": " << func.numBlocks
+        << ", \"instructions\": " << func.numInstructions
+        << ", \"region_blocks\": " << func.numRegionBlocks
+        << ", \"region_instructions\": " << func.numRegionInstructions << "}";
+  }
+  out << "\n  ],\n  \"counters\": {";
+  bool first = true;
+  for (auto & counter : counters) {
+    out << (first ? "\n" : ",\n") << "    ";
+    PrintJSONString(out, counter.first);
+    out << ": " << counter.second;
+    first = false;
+  }
+  out << "\n  }\n}\n";
+}
+
+void
+TimeReport::print(raw_ostream & out) const {
+  out << "--- RV time report ---\n";
+  for (const auto & phase : phases) {
+    out << format("%-24s %4u runs %10.4fs wall %10.4fs user %12lld bytes peak\n",
+                  phase.name.c_str(), phase.numRuns, phase.wallTime, phase.userTime,
+                  static_cast<long long>(phase.peakMemUsed));
+  }
+  for (const auto & func : functions) {
+    out << func.name << ": " << func.numBlocks << " blocks, " << func.numInstructions << " instructions, region "
+        << func.numRegionBlocks << " blocks, " << func.numRegionInstructions << " instructions\n";
+  }
+  for (const auto & counter : counters) {
+    out << counter.first << ": " << counter.second << "\n";
+  }
+}
+
+}
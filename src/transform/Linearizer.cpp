@@ -21,6 +21,8 @@
 #include <llvm/IR/Verifier.h>
 #include <llvm/IR/BasicBlock.h>
 #include <llvm/ADT/PostOrderIterator.h>
+#include <llvm/Transforms/Utils/Cloning.h>
+#include <llvm/Transforms/Utils/ValueMapper.h>
 
 #include <cassert>
 #include <climits>
@@ -355,11 +357,21 @@ Linearizer::requestReductionFunc(llvm::Module & mod, const std::string & name) {
   return redFunc; // TODO add SIMD mapping
 }
 
+// source location for code that is introduced for @block (the last location in the block)
+static DebugLoc
+GetBlockLocation(const BasicBlock & block) {
+  for (auto it = block.rbegin(); it != block.rend(); ++it) {
+    if (it->getDebugLoc()) return it->getDebugLoc();
+  }
+  return DebugLoc();
+}
+
 Instruction &
 Linearizer::createReduction(Value & pred, const std::string & name, BasicBlock & atEnd) {
   auto * redFunc = requestReductionFunc(*atEnd.getParent()->getParent(), name);
   auto * call = CallInst::Create(redFunc, &pred, "reduce", &atEnd);
   vecInfo.setVectorShape(*call, VectorShape::uni());
+  vecInfo.getLoweringStatistics().add(LoweringKind::Reduction, GetBlockLocation(atEnd));
   return *call;
 }
 
@@ -549,6 +561,7 @@ public:
     int lastDefIndex = lin.getIndex(exiting);
     auto * updateInst = cast<Instruction>(builder.CreateSelect(&exitMask, &val, lastTrackerState, "update_" + val.getName()));
     vecInfo.setVectorShape(*updateInst, VectorShape::varying());
+    vecInfo.getLoweringStatistics().add(LoweringKind::BlendSelect, val);
 
   // promote the partial def to all surrounding loops
     Value * currentLiveInDef = &tracker;
@@ -935,6 +948,7 @@ Linearizer::createSuperInput(PHINode & phi, SuperInput & superInput) {
   auto & phiBlock = *phi.getParent();
 
   auto phiShape = vecInfo.getVectorShape(phi);
+  DebugLoc phiLoc = phi.getDebugLoc() ? phi.getDebugLoc() : GetBlockLocation(phiBlock);
   for (int i = 1; i < blocks.size(); ++i) {
     auto * inBlock = blocks[i];
     auto * inVal = phi.getIncomingValueForBlock(inBlock);
@@ -964,6 +978,7 @@ Linearizer::createSuperInput(PHINode & phi, SuperInput & superInput) {
 
     blendedVal = builder.CreateSelect(edgeMask, inVal, blendedVal);
     vecInfo.setVectorShape(*blendedVal, phiShape);
+    vecInfo.getLoweringStatistics().add(LoweringKind::BlendSelect, phiLoc);
   }
 
   return blendedVal;
@@ -1487,6 +1502,9 @@ Linearizer::run() {
 // repair SSA (def/use chains that were broken by chain merging)
   fixSSA();
 
+// skip costly linearized blocks at runtime if no (or all) lanes are active
+  if (bosccThreshold > 0) insertBOSCC();
+
 // verify control integrity
   IF_DEBUG_LIN verify();
 }
@@ -1739,4 +1757,252 @@ Linearizer::fixSSA() {
 }
 
 
+uint
+Linearizer::getBlockCost(const BasicBlock & block) const {
+  uint cost = 0;
+  for (auto & inst : block) {
+    if (isa<PHINode>(inst) || isa<TerminatorInst>(inst)) continue;
+    // predicated memory accesses and calls need masking or cascades
+    if (isa<LoadInst>(inst) || isa<StoreInst>(inst) || isa<CallInst>(inst)) {
+      cost += 4;
+    } else {
+      cost += 1;
+    }
+  }
+  return cost;
+}
+
+bool
+Linearizer::collectPredicatedChain(BasicBlock & head, std::vector<BasicBlock*> & oChain) {
+  oChain.clear();
+  if (!inRegion(head) || li.isLoopHeader(&head)) return false;
+
+  // only divergent blocks profit from a dynamic mask test
+  auto * pred = vecInfo.getPredicate(head);
+  if (!pred || isa<Constant>(pred)) return false;
+
+  // the chain must be entered from an unconditional branch
+  auto * predBlock = head.getUniquePredecessor();
+  if (!predBlock || !inRegion(*predBlock)) return false;
+  auto * entryBranch = dyn_cast<BranchInst>(predBlock->getTerminator());
+  if (!entryBranch || entryBranch->isConditional()) return false;
+
+  // the mask must be available before the chain
+  auto * predInst = dyn_cast<Instruction>(pred);
+  if (predInst && !dt.dominates(predInst, entryBranch)) return false;
+
+  auto * loop = li.getLoopFor(&head);
+  if (li.getLoopFor(predBlock) != loop) return false;
+
+  auto * block = &head;
+  while (true) {
+    oChain.push_back(block);
+
+    auto * branch = dyn_cast<BranchInst>(block->getTerminator());
+    if (!branch || branch->isConditional()) return false;
+
+    // extend the chain along blocks with the same predicate
+    auto * next = branch->getSuccessor(0);
+    if (li.getLoopFor(next) != loop || li.isLoopHeader(next) || !inRegion(*next)) return false;
+    if (next->getUniquePredecessor() != block || vecInfo.getPredicate(*next) != pred) {
+      break;
+    }
+
+    block = next;
+  }
+
+  // masks that leave the chain must stay defined if the chain is skipped
+  SmallPtrSet<BasicBlock*, 8> chainBlocks(oChain.begin(), oChain.end());
+  for (auto * chainBlock : oChain) {
+    for (auto & inst : *chainBlock) {
+      if (!inst.getType()->isIntegerTy(1)) continue;
+      for (auto * user : inst.users()) {
+        if (!chainBlocks.count(cast<Instruction>(user)->getParent())) return false;
+      }
+    }
+  }
+
+  for (auto & block : func) {
+    if (chainBlocks.count(&block)) continue;
+    auto * blockPred = dyn_cast_or_null<Instruction>(vecInfo.getPredicate(block));
+    if (blockPred && chainBlocks.count(blockPred->getParent())) return false;
+  }
+
+  return true;
+}
+
+void
+Linearizer::insertBOSCCGuard(std::vector<BasicBlock*> & chain, bool unmaskedClone) {
+  auto & head = *chain.front();
+  auto & tail = *chain.back();
+  auto & predBlock = *head.getUniquePredecessor();
+  auto & succBlock = *tail.getTerminator()->getSuccessor(0);
+  auto & pred = *vecInfo.getPredicate(head);
+  auto * loop = li.getLoopFor(&head);
+  auto * entryPred = vecInfo.getPredicate(predBlock);
+
+  IF_DEBUG_LIN { errs() << "BOSCC: guarding chain " << head.getName() << " .. " << tail.getName() << " (unmasked clone: " << unmaskedClone << ")\n"; }
+
+  SmallPtrSet<BasicBlock*, 8> chainBlocks(chain.begin(), chain.end());
+
+  auto registerBlock = [&](BasicBlock & block) {
+    if (region) region->add(block);
+    if (loop) loop->addBasicBlockToLoop(&block, li);
+  };
+
+  auto retargetPhis = [](BasicBlock & block, BasicBlock & oldPred, BasicBlock & newPred) {
+    for (auto & inst : block) {
+      auto * phi = dyn_cast<PHINode>(&inst);
+      if (!phi) break;
+      int idx = phi->getBasicBlockIndex(&oldPred);
+      if (idx >= 0) phi->setIncomingBlock(idx, &newPred);
+    }
+  };
+
+// rv_any guard: skip the chain if no lane is active
+  auto * anyBlock = BasicBlock::Create(context, "boscc_any_" + head.getName(), &func, &head);
+  registerBlock(*anyBlock);
+  if (entryPred) vecInfo.setPredicate(*anyBlock, *entryPred);
+  predBlock.getTerminator()->replaceUsesOfWith(&head, anyBlock);
+  auto & anyCall = createReduction(pred, "rv_any", *anyBlock);
+
+  BasicBlock * activeBlock = &head;
+  BasicBlock * cloneTail = nullptr;
+  ValueToValueMapTy cloneMap;
+
+// rv_all guard: run an unpredicated copy of the chain if all lanes are active
+  if (unmaskedClone) {
+    auto * allBlock = BasicBlock::Create(context, "boscc_all_" + head.getName(), &func, &head);
+    registerBlock(*allBlock);
+    if (entryPred) vecInfo.setPredicate(*allBlock, *entryPred);
+    auto & allCall = createReduction(pred, "rv_all", *allBlock);
+
+    std::vector<BasicBlock*> clones;
+    for (auto * block : chain) {
+      auto * clone = CloneBasicBlock(block, cloneMap, ".unmasked", &func);
+      cloneMap[block] = clone;
+      clones.push_back(clone);
+      registerBlock(*clone);
+      vecInfo.setPredicate(*clone, *ConstantInt::getTrue(context));
+    }
+
+    for (auto * block : chain) {
+      for (auto & inst : *block) {
+        auto * clonedInst = cast<Instruction>(cloneMap[&inst]);
+        RemapInstruction(clonedInst, cloneMap, RF_IgnoreMissingEntries | RF_NoModuleLevelChanges);
+        if (vecInfo.hasKnownShape(inst)) {
+          vecInfo.setVectorShape(*clonedInst, vecInfo.getVectorShape(inst));
+        }
+      }
+    }
+
+    auto & cloneHead = *clones.front();
+    cloneTail = clones.back();
+    retargetPhis(head, predBlock, *allBlock);
+    retargetPhis(cloneHead, predBlock, *allBlock);
+
+    auto * allBranch = BranchInst::Create(&cloneHead, &head, &allCall, allBlock);
+    vecInfo.setVectorShape(*allBranch, VectorShape::uni());
+    activeBlock = allBlock;
+
+  } else {
+    retargetPhis(head, predBlock, *anyBlock);
+  }
+
+  auto * anyBranch = BranchInst::Create(activeBlock, &succBlock, &anyCall, anyBlock);
+  vecInfo.setVectorShape(*anyBranch, VectorShape::uni());
+
+// add the new incoming edges to the phis in the successor
+  auto getCloneValue = [&](Value * val) -> Value* {
+    auto it = cloneMap.find(val);
+    return it != cloneMap.end() ? (Value*) it->second : val;
+  };
+
+  auto definedInChain = [&](Value * val) {
+    auto * inst = dyn_cast<Instruction>(val);
+    return inst && chainBlocks.count(inst->getParent());
+  };
+
+  for (auto & inst : succBlock) {
+    auto * phi = dyn_cast<PHINode>(&inst);
+    if (!phi) break;
+    auto * inVal = phi->getIncomingValueForBlock(&tail);
+    phi->addIncoming(definedInChain(inVal) ? UndefValue::get(phi->getType()) : inVal, anyBlock);
+    if (cloneTail) phi->addIncoming(getCloneValue(inVal), cloneTail);
+  }
+
+// values that live out of the chain are undefined if the chain was skipped
+  std::vector<Use*> liveOutUses;
+  for (auto * block : chain) {
+    for (auto & inst : *block) {
+      for (auto & use : inst.uses()) {
+        auto * userInst = cast<Instruction>(use.getUser());
+        auto * userBlock = userInst->getParent();
+        if (auto * userPhi = dyn_cast<PHINode>(userInst)) {
+          userBlock = userPhi->getIncomingBlock(use);
+        }
+        if (!chainBlocks.count(userBlock)) liveOutUses.push_back(&use);
+      }
+    }
+  }
+
+  DenseMap<Instruction*, PHINode*> liveOutPhis;
+  for (auto * use : liveOutUses) {
+    auto * inst = cast<Instruction>(use->get());
+    auto & liveOutPhi = liveOutPhis[inst];
+    if (!liveOutPhi) {
+      liveOutPhi = PHINode::Create(inst->getType(), 3, inst->getName() + ".boscc", &*succBlock.begin());
+      for (auto * inBlock : predecessors(&succBlock)) {
+        if (inBlock == &tail) {
+          liveOutPhi->addIncoming(inst, inBlock);
+        } else if (inBlock == cloneTail) {
+          liveOutPhi->addIncoming(getCloneValue(inst), inBlock);
+        } else {
+          liveOutPhi->addIncoming(UndefValue::get(inst->getType()), inBlock);
+        }
+      }
+      if (vecInfo.hasKnownShape(*inst)) {
+        vecInfo.setVectorShape(*liveOutPhi, vecInfo.getVectorShape(*inst));
+      }
+    }
+    use->set(liveOutPhi);
+  }
+}
+
+void
+Linearizer::insertBOSCC() {
+  IF_DEBUG_LIN { errs() << "\n-- LIN: BOSCC (threshold " << bosccThreshold << ") --\n"; }
+
+  // the guards add blocks as we go, so only visit the original blocks
+  std::vector<BasicBlock*> blocks;
+  for (auto & block : func) {
+    if (inRegion(block)) blocks.push_back(&block);
+  }
+
+  SmallPtrSet<BasicBlock*, 32> visited;
+  std::vector<BasicBlock*> chain;
+  for (auto * block : blocks) {
+    if (visited.count(block)) continue;
+    if (!collectPredicatedChain(*block, chain)) continue;
+
+    uint cost = 0;
+    bool hasMemoryAccess = false;
+    for (auto * chainBlock : chain) {
+      visited.insert(chainBlock);
+      cost += getBlockCost(*chainBlock);
+      for (auto & inst : *chainBlock) {
+        hasMemoryAccess |= inst.mayReadOrWriteMemory();
+      }
+    }
+
+    if (cost <= bosccThreshold) continue;
+
+    // an unmasked copy only pays off if there are predicated memory accesses or calls
+    insertBOSCCGuard(chain, hasMemoryAccess);
+  }
+
+  dt.recalculate(func);
+}
+
+
 } // namespace rv
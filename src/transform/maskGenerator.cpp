@@ -10,6 +10,7 @@
 
 #include "rv/transform/maskGenerator.h"
 
+#include <functional>
 #include <stdexcept>
 
 #include <llvm/IR/Module.h>
@@ -55,7 +56,9 @@ MaskGenerator::MaskGenerator(VectorizationInfo& Vecinfo,
           mLoopInfo(Loopinfo),
           boolTy(nullptr),
           mConstBoolTrue(nullptr),
-          mConstBoolFalse(nullptr)
+          mConstBoolFalse(nullptr),
+          mMaskOps(),
+          mDomTree()
 {
   auto & context = Vecinfo.getContext();
   boolTy = Type::getInt1Ty(context);
@@ -76,6 +79,10 @@ MaskGenerator::generate(Function& F)
             errs() << "#########################################################\n";
     }
 
+    // Mask generation does not change the CFG.
+    mDomTree.recalculate(F);
+    mMaskOps.clear();
+
     // If an error occurred in one of the previous phases, abort.
     try {
         materializeMasks(F);
@@ -331,7 +338,7 @@ MaskGenerator::materializeMask(MaskPtr maskPtr)
 {
     assert (maskPtr);
 
-    Mask& mask = *maskPtr.get();
+    Mask& mask = *maskPtr;
 
     // Return if the mask is materialized already.
     if (mask.mValue) return mask.mValue;
@@ -342,7 +349,7 @@ MaskGenerator::materializeMask(MaskPtr maskPtr)
     {
         // The preheader mask is always the first one.
         assert (mask.mOperands.size() == 2);
-        MaskPtr preheaderMask = mask.mOperands[0].lock();
+        MaskPtr preheaderMask = mask.mOperands[0];
 
         // If mask is not yet materialized, do it.
         if (!preheaderMask->mValue) materializeMask(preheaderMask);
@@ -351,7 +358,7 @@ MaskGenerator::materializeMask(MaskPtr maskPtr)
     {
         for (unsigned i=0, e=mask.mOperands.size(); i<e; ++i)
         {
-            MaskPtr opMask = mask.mOperands[i].lock();
+            MaskPtr opMask = mask.mOperands[i];
 
             // Check if mask is already materialized.
             if (opMask->mValue) continue;
@@ -378,7 +385,7 @@ MaskGenerator::materializeMask(MaskPtr maskPtr)
         case NEGATE:
         {
             assert (mask.mOperands.size() == 1);
-            Value* mask0 = mask.mOperands[0].lock()->mValue;
+            Value* mask0 = mask.mOperands[0]->mValue;
 
             maskValue = createNeg(mask0, mask.mInsertPoint, maskName);
             break;
@@ -387,10 +394,10 @@ MaskGenerator::materializeMask(MaskPtr maskPtr)
         case CONJUNCTION:
         {
             assert (mask.mOperands.size() >= 2);
-            maskValue = mask.mOperands[0].lock()->mValue;
+            maskValue = mask.mOperands[0]->mValue;
             for (unsigned i=1, e=mask.mOperands.size(); i<e; ++i)
             {
-                Value* mask1 = mask.mOperands[i].lock()->mValue;
+                Value* mask1 = mask.mOperands[i]->mValue;
                 maskValue = createAnd(maskValue, mask1, mask.mInsertPoint, maskName);
             }
             break;
@@ -399,10 +406,10 @@ MaskGenerator::materializeMask(MaskPtr maskPtr)
         case DISJUNCTION:
         {
             assert (mask.mOperands.size() >= 2);
-            maskValue = mask.mOperands[0].lock()->mValue;
+            maskValue = mask.mOperands[0]->mValue;
             for (unsigned i=1, e=mask.mOperands.size(); i<e; ++i)
             {
-                Value* mask1 = mask.mOperands[i].lock()->mValue;
+                Value* mask1 = mask.mOperands[i]->mValue;
                 maskValue = createOr(maskValue, mask1, mask.mInsertPoint, maskName);
             }
 
@@ -412,9 +419,9 @@ MaskGenerator::materializeMask(MaskPtr maskPtr)
         case SELECT:
         {
             assert (mask.mOperands.size() == 3);
-            Value* condition = mask.mOperands[0].lock()->mValue;
-            Value* trueMask  = mask.mOperands[1].lock()->mValue;
-            Value* falseMask = mask.mOperands[2].lock()->mValue;
+            Value* condition = mask.mOperands[0]->mValue;
+            Value* trueMask  = mask.mOperands[1]->mValue;
+            Value* falseMask = mask.mOperands[2]->mValue;
             maskValue = createSelect(condition, trueMask, falseMask, mask.mInsertPoint, maskName);
             break;
         }
@@ -430,7 +437,7 @@ MaskGenerator::materializeMask(MaskPtr maskPtr)
 
             for (unsigned i=0; i<numIncVals; ++i)
             {
-                Value*      incMask = mask.mOperands[i].lock()->mValue;
+                Value*      incMask = mask.mOperands[i]->mValue;
                 BasicBlock* incBB   = mask.mIncomingDirs[i];
                 phi->addIncoming(incMask, incBB);
             }
@@ -457,14 +464,11 @@ MaskGenerator::materializeMask(MaskPtr maskPtr)
         {
             // Disjunction with exactly 2 operands.
             assert (mask.mOperands.size() == 2);
-            assert (isa<PHINode>(mask.mOperands[0].lock()->mValue));
-            Value* mask0 = mask.mOperands[0].lock()->mValue;
-            Value* mask1 = mask.mOperands[1].lock()->mValue;
-            maskValue = createOr(mask0, mask1, mask.mInsertPoint, maskName);
-            if (Instruction* maskValI = dyn_cast<Instruction>(maskValue))
-            {
-                maskValI->setName("loopMaskUpdate");
-            }
+            assert (isa<PHINode>(mask.mOperands[0]->mValue));
+            Value* mask0 = mask.mOperands[0]->mValue;
+            Value* mask1 = mask.mOperands[1]->mValue;
+            // only a newly created disjunction is named (createOr may return an existing mask)
+            maskValue = createOr(mask0, mask1, mask.mInsertPoint, "loopMaskUpdate");
             break;
         }
 
@@ -492,6 +496,101 @@ MaskGenerator::materializeMask(MaskPtr maskPtr)
     return maskValue;
 }
 
+// whether @mask is an instruction @opcode with operand @operand
+static bool
+HasOperand(Value* mask, unsigned opcode, Value* operand)
+{
+    auto* maskInstr = dyn_cast<BinaryOperator>(mask);
+    if (!maskInstr || maskInstr->getOpcode() != opcode) return false;
+    return maskInstr->getOperand(0) == operand || maskInstr->getOperand(1) == operand;
+}
+
+// whether @a == !@b
+static bool
+IsNegationOf(Value* a, Value* b)
+{
+    if (BinaryOperator::isNot(a) && BinaryOperator::getNotArgument(a) == b) return true;
+    if (BinaryOperator::isNot(b) && BinaryOperator::getNotArgument(b) == a) return true;
+    return false;
+}
+
+static std::tuple<unsigned, Value*, Value*, Value*>
+GetMaskOpKey(unsigned opcode, Value* operand0, Value* operand1 = nullptr, Value* operand2 = nullptr)
+{
+    // canonical operand order for commutative operations
+    if ((opcode == Instruction::And || opcode == Instruction::Or) && std::less<Value*>()(operand1, operand0))
+    {
+        std::swap(operand0, operand1);
+    }
+    return std::make_tuple(opcode, operand0, operand1, operand2);
+}
+
+Instruction*
+MaskGenerator::findMaskOp(const MaskOpKey& key, Instruction* insertPoint)
+{
+    auto it = mMaskOps.find(key);
+    if (it == mMaskOps.end()) return nullptr;
+
+    // only re-use an operation that is available at @insertPoint
+    for (Instruction* maskOp : it->second)
+    {
+        if (mDomTree.dominates(maskOp, insertPoint)) return maskOp;
+    }
+    return nullptr;
+}
+
+void
+MaskGenerator::addMaskOp(const MaskOpKey& key, Instruction& maskOp)
+{
+    mMaskOps[key].push_back(&maskOp);
+}
+
+Value*
+MaskGenerator::simplifyAnd(Value* operand0, Value* operand1)
+{
+    if (operand0 == operand1) return operand0;
+
+    if (operand0 == mConstBoolFalse || operand1 == mConstBoolFalse) return mConstBoolFalse;
+    if (operand0 == mConstBoolTrue) return operand1;
+    if (operand1 == mConstBoolTrue) return operand0;
+
+    // a & !a = false
+    if (IsNegationOf(operand0, operand1)) return mConstBoolFalse;
+
+    // a & (a | b) = a
+    if (HasOperand(operand1, Instruction::Or, operand0)) return operand0;
+    if (HasOperand(operand0, Instruction::Or, operand1)) return operand1;
+
+    // a & (a & b) = a & b
+    if (HasOperand(operand1, Instruction::And, operand0)) return operand1;
+    if (HasOperand(operand0, Instruction::And, operand1)) return operand0;
+
+    return nullptr;
+}
+
+Value*
+MaskGenerator::simplifyOr(Value* operand0, Value* operand1)
+{
+    if (operand0 == operand1) return operand0;
+
+    if (operand0 == mConstBoolTrue || operand1 == mConstBoolTrue) return mConstBoolTrue;
+    if (operand0 == mConstBoolFalse) return operand1;
+    if (operand1 == mConstBoolFalse) return operand0;
+
+    // a | !a = true
+    if (IsNegationOf(operand0, operand1)) return mConstBoolTrue;
+
+    // a | (a & b) = a
+    if (HasOperand(operand1, Instruction::And, operand0)) return operand0;
+    if (HasOperand(operand0, Instruction::And, operand1)) return operand1;
+
+    // a | (a | b) = a | b
+    if (HasOperand(operand1, Instruction::Or, operand0)) return operand1;
+    if (HasOperand(operand0, Instruction::Or, operand1)) return operand0;
+
+    return nullptr;
+}
+
 Value*
 MaskGenerator::createNeg(Value*       operand,
                          Instruction* insertPoint,
@@ -526,11 +625,15 @@ MaskGenerator::createNeg(Value*       operand,
         }
     }
 
+    MaskOpKey key = GetMaskOpKey(Instruction::Xor, operand);
+    if (Instruction* notI = findMaskOp(key, insertPoint)) return notI;
+
     Instruction* notI = BinaryOperator::CreateNot(operand,
                                                   name,
                                                   insertPoint);
 
     markMaskOperation(*notI);
+    addMaskOp(key, *notI);
 
     return notI;
 }
@@ -548,26 +651,10 @@ MaskGenerator::createAnd(Value*       operand0,
     assert (operand1->getType() == boolTy &&
             "trying to create bit-operation on non-boolean type!");
 
-    if (operand0 == operand1)
-    {
-        return operand0;
-    }
+    if (Value* simplified = simplifyAnd(operand0, operand1)) return simplified;
 
-    if (operand0 == mConstBoolFalse ||
-        operand1 == mConstBoolFalse)
-    {
-        return mConstBoolFalse;
-    }
-
-    if (operand0 == mConstBoolTrue)
-    {
-        return operand1;
-    }
-
-    if (operand1 == mConstBoolTrue)
-    {
-        return operand0;
-    }
+    MaskOpKey key = GetMaskOpKey(Instruction::And, operand0, operand1);
+    if (Instruction* andI = findMaskOp(key, insertPoint)) return andI;
 
     Instruction* andI = BinaryOperator::Create(Instruction::And,
                                                operand0,
@@ -576,6 +663,7 @@ MaskGenerator::createAnd(Value*       operand0,
                                                insertPoint);
 
     markMaskOperation(*andI);
+    addMaskOp(key, *andI);
 
     return andI;
 
@@ -594,26 +682,36 @@ MaskGenerator::createOr(Value*       operand0,
     assert (operand1->getType() == boolTy &&
             "trying to create bit-operation on non-boolean type!");
 
-    if (operand0 == operand1)
-    {
-        return operand0;
-    }
+    if (Value* simplified = simplifyOr(operand0, operand1)) return simplified;
 
-    if (operand0 == mConstBoolTrue ||
-        operand1 == mConstBoolTrue)
+    // Nested divergent control: the masks of all paths through a divergent region
+    // share the mask of the dominating block. (a & x) | (a & y) = a & (x | y),
+    // which is just a if the region is left over all paths (x | y = true).
+    auto* and0 = dyn_cast<BinaryOperator>(operand0);
+    auto* and1 = dyn_cast<BinaryOperator>(operand1);
+    if (and0 && and1 &&
+        and0->getOpcode() == Instruction::And &&
+        and1->getOpcode() == Instruction::And)
     {
-        return mConstBoolTrue;
-    }
+        for (unsigned i = 0; i < 2; ++i)
+        {
+            for (unsigned j = 0; j < 2; ++j)
+            {
+                if (and0->getOperand(i) != and1->getOperand(j)) continue;
 
-    if (operand0 == mConstBoolFalse)
-    {
-        return operand1;
+                Value* common = and0->getOperand(i);
+                Value* x      = and0->getOperand(1 - i);
+                Value* y      = and1->getOperand(1 - j);
+                if (Value* xy = simplifyOr(x, y))
+                {
+                    return createAnd(common, xy, insertPoint, name);
+                }
+            }
+        }
     }
 
-    if (operand1 == mConstBoolFalse)
-    {
-        return operand0;
-    }
+    MaskOpKey key = GetMaskOpKey(Instruction::Or, operand0, operand1);
+    if (Instruction* orI = findMaskOp(key, insertPoint)) return orI;
 
     Instruction* orI = BinaryOperator::Create(Instruction::Or,
                                               operand0,
@@ -622,6 +720,7 @@ MaskGenerator::createOr(Value*       operand0,
                                               insertPoint);
 
     markMaskOperation(*orI);
+    addMaskOp(key, *orI);
 
     return orI;
 }
@@ -657,6 +756,20 @@ MaskGenerator::createSelect(Value*       operand0,
         return operand2;
     }
 
+    // c ? true : false = c, c ? false : true = !c
+    if (operand1 == mConstBoolTrue && operand2 == mConstBoolFalse)
+    {
+        return operand0;
+    }
+
+    if (operand1 == mConstBoolFalse && operand2 == mConstBoolTrue)
+    {
+        return createNeg(operand0, insertPoint, name);
+    }
+
+    MaskOpKey key = GetMaskOpKey(Instruction::Select, operand0, operand1, operand2);
+    if (Instruction* select = findMaskOp(key, insertPoint)) return select;
+
     Instruction* select = SelectInst::Create(operand0,
                                              operand1,
                                              operand2,
@@ -664,6 +777,8 @@ MaskGenerator::createSelect(Value*       operand0,
                                              insertPoint);
 
     markMaskOperation(*select);
+    addMaskOp(key, *select);
+    mvecInfo.getLoweringStatistics().add(LoweringKind::BlendSelect, insertPoint->getDebugLoc());
 
     return select;
 }
@@ -677,7 +792,7 @@ MaskGenerator::createPhi(Mask& mask, const Twine& name)
                                    name,
                                    &*defBlock->getFirstInsertionPt());
 
-    Value*      preheaderMask = mask.mOperands[0].lock()->mValue;
+    Value*      preheaderMask = mask.mOperands[0]->mValue;
     BasicBlock* preheaderBB   = mask.mIncomingDirs[0];
     phi->addIncoming(preheaderMask, preheaderBB);
 
@@ -688,7 +803,7 @@ MaskGenerator::createPhi(Mask& mask, const Twine& name)
     mask.mValue = phi;
 
     // The latch mask is always the second one.
-    MaskPtr     latchMask = mask.mOperands[1].lock();
+    MaskPtr     latchMask = mask.mOperands[1];
     BasicBlock* latchBB   = mask.mIncomingDirs[1];
 
     // If mask is not yet materialized, do it.
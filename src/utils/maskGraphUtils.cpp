@@ -22,22 +22,16 @@ using namespace llvm;
 namespace rv {
 namespace MaskGraphUtils {
 
-static unsigned staticMaskID = 0;
-
-Mask::Mask(const NodeType type,
+Mask::Mask(const unsigned id,
+           const NodeType type,
            Instruction*   insertPoint)
-: mID(staticMaskID++),
+: mID(id),
         mType(type),
         mValue(nullptr),
         mInsertPoint(insertPoint)
 {
 }
 
-Mask::~Mask()
-{
-    // Nothing to do due to weak pointers.
-}
-
 bool
 Mask::operator==(const Mask& other) const
 {
@@ -51,7 +45,7 @@ Mask::operator==(const Mask& other) const
 
     for (unsigned i=0, e=mOperands.size(); i<e; ++i)
     {
-        if (mOperands[i].lock() != other.mOperands[i].lock()) return false;
+        if (mOperands[i] != other.mOperands[i]) return false;
     }
     for (unsigned i=0, e=mIncomingDirs.size(); i<e; ++i)
     {
@@ -92,7 +86,7 @@ Mask::print(raw_ostream& o) const
 
     for (unsigned i=0, e=mOperands.size(); i<e; ++i)
     {
-        o << mOperands[i].lock()->mID;
+        o << mOperands[i]->mID;
         if (i+1 != e) o << ", ";
     }
 
@@ -110,17 +104,6 @@ Mask::print(raw_ostream& o) const
     o << " )";
 }
 
-BlockMaskInfo::~BlockMaskInfo()
-{
-    mEntryMask.reset();
-
-    for (auto &it : mExitMasks)
-    {
-        MaskPtr mp = it;
-        mp.reset();
-    }
-}
-
 void
 BlockMaskInfo::print(raw_ostream& o) const
 {
@@ -136,12 +119,6 @@ BlockMaskInfo::print(raw_ostream& o) const
     }
 }
 
-LoopMaskInfo::~LoopMaskInfo()
-{
-    mMaskPhi.reset();
-    mCombinedLoopExitMask.reset();
-}
-
 void
 LoopMaskInfo::print(raw_ostream& o) const
 {
@@ -150,18 +127,6 @@ LoopMaskInfo::print(raw_ostream& o) const
     o << "  combined exit mask: "; if (mCombinedLoopExitMask) mCombinedLoopExitMask->print(o); else o << "null"; o << "\n";
 }
 
-LoopExitMaskInfo::~LoopExitMaskInfo()
-{
-    for (auto &it : mMaskPhiMap)
-    {
-        it.second.reset();
-    }
-    for (auto &it : mMaskUpdateOpMap)
-    {
-        it.second.reset();
-    }
-}
-
 void
 LoopExitMaskInfo::print(raw_ostream& o) const
 {
@@ -95,9 +95,16 @@ VectorizationInfo::dump() const
     out << "}\n";
 }
 
+void
+VectorizationInfo::numberBlocks(const Function & fn)
+{
+    for (const BasicBlock & block : fn) blockIndex.insert(block);
+}
+
 VectorizationInfo::VectorizationInfo(llvm::Function& parentFn, uint vectorWidth, Region& _region)
 : mapping(&parentFn, &parentFn, vectorWidth), region(&_region)
 {
+    numberBlocks(parentFn);
     mapping.resultShape = VectorShape::uni();
     for (auto& arg : parentFn.getArgumentList()) {
       (void) arg;
@@ -110,6 +117,7 @@ VectorizationInfo::VectorizationInfo(VectorMapping _mapping)
 : mapping(_mapping), region(nullptr)
 {
   assert(mapping.argShapes.size() == mapping.scalarFn->getArgumentList().size());
+  numberBlocks(*mapping.scalarFn);
   auto& argList = mapping.scalarFn->getArgumentList();
   auto it = argList.begin();
   for (auto argShape : mapping.argShapes)
@@ -122,23 +130,27 @@ VectorizationInfo::VectorizationInfo(VectorMapping _mapping)
 bool
 VectorizationInfo::hasKnownShape(const llvm::Value& val) const
 {
-    return (bool) shapes.count(&val);
+    return shapes.count(val);
 }
 
 VectorShape
 VectorizationInfo::getVectorShape(const llvm::Value& val) const
 {
-    auto it = shapes.find(&val);
-    assert (it != shapes.end());
-    return it->second;
+    const VectorShape * shape = shapes.lookup(val);
+    assert (shape);
+    return *shape;
 }
 
 void
 VectorizationInfo::dropVectorShape(const Value& val)
 {
-    auto it = shapes.find(&val);
-    if (it == shapes.end()) return;
-    shapes.erase(it);
+    shapes.erase(val);
+}
+
+void
+VectorizationInfo::setVectorShapes(ShapeMap && newShapes)
+{
+    shapes = std::move(newShapes);
 }
 
 void
@@ -152,7 +164,7 @@ VectorizationInfo::dropPredicate(const BasicBlock& block)
 void
 VectorizationInfo::setVectorShape(const llvm::Value& val, VectorShape shape)
 {
-    shapes[&val] = shape;
+    shapes[val] = shape;
 }
 
 llvm::Value*
@@ -204,49 +216,49 @@ VectorizationInfo::isDivergentLoopTopLevel(const llvm::Loop* loop) const
 void
 VectorizationInfo::markAlwaysByAll(const llvm::BasicBlock* BB)
 {
-    ABABlocks.insert(BB);
+    ABABlocks.set(blockIndex.insert(*BB));
 }
 
 void
 VectorizationInfo::markAlwaysByAllOrNone(const llvm::BasicBlock* BB)
 {
-    ABAONBlocks.insert(BB);
+    ABAONBlocks.set(blockIndex.insert(*BB));
 }
 
 void
 VectorizationInfo::markNotAlwaysByAll(const llvm::BasicBlock* BB)
 {
-    NotABABlocks.insert(BB);
+    NotABABlocks.set(blockIndex.insert(*BB));
 }
 
 bool
 VectorizationInfo::isAlwaysByAll(const llvm::BasicBlock* BB) const
 {
-    return (bool) ABABlocks.count(BB);
+    return ABABlocks.test(blockIndex.find(*BB));
 }
 
 bool
 VectorizationInfo::isAlwaysByAllOrNone(const llvm::BasicBlock* BB) const
 {
-    return (bool) ABAONBlocks.count(BB);
+    return ABAONBlocks.test(blockIndex.find(*BB));
 }
 
 bool
 VectorizationInfo::isNotAlwaysByAll(const llvm::BasicBlock* BB) const
 {
-    return (bool) NotABABlocks.count(BB);
+    return NotABABlocks.test(blockIndex.find(*BB));
 }
 
 void
 VectorizationInfo::markMandatory(const BasicBlock* BB)
 {
-    MandatoryBlocks.insert(BB);
+    MandatoryBlocks.set(blockIndex.insert(*BB));
 }
 
 bool
 VectorizationInfo::isMandatory(const BasicBlock* BB) const
 {
-    return (bool) MandatoryBlocks.count(BB);
+    return MandatoryBlocks.test(blockIndex.find(*BB));
 }
 
 void
@@ -0,0 +1,87 @@
+#!/usr/bin/env python3
+#
+#===- bench_analysis.py ---------------------------------------------------===//
+#
+#                     The Region Vectorizer
+#
+# This file is distributed under the University of Illinois Open Source
+# License. See LICENSE.TXT for details.
+#
+#
+# Analysis-time benchmark.
+# Vectorizes the outer-loop kernels of suite/ and synthetic loop nests of increasing depth
+# (every nested loop has a varying trip count, so divergence has to be propagated through all of them).
+# usage: ./bench_analysis.py [depth ...] (default: depth 4 .. 64)
+# The per-phase time reports of rvTool are written to logs/*.time.json.
+#
+
+import time
+from glob import glob
+from binaries import *
+from os import path
+
+def writeLoopNest(srcFile, depth):
+  with open(srcFile, "w") as f:
+    f.write("extern \"C\" void\nfoo(int * A, int n) {\n")
+    f.write("  for (int i = 0; i < n; ++i) {\n")
+    f.write("    int t = A[i];\n")
+    for d in range(depth):
+      indent = "    " + "  " * d
+      f.write("{}for (int j{} = 0; j{} < (A[i] & {}); ++j{}) {{\n".format(indent, d, d, d + 1, d))
+      f.write("{}  t = t * 3 + j{};\n".format(indent, d))
+    for d in reversed(range(depth)):
+      f.write("    " + "  " * d + "}\n")
+    f.write("    A[i] = t;\n  }\n}\n")
+
+def readOptions(srcFile):
+  with open(srcFile, 'r') as f:
+    options = f.readline().strip("//").strip("\n").strip()
+
+  config = {}
+  for option in options.split(","):
+    opSplit = option.split(":")
+    if len(opSplit) == 2:
+      config[opSplit[0].strip()] = opSplit[1].strip()
+  return config
+
+def timeVectorize(scalarLL, vectorLL, logPrefix, config):
+  start = time.time()
+  ret = runOuterLoopVec(scalarLL, vectorLL, "foo", config.get("LoopHint"), logPrefix, config.get("Tail"),
+                        config.get("BOSCC"), config.get("Width"), config.get("Lanes"), timeReport=logPrefix + ".time.json")
+  return time.time() - start if ret == 0 else None
+
+def report(name, elapsed):
+  if elapsed is None:
+    print("{:50} vectorization failed".format(name))
+  else:
+    print("{:50} {:>10.3f}".format(name, elapsed))
+
+if len(sys.argv) > 1:
+  depths = [int(arg) for arg in sys.argv[1:]]
+else:
+  depths = [4 * (1 << k) for k in range(5)]
+
+print("-- RV analysis benchmark --")
+print("{:50} {:>10}".format("kernel", "rvTool [s]"))
+
+tests = [testCase for testCase in glob("suite/*-loop.c*")]
+tests.sort()
+total = 0.0
+for testCase in tests:
+  baseName = path.basename(testCase)
+  scalarLL = buildScalarIR(testCase)
+  elapsed = timeVectorize(scalarLL, "build/" + baseName + ".bench.ll", "logs/" + baseName + ".bench", readOptions(testCase))
+  report(baseName, elapsed)
+  total += elapsed or 0.0
+report("suite total", total)
+
+for depth in depths:
+  srcFile = "build/bench_nest_{}.cpp".format(depth)
+  scalarLL = "build/bench_nest_{}.ll".format(depth)
+  writeLoopNest(srcFile, depth)
+  if compileToIR(srcFile, scalarLL) != 0:
+    print("{:50} could not compile kernel".format("loop nest depth {}".format(depth)))
+    continue
+
+  elapsed = timeVectorize(scalarLL, "build/bench_nest_{}.loopvec.ll".format(depth), "logs/bench_nest_{}".format(depth), {})
+  report("loop nest depth {}".format(depth), elapsed)
@@ -0,0 +1,54 @@
+#!/usr/bin/env python3
+#
+#===- bench_codegen.py ---------------------------------------------------===//
+#
+#                     The Region Vectorizer
+#
+# This file is distributed under the University of Illinois Open Source
+# License. See LICENSE.TXT for details.
+#
+#
+# Compile-time benchmark for the native backend.
+# Vectorizes synthetic loops with N loads that are all defined before their first use
+# (every load stays in NatBuilder's lazy instruction queue until it is consumed).
+# usage: ./bench_codegen.py [N ...] (default: 1k .. 64k loads)
+#
+
+import time
+from binaries import *
+
+def writeKernel(srcFile, numLoads):
+  with open(srcFile, "w") as f:
+    f.write("extern \"C\" int\nfoo(int * A, int n) {\n")
+    f.write("  int s = 0;\n")
+    f.write("  for (int i = 0; i < n; ++i) {\n")
+    for k in range(numLoads):
+      f.write("    int v{} = A[i + {} * n];\n".format(k, k))
+    for k in range(numLoads):
+      f.write("    s = s * 3 + v{};\n".format(k))
+    f.write("  }\n  return s;\n}\n")
+
+if len(sys.argv) > 1:
+  sizes = [int(arg) for arg in sys.argv[1:]]
+else:
+  sizes = [1024 * (1 << k) for k in range(7)]
+
+print("-- RV code generation benchmark --")
+print("{:>8} {:>12} {:>14}".format("loads", "rvTool [s]", "per load [us]"))
+for numLoads in sizes:
+  srcFile = "build/bench_loads_{}.cpp".format(numLoads)
+  scalarLL = "build/bench_loads_{}.ll".format(numLoads)
+  vectorLL = "build/bench_loads_{}.loopvec.ll".format(numLoads)
+  writeKernel(srcFile, numLoads)
+  if compileToIR(srcFile, scalarLL) != 0:
+    print("{:>8} could not compile kernel".format(numLoads))
+    continue
+
+  start = time.time()
+  ret = runOuterLoopVec(scalarLL, vectorLL, "foo", None, "logs/bench_loads_{}".format(numLoads), "remainder")
+  elapsed = time.time() - start
+  if ret != 0:
+    print("{:>8} vectorization failed".format(numLoads))
+    continue
+
+  print("{:>8} {:>12.3f} {:>14.2f}".format(numLoads, elapsed, elapsed * 1e6 / numLoads))
@@ -0,0 +1,61 @@
+#!/usr/bin/env python3
+#
+#===- bench_masks.py ---------------------------------------------------===//
+#
+#                     The Region Vectorizer
+#
+# This file is distributed under the University of Illinois Open Source
+# License. See LICENSE.TXT for details.
+#
+#
+# Mask analysis stress benchmark (in the spirit of test_039_pdastress).
+# Whole-function vectorizes generated state machines with N blocks. Every block branches
+# on a varying condition to one of the next blocks, so every block has a non-trivial mask.
+# usage: ./bench_masks.py [N ...] (default: 1k, 2.5k, 5k, 10k blocks)
+# The per-phase time reports of rvTool are written to logs/bench_masks_N.time.json.
+#
+
+import time
+from binaries import *
+
+def writeStateMachine(srcFile, numBlocks):
+  with open(srcFile, "w") as f:
+    f.write("extern \"C\" float\nfoo(float u, float t) {\n")
+    f.write("  float v = u;\n")
+    f.write("  goto B0;\n")
+    for k in range(numBlocks):
+      f.write("B{}:\n".format(k))
+      f.write("  v = v * 0.5f + {}.0f;\n".format(k % 7))
+      if k + 1 == numBlocks:
+        f.write("  goto end;\n")
+      elif k + 2 == numBlocks or k % 3 == 2:
+        f.write("  if (t > v) goto B{}; else goto end;\n".format(k + 1))
+      else:
+        f.write("  if (t > v) goto B{}; else goto B{};\n".format(k + 1, k + 2))
+    f.write("end:\n  return v;\n}\n")
+
+if len(sys.argv) > 1:
+  sizes = [int(arg) for arg in sys.argv[1:]]
+else:
+  sizes = [1000, 2500, 5000, 10000]
+
+print("-- RV mask analysis benchmark --")
+print("{:>8} {:>12} {:>15}".format("blocks", "rvTool [s]", "per block [us]"))
+for numBlocks in sizes:
+  srcFile = "build/bench_masks_{}.cpp".format(numBlocks)
+  scalarLL = "build/bench_masks_{}.ll".format(numBlocks)
+  vectorLL = "build/bench_masks_{}.wfv.ll".format(numBlocks)
+  writeStateMachine(srcFile, numBlocks)
+  if compileToIR(srcFile, scalarLL) != 0:
+    print("{:>8} could not compile kernel".format(numBlocks))
+    continue
+
+  start = time.time()
+  ret = runWFV(scalarLL, vectorLL, "foo", "U_TrT", "logs/bench_masks_{}".format(numBlocks),
+               timeReport="logs/bench_masks_{}.time.json".format(numBlocks))
+  elapsed = time.time() - start
+  if ret != 0:
+    print("{:>8} vectorization failed".format(numBlocks))
+    continue
+
+  print("{:>8} {:>12.3f} {:>15.2f}".format(numBlocks, elapsed, elapsed * 1e6 / numBlocks))
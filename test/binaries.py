@@ -69,13 +69,13 @@ def rvClang(clangArgs):
 def plainName(fileName):
     return os.path.basename(fileName).split(".")[0]
 
-def buildScalarIR(srcFile):
+def buildScalarIR(srcFile, clangArgs=""):
     baseName = plainName(srcFile)
     scalarLL = "build/" + baseName + ".ll"
-    compileToIR(srcFile, scalarLL)
+    compileToIR(srcFile, scalarLL, clangArgs)
     return scalarLL
 
-def runOuterLoopVec(scalarLL, destFile, scalarName = "foo", loopDesc=None, logPrefix=None):
+def runOuterLoopVec(scalarLL, destFile, scalarName = "foo", loopDesc=None, logPrefix=None, tailStrategy=None, bosccThreshold=None, vectorWidth=None, laneIteration=None, alignStrategy=None, timeReport=None, remarksFile=None):
     baseName = plainName(scalarLL)
     cmd = rvToolLine + " -loopvec -i " + scalarLL
     if destFile:
@@ -84,10 +84,24 @@ def runOuterLoopVec(scalarLL, destFile, scalarName = "foo", loopDesc=None, logPr
       cmd = cmd + " -k " + scalarName
     if loopDesc:
       cmd = cmd + " -l " + loopDesc
+    if tailStrategy:
+      cmd = cmd + " -tail " + tailStrategy
+    if vectorWidth:
+      cmd = cmd + " -w " + vectorWidth
+    if bosccThreshold:
+      cmd = cmd + " -boscc -boscc-threshold " + bosccThreshold
+    if laneIteration:
+      cmd = cmd + " -lanes " + laneIteration
+    if alignStrategy == "peel":
+      cmd = cmd + " -peel-align"
+    if timeReport:
+      cmd = cmd + " -time-report " + timeReport
+    if remarksFile:
+      cmd = cmd + " -pass-remarks-output " + remarksFile
 
     return shellCmd(cmd,  None, logPrefix)
 
-def runWFV(scalarLL, destFile, scalarName = "foo", shapes=None, logPrefix=None):
+def runWFV(scalarLL, destFile, scalarName = "foo", shapes=None, logPrefix=None, bosccThreshold=None, timeReport=None, vectorWidth=None, remarksFile=None):
     cmd = rvToolLine + " -wfv -lower -i " + scalarLL
     if destFile:
       cmd = cmd + " -o " + destFile
@@ -95,6 +109,14 @@ def runWFV(scalarLL, destFile, scalarName = "foo", shapes=None, logPrefix=None):
       cmd = cmd + " -k " + scalarName
     if shapes:
       cmd = cmd + " -s " + shapes
+    if vectorWidth:
+      cmd = cmd + " -w " + str(vectorWidth)
+    if bosccThreshold:
+      cmd = cmd + " -boscc -boscc-threshold " + bosccThreshold
+    if timeReport:
+      cmd = cmd + " -time-report " + timeReport
+    if remarksFile:
+      cmd = cmd + " -pass-remarks-output " + remarksFile
 
     return shellCmd(cmd,  None, logPrefix)
 
@@ -132,11 +154,11 @@ def runOuterLoopTest(testBC, launchCode, suffix):
   except:
       return None
 
-def compileToIR(srcFile, destFile):
+def compileToIR(srcFile, destFile, clangArgs=""):
     if srcFile[-2:] == ".c":
-      return shellCmd(cClangLine + " " + srcFile + " -fno-unroll-loops -S -emit-llvm -c -o " + destFile)
+      return shellCmd(cClangLine + " " + clangArgs + " " + srcFile + " -fno-unroll-loops -S -emit-llvm -c -o " + destFile)
     else:
-      return shellCmd(clangLine + " " + srcFile + " -fno-unroll-loops -S -emit-llvm -c -o " + destFile)
+      return shellCmd(clangLine + " " + clangArgs + " " + srcFile + " -fno-unroll-loops -S -emit-llvm -c -o " + destFile)
 
 def disassemble(bcFile,suffix):
     return shellCmd("llvm-dis " + bcFile, "logs/dis_" + suffix) == 0
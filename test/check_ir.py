@@ -0,0 +1,491 @@
+#!/usr/bin/env python3
+#
+#===- check_ir.py ---------------------------------------------------===//
+#
+#                     The Region Vectorizer
+#
+# This file is distributed under the University of Illinois Open Source
+# License. See LICENSE.TXT for details.
+#
+#
+# Checks on the IR that rvTool emits for hand-written kernels (properties that the
+# hash comparison of test_rv.py can not observe).
+# The AVX-512 checks only inspect the IR, they do not need an AVX-512 host.
+# usage: ./check_ir.py [check ...] (default: all checks)
+#
+
+import re
+from binaries import *
+
+def countMatches(irFile, pattern):
+  with open(irFile, "r") as f:
+    return len(re.findall(pattern, f.read()))
+
+# mask operations on vectors of i1
+maskAnd = r"= and <\d+ x i1>"
+maskOr = r"= or <\d+ x i1>"
+
+# a & !a: the inner else branch is never taken (c & !c = false), all joins fold back to c and true
+maskNegKernel = """
+define float @foo(float %u, float %t) {
+entry:
+  %c = fcmp ogt float %t, %u
+  br i1 %c, label %then, label %join
+then:
+  %x = fmul float %u, 2.000000e+00
+  br i1 %c, label %inner, label %dead
+inner:
+  %y = fadd float %x, 1.000000e+00
+  br label %thenjoin
+dead:
+  %z = fsub float %x, 1.000000e+00
+  br label %thenjoin
+thenjoin:
+  %v = phi float [ %y, %inner ], [ %z, %dead ]
+  br label %join
+join:
+  %r = phi float [ %v, %thenjoin ], [ %u, %entry ]
+  ret float %r
+}
+"""
+
+# (a & b) | (a & !b) = a: the nested diamond joins with the mask of its entry
+maskJoinKernel = """
+define float @foo(float %u, float %t) {
+entry:
+  %c = fcmp ogt float %t, %u
+  %d = fcmp olt float %t, 1.000000e+00
+  br i1 %c, label %a, label %join
+a:
+  br i1 %d, label %b, label %e
+b:
+  %y = fadd float %u, 1.000000e+00
+  br label %ajoin
+e:
+  %z = fsub float %u, 1.000000e+00
+  br label %ajoin
+ajoin:
+  %v = phi float [ %y, %b ], [ %z, %e ]
+  br label %join
+join:
+  %r = phi float [ %v, %ajoin ], [ %u, %entry ]
+  ret float %r
+}
+"""
+
+# the second diamond on %d has the same edge masks (c & d, c & !d) as the first one and reuses them
+maskReuseKernel = """
+define float @foo(float %u, float %t) {
+entry:
+  %c = fcmp ogt float %t, %u
+  %d = fcmp olt float %t, 1.000000e+00
+  br i1 %c, label %a, label %join
+a:
+  br i1 %d, label %b, label %e
+b:
+  %y = fadd float %u, 1.000000e+00
+  br label %ajoin
+e:
+  %z = fsub float %u, 1.000000e+00
+  br label %ajoin
+ajoin:
+  %v = phi float [ %y, %b ], [ %z, %e ]
+  br i1 %d, label %b2, label %e2
+b2:
+  %y2 = fmul float %v, 2.000000e+00
+  br label %a2join
+e2:
+  %z2 = fmul float %v, 3.000000e+00
+  br label %a2join
+a2join:
+  %w = phi float [ %y2, %b2 ], [ %z2, %e2 ]
+  br label %join
+join:
+  %r = phi float [ %w, %a2join ], [ %u, %entry ]
+  ret float %r
+}
+"""
+
+def checkMasks(name, kernel, maxAnds, maxOrs):
+  scalarLL = "build/check_{}.ll".format(name)
+  vectorLL = "build/check_{}.wfv.ll".format(name)
+  with open(scalarLL, "w") as f:
+    f.write(kernel)
+  if runWFV(scalarLL, vectorLL, "foo", "T_TrT", "logs/check_{}".format(name)) != 0:
+    return False
+  numAnds = countMatches(vectorLL, maskAnd)
+  numOrs = countMatches(vectorLL, maskOr)
+  if numAnds > maxAnds or numOrs > maxOrs:
+    print("({} mask and, {} mask or) ".format(numAnds, numOrs), end="")
+    return False
+  return True
+
+# AVX-512: SLEEF functions with 16 floats and 8 doubles, predicate register tests (no zext of the mask)
+avx512SleefSPKernel = """
+define float @foo(float %u, float %t) #0 {
+entry:
+  %a = call float @atanf(float %u) #1
+  ret float %a
+}
+
+declare float @atanf(float) #1
+
+attributes #0 = { nounwind "target-features"="+avx512f" }
+attributes #1 = { nounwind readnone }
+"""
+
+avx512SleefDPKernel = """
+define double @foo(double %u, double %t) #0 {
+entry:
+  %a = call double @atan(double %u) #1
+  ret double %a
+}
+
+declare double @atan(double) #1
+
+attributes #0 = { nounwind "target-features"="+avx512f" }
+attributes #1 = { nounwind readnone }
+"""
+
+avx512MaskKernel = """
+define float @foo(float %u, float %t) #0 {
+entry:
+  %c = fcmp ogt float %t, %u
+  %any = call i1 @rv_any(i1 %c)
+  %ballot = call i32 @rv_ballot(i1 %c)
+  %bf = sitofp i32 %ballot to float
+  %r = select i1 %any, float %u, float %bf
+  ret float %r
+}
+
+declare i1 @rv_any(i1) #1
+declare i32 @rv_ballot(i1) #1
+
+attributes #0 = { nounwind "target-features"="+avx512f" }
+attributes #1 = { nounwind readnone convergent }
+"""
+
+# predicated contiguous load and store: without target features the masked intrinsics are kept (the backend legalizes them),
+# a target without masked moves (SSE only, the TTI of rvTool has no target machine) falls back to per-lane cascades
+maskedMemoryKernel = """
+define float @foo(float* %p, i32 %i, float %t) {
+entry:
+  %c = fcmp ogt float %t, 0.000000e+00
+  br i1 %c, label %then, label %join
+then:
+  %gep = getelementptr float, float* %p, i32 %i
+  %v = load float, float* %gep, align 4
+  %w = fadd float %v, 1.000000e+00
+  store float %w, float* %gep, align 4
+  br label %join
+join:
+  %r = phi float [ %w, %then ], [ %t, %entry ]
+  ret float %r
+}
+"""
+
+cascadeFallbackKernel = """
+define float @foo(float* %p, i32 %i, float %t) #0 {
+entry:
+  %c = fcmp ogt float %t, 0.000000e+00
+  br i1 %c, label %then, label %join
+then:
+  %gep = getelementptr float, float* %p, i32 %i
+  %v = load float, float* %gep, align 4
+  %w = fadd float %v, 1.000000e+00
+  store float %w, float* %gep, align 4
+  br label %join
+join:
+  %r = phi float [ %w, %then ], [ %t, %entry ]
+  ret float %r
+}
+
+attributes #0 = { nounwind "target-features"="+sse2,+sse4.2" }
+"""
+
+def checkPatterns(name, kernel, vectorWidth, expected, unexpected, shapes="T_TrT"):
+  scalarLL = "build/check_{}.ll".format(name)
+  vectorLL = "build/check_{}.wfv.ll".format(name)
+  with open(scalarLL, "w") as f:
+    f.write(kernel)
+  if runWFV(scalarLL, vectorLL, "foo", shapes, "logs/check_{}".format(name), vectorWidth=vectorWidth) != 0:
+    return False
+  for pattern in expected:
+    if countMatches(vectorLL, pattern) == 0:
+      print("(missing {}) ".format(pattern), end="")
+      return False
+  for pattern in unexpected:
+    if countMatches(vectorLL, pattern) > 0:
+      print("(unexpected {}) ".format(pattern), end="")
+      return False
+  return True
+
+# loop tests of suite/ (vectorized with a scalar remainder loop)
+def checkLoopPatterns(name, srcFile, clangArgs, vectorWidth, expected, unexpected, loopDesc="0"):
+  scalarLL = "build/check_{}.ll".format(name)
+  vectorLL = "build/check_{}.loopvec.ll".format(name)
+  if compileToIR("suite/" + srcFile, scalarLL, clangArgs) != 0:
+    return False
+  if runOuterLoopVec(scalarLL, vectorLL, "foo", loopDesc, "logs/check_{}".format(name), "remainder", vectorWidth=str(vectorWidth)) != 0:
+    return False
+  for pattern in expected:
+    if countMatches(vectorLL, pattern) == 0:
+      print("(missing {}) ".format(pattern), end="")
+      return False
+  for pattern in unexpected:
+    if countMatches(vectorLL, pattern) > 0:
+      print("(unexpected {}) ".format(pattern), end="")
+      return False
+  return True
+
+# the index of a min/max has to be an induction: the position of B[i] is not, rvTool has to refuse the loop
+argminPayloadSource = """
+extern "C" int
+foo(int * A, int * B, int n) {
+  int m = A[0];
+  int idx = 0;
+  for (int i = 0; i < n; ++i) {
+    if (A[i] < m) {
+      m = A[i];
+      idx = B[i];
+    }
+  }
+  return idx;
+}
+"""
+
+# loop selection of rvTool -l (meta, line:N, all): number of vectorized loops (one vec.middle block per loop)
+def checkLoopSelection(name, srcFile, loopDesc, clangArgs, numLoops, expected):
+  scalarLL = "build/check_{}.ll".format(name)
+  vectorLL = "build/check_{}.loopvec.ll".format(name)
+  if compileToIR("suite/" + srcFile, scalarLL, clangArgs) != 0:
+    return False
+  if runOuterLoopVec(scalarLL, vectorLL, "foo", loopDesc, "logs/check_{}".format(name), "remainder") != 0:
+    return False
+  numVectorized = countMatches(vectorLL, r"(?m)^vec\.middle\d*:")
+  if numVectorized != numLoops:
+    print("({} vectorized loops) ".format(numVectorized), end="")
+    return False
+  for pattern in expected:
+    if countMatches(vectorLL, pattern) == 0:
+      print("(missing {}) ".format(pattern), end="")
+      return False
+  return True
+
+# -w auto ranks the widths with the TTI of a target machine, IR without a target triple falls back to the default width
+autoWidthKernel = """
+define void @foo(float* %A, i32 %n) {
+entry:
+  %guard = icmp sgt i32 %n, 0
+  br i1 %guard, label %preheader, label %exit
+preheader:
+  br label %loop
+loop:
+  %i = phi i32 [ 0, %preheader ], [ %i.next, %loop ]
+  %gep = getelementptr float, float* %A, i32 %i
+  %v = load float, float* %gep, align 4
+  %w = fmul float %v, 2.000000e+00
+  store float %w, float* %gep, align 4
+  %i.next = add nsw i32 %i, 1
+  %cond = icmp slt i32 %i.next, %n
+  br i1 %cond, label %loop, label %loopexit
+loopexit:
+  br label %exit
+exit:
+  ret void
+}
+"""
+
+def checkAutoWidth(name, scalarLL, expected, unexpected):
+  vectorLL = "build/check_{}.loopvec.ll".format(name)
+  logPrefix = "logs/check_{}".format(name)
+  if runOuterLoopVec(scalarLL, vectorLL, "foo", "0", logPrefix, "remainder", vectorWidth="auto") != 0:
+    return False
+  for pattern in expected:
+    if countMatches(logPrefix + ".err", pattern) == 0:
+      print("(missing {}) ".format(pattern), end="")
+      return False
+  for pattern in unexpected:
+    if countMatches(logPrefix + ".err", pattern) > 0:
+      print("(unexpected {}) ".format(pattern), end="")
+      return False
+  return True
+
+def checkAutoWidthTarget():
+  scalarLL = "build/check_auto_width.ll"
+  if compileToIR("suite/test_053_autowidth-loop.cpp", scalarLL) != 0:
+    return False
+  return checkAutoWidth("auto_width", scalarLL, [r"Vector width ranking"], [r"falls back"])
+
+def checkAutoWidthFallback():
+  scalarLL = "build/check_auto_width_fallback.ll"
+  with open(scalarLL, "w") as f:
+    f.write(autoWidthKernel)
+  return checkAutoWidth("auto_width_fallback", scalarLL, [r"falls back to the vector width 8", r"Selected vector width 8"],
+                        [r"Vector width ranking"])
+
+# the accessed range of A[B[i]] can not be computed: without -no-alias-check the loop has to stay scalar
+indirectStoreSource = """
+extern "C" int
+foo(int * A, int * B, int n) {
+  for (int i = 0; i < n; ++i) {
+    A[B[i]] = A[i] + 1;
+  }
+  return 0;
+}
+"""
+
+def checkAliasFallback(name, source):
+  srcFile = "build/check_{}.cpp".format(name)
+  scalarLL = "build/check_{}.ll".format(name)
+  vectorLL = "build/check_{}.loopvec.ll".format(name)
+  logPrefix = "logs/check_{}".format(name)
+  with open(srcFile, "w") as f:
+    f.write(source)
+  if compileToIR(srcFile, scalarLL) != 0:
+    return False
+  if runOuterLoopVec(scalarLL, vectorLL, "foo", "0", logPrefix, "remainder") != 0:
+    return False
+  if countMatches(logPrefix + ".err", r"the loop stays scalar") == 0 or countMatches(vectorLL, r"<\d+ x i32>") > 0:
+    print("(vectorized without alias check) ", end="")
+    return False
+  return True
+
+# an induction with a runtime step that controls the loop exit (i += k) is not supported yet, rvTool has to refuse it
+runtimeStepExitSource = """
+extern "C" int
+foo(int * A, int n) {
+  int k = n % 7 + 1;
+  for (int i = 0; i < n; i += k) {
+    A[i] = A[i] * 2;
+  }
+  return 0;
+}
+"""
+
+def checkLoopRejected(name, source):
+  srcFile = "build/check_{}.cpp".format(name)
+  scalarLL = "build/check_{}.ll".format(name)
+  vectorLL = "build/check_{}.loopvec.ll".format(name)
+  with open(srcFile, "w") as f:
+    f.write(source)
+  if compileToIR(srcFile, scalarLL) != 0:
+    return False
+  return runOuterLoopVec(scalarLL, vectorLL, "foo", "0", "logs/check_{}".format(name), "remainder") != 0
+
+# the early exit condition loads all lanes of an iteration: a strlen-like search in a buffer of unknown size could
+# fault past the exiting lane, rvTool has to refuse the loop
+unboundedSearchSource = """
+extern "C" int
+foo(int * A, int n) {
+  int i;
+  for (i = 0; i < n; ++i) {
+    if (A[i] == 0) break;
+  }
+  return i;
+}
+"""
+
+# lowering remarks of rvTool -pass-remarks-output (YAML, one document per remark)
+def checkRemarks(name, kernel, expected):
+  scalarLL = "build/check_{}.ll".format(name)
+  vectorLL = "build/check_{}.wfv.ll".format(name)
+  remarksYAML = "build/check_{}.yaml".format(name)
+  with open(scalarLL, "w") as f:
+    f.write(kernel)
+  if runWFV(scalarLL, vectorLL, "foo", "T_TrT", "logs/check_{}".format(name), remarksFile=remarksYAML) != 0:
+    return False
+  for pattern in expected:
+    if countMatches(remarksYAML, pattern) == 0:
+      print("(missing {}) ".format(pattern), end="")
+      return False
+  return True
+
+# remarks of a function compiled with -g carry the source location of the lowered instruction
+remarkLocSource = """float
+foo(float * A, int i) {
+  float x = 1.0f;
+  x += A[i * 3];
+  return x;
+}
+"""
+
+def checkRemarkLocation(name, source, locText, kindText):
+  srcFile = "build/check_{}.c".format(name)
+  scalarLL = "build/check_{}.ll".format(name)
+  vectorLL = "build/check_{}.wfv.ll".format(name)
+  remarksYAML = "build/check_{}.yaml".format(name)
+  with open(srcFile, "w") as f:
+    f.write(source)
+  if compileToIR(srcFile, scalarLL, "-g -gcolumn-info") != 0:
+    return False
+  if runWFV(scalarLL, vectorLL, "foo", "U_TrT", "logs/check_{}".format(name), remarksFile=remarksYAML) != 0:
+    return False
+  # the gather is the load of A[i * 3], clang locates it at its base A
+  lines = source.splitlines()
+  line = next(idx for idx, text in enumerate(lines, 1) if locText in text)
+  column = lines[line - 1].index(locText) + 1
+  pattern = r"DebugLoc:\s+\{{ File: '{}', Line: {}, Column: {} \}}\nFunction:\s+'foo'\nArgs:\n\s+- String:\s+'lowered as [^']*{}".format(
+            re.escape(srcFile), line, column, kindText)
+  if countMatches(remarksYAML, pattern) == 0:
+    print("(missing remark at {}:{}:{}) ".format(srcFile, line, column), end="")
+    return False
+  return True
+
+checks = {
+  "alias_unknown_range": lambda: checkAliasFallback("alias_unknown_range", indirectStoreSource),
+  "auto_width": checkAutoWidthTarget,
+  "auto_width_fallback": checkAutoWidthFallback,
+  "avx512_sleef_sp": lambda: checkPatterns("avx512_sleef_sp", avx512SleefSPKernel, 16,
+                                           [r"call <16 x float> @xatanf_avx512"], []),
+  "avx512_sleef_dp": lambda: checkPatterns("avx512_sleef_dp", avx512SleefDPKernel, 8,
+                                           [r"call <8 x double> @xatan_avx512"], []),
+  "avx512_masks": lambda: checkPatterns("avx512_masks", avx512MaskKernel, 16,
+                                        [r"bitcast <16 x i1> .* to i16"], [r"zext <16 x i1>"]),
+  "red_tree_w8": lambda: checkLoopPatterns("red_tree_w8", "test_067_redtreew8-loop.cpp", "", 8,
+                                          [r"%red_shuf\d* = shufflevector <8 x i32>"], []),
+  "red_tree_w16": lambda: checkLoopPatterns("red_tree_w16", "test_068_redtreew16-loop.cpp", "", 16,
+                                           [r"%red_shuf\d* = shufflevector <16 x i32>"], []),
+  "red_ftree_w8": lambda: checkLoopPatterns("red_ftree_w8", "test_069_redftreew8-loop.cpp", "-ffast-math", 8,
+                                           [r"%red_shuf\d* = shufflevector <8 x float>"], []),
+  "red_ftree_w16": lambda: checkLoopPatterns("red_ftree_w16", "test_070_redftreew16-loop.cpp", "-ffast-math", 16,
+                                            [r"%red_shuf\d* = shufflevector <16 x float>"], []),
+  "iv_runtime_start": lambda: checkLoopPatterns("iv_runtime_start", "test_072_runtimestart-loop.cpp", "", 8,
+                                               [r"<8 x i32>"], [r"<8 x i32>\*? .*align 32"]),
+  "iv_runtime_step_exit": lambda: checkLoopRejected("iv_runtime_step_exit", runtimeStepExitSource),
+  "select_meta": lambda: checkLoopSelection("select_meta", "test_073_selectmeta-loop.cpp", "meta", "", 1,
+                                          [r"store <\d+ x i32>"]),
+  "select_line": lambda: checkLoopSelection("select_line", "test_074_selectline-loop.cpp", "line:12", "-g", 1,
+                                          [r"store <\d+ x i32>"]),
+  "select_all": lambda: checkLoopSelection("select_all", "test_075_selectall-loop.cpp", "all", "", 2,
+                                         [r"store <\d+ x i32>"]),
+  "early_exit_lane": lambda: checkLoopPatterns("early_exit_lane", "test_076_earlyexitsearch-loop.cpp", "", 8,
+                                              [r"call i32 @llvm\.cttz\.i32"], [], loopDesc="1"),
+  "early_exit_unbounded": lambda: checkLoopRejected("early_exit_unbounded", unboundedSearchSource),
+  "red_index_payload": lambda: checkLoopRejected("red_index_payload", argminPayloadSource),
+  "remarks": lambda: checkRemarks("remarks", maskJoinKernel,
+                                  [r"--- !Analysis", r"Pass:\s+rv", r"Name:\s+Lowering",
+                                   r"String:\s+'vector code of \w+: "]),
+  "remarks_debugloc": lambda: checkRemarkLocation("remarks_debugloc", remarkLocSource, "A[i * 3]", "gather: 1"),
+  "masked_memory": lambda: checkPatterns("masked_memory", maskedMemoryKernel, 8,
+                                         [r"call <8 x float> @llvm\.masked\.load", r"call void @llvm\.masked\.store"],
+                                         [r"@nativeCascadeLoadFn", r"@nativeCascadeStoreFn"], shapes="U_C_TrT"),
+  "cascade_fallback": lambda: checkPatterns("cascade_fallback", cascadeFallbackKernel, 8,
+                                            [r"call <8 x float> @nativeCascadeLoadFn", r"call void @nativeCascadeStoreFn"],
+                                            [r"@llvm\.masked\.load", r"@llvm\.masked\.store"], shapes="U_C_TrT"),
+  "masks_neg": lambda: checkMasks("masks_neg", maskNegKernel, 0, 0),
+  "masks_join": lambda: checkMasks("masks_join", maskJoinKernel, 2, 0),
+  "masks_reuse": lambda: checkMasks("masks_reuse", maskReuseKernel, 2, 0),
+}
+
+selected = sys.argv[1:] if len(sys.argv) > 1 else sorted(checks.keys())
+
+print("-- RV IR checks --")
+allPassed = True
+for name in selected:
+  print("{:60}".format("- {}".format(name)), end="")
+  success = checks[name]()
+  allPassed = allPassed and success
+  print("passed!" if success else "failed!")
+
+sys.exit(0 if allPassed else 1)
@@ -0,0 +1,26 @@
+#include <stdio.h>
+#include <iostream>
+
+#include <cassert>
+
+#include "launcherTools.h"
+
+extern "C" int foo(int * A, int n);
+
+int main(int argc, char ** argv) {
+  srand(42);
+
+  // not a multiple of the vector width
+  const uint n = 8 * 100 + 5;
+
+  int * A = allocateRandArray<int>(n);
+
+  int res = foo(A, n);
+
+  size_t hash = hashArray(A, n, 0);
+  delete A;
+
+  std::cerr << hash << " " << res << "\n";
+
+  return 0;
+}
@@ -0,0 +1,11 @@
+// LoopHint: 0, LaunchCode: fooAnt, Tail: remainder
+
+extern "C" int
+foo(int * A, int n) {
+  int a = 0;
+  for (int i = 0; i < n; ++i) {
+    A[i] = 3 * A[i];
+    a += A[i];
+  }
+  return a;
+}
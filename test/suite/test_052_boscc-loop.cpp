@@ -0,0 +1,16 @@
+// LoopHint: 0, LaunchCode: fooAnt, Tail: remainder, BOSCC: 4
+
+extern "C" int
+foo(int * A, int n) {
+  int a = 0;
+  for (int i = 0; i < n; ++i) {
+    int v = A[i];
+    if (v > 5) {
+      v = v * v + 3;
+      v = v ^ (v >> 3);
+      A[i] = v;
+    }
+    a += v;
+  }
+  return a;
+}
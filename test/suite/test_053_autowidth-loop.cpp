@@ -0,0 +1,12 @@
+// LoopHint: 0, LaunchCode: fooAnt, Tail: remainder, Width: auto
+
+extern "C" int
+foo(int * A, int n) {
+  double s = 0.0;
+  for (int i = 0; i < n; ++i) {
+    double x = A[i] * 0.5;
+    s += x;
+    A[i] = (int) x + (i & 3);
+  }
+  return (int) s;
+}
@@ -0,0 +1,23 @@
+// LoopHint: 0, LaunchCode: fooAnt, Tail: remainder, Width: 4
+
+typedef int int4 __attribute__((vector_size(16)));
+
+extern "C" __attribute__((noinline)) int
+scale(int a, int b, int i) {
+  return a * b + i;
+}
+
+// vector function ABI variant of scale (varying a, uniform b, linear i)
+extern "C" __attribute__((noinline)) int4
+_ZGVbN4vul_scale(int4 a, int b, int i) {
+  int4 idx = {i, i + 1, i + 2, i + 3};
+  return a * b + idx;
+}
+
+extern "C" int
+foo(int * A, int n) {
+  for (int i = 0; i < n; ++i) {
+    A[i] = scale(A[i], n, i);
+  }
+  return 0;
+}
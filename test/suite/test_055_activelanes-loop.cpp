@@ -0,0 +1,21 @@
+// LoopHint: 0, LaunchCode: fooAnt, Tail: remainder, Lanes: loop
+
+static int hits = 0;
+
+// side effects: must only run for the active lanes
+extern "C" __attribute__((noinline)) int
+record(int v) {
+  ++hits;
+  return v * 3 + hits;
+}
+
+extern "C" int
+foo(int * A, int n) {
+  for (int i = 0; i < n; ++i) {
+    int v = A[i];
+    if ((v & 15) == 3) {
+      A[i] = record(v);
+    }
+  }
+  return hits;
+}
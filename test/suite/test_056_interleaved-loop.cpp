@@ -0,0 +1,19 @@
+// LoopHint: 0, LaunchCode: fooAnt, Tail: remainder
+
+struct Point {
+  int x, y, z;
+};
+
+extern "C" int
+foo(int * A, int n) {
+  Point * P = reinterpret_cast<Point*>(A);
+  int m = n / 3;
+  for (int i = 0; i < m; ++i) {
+    // stride-3 AoS reads (interleaved group of factor 3)
+    int s = P[i].x + 2 * P[i].y - P[i].z;
+    // stores to two of three fields (group with a gap)
+    P[i].y = s;
+    P[i].z = s ^ i;
+  }
+  return m;
+}
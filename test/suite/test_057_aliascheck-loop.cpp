@@ -0,0 +1,18 @@
+// LoopHint: 0, LaunchCode: fooAnt, Tail: remainder
+
+// opaque to scalar evolution: B is a pointer base of its own
+__attribute__((noinline)) static int *
+Offset(int * A, int k) {
+  return A + k;
+}
+
+extern "C" int
+foo(int * A, int n) {
+  int * B = Offset(A, 3);
+  int m = n - 3;
+  // B[i] = A[i + 3]: iteration i reads the value stored three iterations earlier
+  for (int i = 0; i < m; ++i) {
+    B[i] = A[i] + 2 * B[i];
+  }
+  return m;
+}
@@ -0,0 +1,10 @@
+// LoopHint: 0, LaunchCode: fooAnt, Tail: remainder, Align: peel
+
+extern "C" int
+foo(int * A, int n) {
+  // the store stream starts at A + 1: a misaligned A has to be aligned by peeling
+  for (int i = 0; i < n - 1; ++i) {
+    A[i + 1] = A[i + 1] * 3 + i;
+  }
+  return n;
+}
@@ -0,0 +1,12 @@
+// LoopHint: 0, LaunchCode: fooAnt, Tail: remainder
+
+extern "C" int
+foo(int * A, int n) {
+  int k = n % 7 + 2; // step only known at runtime
+  int t = 0;
+  for (int i = n - 1; i >= 0; i -= 2) {
+    A[i] = A[i] * 2 + t;
+    t += k;
+  }
+  return t;
+}
@@ -0,0 +1,14 @@
+// LoopHint: 1, LaunchCode: fooAnt, Tail: remainder
+
+extern "C" int
+foo(int * A, int n) {
+  // stays scalar: carried dependence
+  for (int i = 1; i < n; ++i) {
+    A[i] = A[i] + A[i - 1] % 7;
+  }
+
+  for (int i = 0; i < n; ++i) {
+    A[i] = A[i] * 3 + i;
+  }
+  return n;
+}
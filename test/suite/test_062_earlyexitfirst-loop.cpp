@@ -0,0 +1,15 @@
+// LoopHint: 0, LaunchCode: fooAnt, Tail: remainder
+
+extern "C" int
+foo(int * A, int n) {
+  // the search ends in the first lane of a vector iteration (i % 16 == 0)
+  int stop = (n / 2) & ~15;
+  int sum = 0;
+  int i;
+  for (i = 0; i < n; ++i) {
+    if (i == stop) break;
+    sum += A[i] & 0xFF;
+    A[i] = A[i] * 3 + 1;
+  }
+  return (i << 16) ^ sum;
+}
@@ -0,0 +1,13 @@
+// LoopHint: 0, LaunchCode: fooAnt, Tail: remainder
+
+extern "C" int
+foo(int * A, int n) {
+  int lo = 1 << 30;
+  int hi = -(1 << 30);
+  for (int i = 0; i < n; ++i) {
+    int a = A[i] % 100003 - 50000; // signed values
+    lo = a < lo ? a : lo;
+    hi = a > hi ? a : hi;
+  }
+  return hi - lo;
+}
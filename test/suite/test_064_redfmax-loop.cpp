@@ -0,0 +1,11 @@
+// LoopHint: 0, LaunchCode: fooAnt, Tail: remainder, FastMath: 1
+
+extern "C" int
+foo(int * A, int n) {
+  float m = -1.0f;
+  for (int i = 0; i < n; ++i) {
+    float a = (A[i] % 10007) * 0.25f;
+    m = a > m ? a : m; // fmaxnum (no NaNs under fast-math)
+  }
+  return (int) (m * 4.0f);
+}
@@ -0,0 +1,14 @@
+// LoopHint: 0, LaunchCode: fooAnt, Tail: remainder
+
+extern "C" int
+foo(int * A, int n) {
+  int all = -1;
+  int any = 0;
+  int parity = 0;
+  for (int i = 0; i < n; ++i) {
+    all &= A[i] | 0x5555;
+    any |= A[i] & 0xF0F0;
+    parity ^= A[i];
+  }
+  return all ^ any ^ parity;
+}
@@ -0,0 +1,15 @@
+// LoopHint: 0, LaunchCode: fooAnt, Tail: remainder
+
+extern "C" int
+foo(int * A, int n) {
+  int m = A[0];
+  int idx = 0;
+  for (int i = 0; i < n; ++i) {
+    // index of the first minimum
+    if (A[i] < m) {
+      m = A[i];
+      idx = i;
+    }
+  }
+  return idx;
+}
@@ -0,0 +1,12 @@
+// LoopHint: 0, LaunchCode: fooAnt, Tail: remainder, Width: 8
+
+extern "C" int
+foo(int * A, int n) {
+  int sum = 0;
+  int prod = 1;
+  for (int i = 0; i < n; ++i) {
+    sum += A[i];
+    prod *= A[i] | 1; // wraps around, still associative
+  }
+  return sum ^ prod;
+}
@@ -0,0 +1,13 @@
+// LoopHint: 0, LaunchCode: fooAnt, Tail: remainder, Width: 16, FastMath: 1
+
+extern "C" int
+foo(int * A, int n) {
+  float sum = 0.0f;
+  float m = -1.0f;
+  for (int i = 0; i < n; ++i) {
+    float a = (A[i] % 64) * 0.5f; // partial sums stay exact in any order
+    sum += a;
+    m = a > m ? a : m;
+  }
+  return (int) (sum * 2.0f) + (int) m;
+}
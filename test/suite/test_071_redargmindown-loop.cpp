@@ -0,0 +1,16 @@
+// LoopHint: 0, LaunchCode: fooAnt, Tail: remainder
+
+extern "C" int
+foo(int * A, int n) {
+  int m = A[0];
+  int idx = n;
+  for (int i = 0; i < n; ++i) {
+    // position from the end of the first minimum (decreasing index)
+    int v = A[i] % 1009;
+    if (v < m) {
+      m = v;
+      idx = n - 1 - i;
+    }
+  }
+  return idx;
+}
@@ -0,0 +1,12 @@
+// LoopHint: 0, LaunchCode: fooAnt, Tail: remainder
+
+extern "C" int
+foo(int * A, int n) {
+  int t = 0;
+  // the induction starts at a runtime offset (no vector alignment)
+  for (int i = n % 5 + 1; i < n; ++i) {
+    A[i] = A[i] + i;
+    t += A[i];
+  }
+  return t;
+}
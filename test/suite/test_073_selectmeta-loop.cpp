@@ -0,0 +1,15 @@
+// LoopHint: meta, LaunchCode: fooAnt, Tail: remainder
+
+extern "C" int
+foo(int * A, int n) {
+  int t = 0;
+  for (int i = 0; i < n; ++i) {
+    t += A[i] & 0xFF;
+  }
+  // only this loop carries llvm.loop.vectorize.enable
+#pragma clang loop vectorize(enable)
+  for (int i = 0; i < n; ++i) {
+    A[i] = A[i] * 3 + t;
+  }
+  return t;
+}
@@ -0,0 +1,15 @@
+// LoopHint: line:12, LaunchCode: fooAnt, Tail: remainder
+
+extern "C" int
+foo(int * A, int n) {
+  int t = 0;
+  for (int i = 0; i < n; ++i) {
+    t += A[i] & 0xFF;
+  }
+  // the second loop is selected by the line of its body
+  for (int i = 0; i < n; ++i) {
+    int a = A[i];
+    A[i] = a * 3 + t;
+  }
+  return t;
+}
@@ -0,0 +1,13 @@
+// LoopHint: all, LaunchCode: fooAnt, Tail: remainder
+
+extern "C" int
+foo(int * A, int n) {
+  int t = 0;
+  for (int i = 0; i < n; ++i) {
+    t += A[i] & 0xFF;
+  }
+  for (int i = 0; i < n; ++i) {
+    A[i] = A[i] * 3 + t;
+  }
+  return t;
+}
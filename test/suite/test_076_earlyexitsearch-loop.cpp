@@ -0,0 +1,21 @@
+// LoopHint: 1, LaunchCode: fooAnt, Tail: remainder
+
+static int Keys[1024];
+
+extern "C" int
+foo(int * A, int n) {
+  for (int i = 0; i < n; ++i) {
+    Keys[i] = (A[i] & 0xFF) * 2 + 1;
+  }
+
+  // the first zero key is not in lane 0 of a vector iteration ((n / 2) | 5)
+  int stop = (n / 2) | 5;
+  Keys[stop] = 0;
+
+  // the exit condition loads stay within Keys for all lanes, the remainder loop starts at the exiting lane
+  int i;
+  for (i = 0; i < 1024; ++i) {
+    if (Keys[i] == 0) break;
+  }
+  return i;
+}
@@ -21,47 +21,65 @@ if len(sys.argv) > 1:
 else:
   patterns = ["suite/*.c*"]
 
-def wholeFunctionVectorize(srcFile, argMappings):
+def wholeFunctionVectorize(srcFile, argMappings, bosccThreshold):
   baseName = path.basename(srcFile)
   destFile = "build/" + baseName + ".wfv.ll"
   logPrefix =  "logs/"  + baseName + ".wfv"
   scalarName = "foo"
-  ret = runWFV(srcFile, destFile, scalarName, argMappings, logPrefix)
+  ret = runWFV(srcFile, destFile, scalarName, argMappings, logPrefix, bosccThreshold)
   return destFile if ret == 0 else None
 
-def outerLoopVectorize(srcFile, loopDesc):
+def outerLoopVectorize(srcFile, loopDesc, tailStrategy, bosccThreshold, vectorWidth, laneIteration, alignStrategy):
   baseName = path.basename(srcFile)
   destFile = "build/" + baseName + ".loopvec.ll"
   logPrefix =  "logs/"  + baseName + ".loopvec"
   scalarName = "foo"
-  ret = runOuterLoopVec(srcFile, destFile, scalarName, loopDesc, logPrefix)
+  ret = runOuterLoopVec(srcFile, destFile, scalarName, loopDesc, logPrefix, tailStrategy, bosccThreshold, vectorWidth, laneIteration, alignStrategy)
   return destFile if ret == 0 else None
 
 def executeWFVTest(scalarLL, options):
   sigInfo = options.split(",")
+  bosccThreshold = None
 
   for option in sigInfo:
-    opSplit = option.split(":")
+    opSplit = option.split(":", 1)
     if opSplit[0].strip() == "LaunchCode":
       launchCode = opSplit[1].strip()
     elif opSplit[0].strip() == "Shapes":
       shapes = opSplit[1].strip()
+    elif opSplit[0].strip() == "BOSCC":
+      bosccThreshold = opSplit[1].strip()
 
-  testBC = wholeFunctionVectorize(scalarLL, shapes)
+  testBC = wholeFunctionVectorize(scalarLL, shapes, bosccThreshold)
   return runWFVTest(testBC, launchCode) if testBC else False
 
 def executeOuterLoopTest(scalarLL, options):
   sigInfo = options.split(",")
   # launchCode = options.split("-k")[1].split("-")[0].strip()
+  tailStrategy = None
+  bosccThreshold = None
+  vectorWidth = None
+  laneIteration = None
+  alignStrategy = None
 
   for option in sigInfo:
-    opSplit = option.split(":")
+    opSplit = option.split(":", 1)
     if opSplit[0].strip() == "LaunchCode":
       launchCode = opSplit[1].strip()
     elif opSplit[0].strip() == "LoopHint":
       loopHint = opSplit[1].strip()
-
-  vectorIR = outerLoopVectorize(scalarLL, loopHint)
+    elif opSplit[0].strip() == "Tail":
+      tailStrategy = opSplit[1].strip()
+    elif opSplit[0].strip() == "BOSCC":
+      bosccThreshold = opSplit[1].strip()
+    elif opSplit[0].strip() == "Width":
+      vectorWidth = opSplit[1].strip()
+    elif opSplit[0].strip() == "Lanes":
+      laneIteration = opSplit[1].strip()
+    elif opSplit[0].strip() == "Align":
+      alignStrategy = opSplit[1].strip()
+
+  vectorIR = outerLoopVectorize(scalarLL, loopHint, tailStrategy, bosccThreshold, vectorWidth, laneIteration, alignStrategy)
   if vectorIR is None:
     return False
 
@@ -89,7 +107,12 @@ for pattern in patterns:
     mode = parts[-1]
     rest = "-".join(parts[0:-1])
 
-    scalarLL = buildScalarIR(testCase)
+    # "FastMath: 1" compiles the scalar function with -ffast-math (reassociable FP reductions)
+    clangArgs = "-ffast-math" if "FastMath: 1" in options else ""
+    # loops selected by source line ("LoopHint: line:N") are found through the debug locations
+    if "LoopHint: line:" in options:
+      clangArgs = clangArgs + " -g"
+    scalarLL = buildScalarIR(testCase, clangArgs)
 
     if mode == "wfv":
       success = executeWFVTest(scalarLL, options)
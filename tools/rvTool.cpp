@@ -10,11 +10,16 @@
 #include <iostream>
 #include <cassert>
 #include <sstream>
+#include <memory>
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
 
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/Constants.h"
+#include "llvm/IR/Intrinsics.h"
 
 #include <llvm/IR/Module.h>
 #include <llvm/Bitcode/ReaderWriter.h>
@@ -25,11 +30,27 @@
 #include <llvm/Analysis/TargetLibraryInfo.h>
 
 #include "llvm/Transforms/Utils/Cloning.h"
+#include "llvm/Transforms/Utils/Local.h"
 #include "llvm/Transforms/Scalar.h"
 #include "llvm/IR/LegacyPassManager.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/CFG.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/AssumptionCache.h"
+#include "llvm/Analysis/ScalarEvolution.h"
+#include "llvm/Analysis/ScalarEvolutionExpander.h"
+#include "llvm/Analysis/ScalarEvolutionExpressions.h"
 
 #include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/IR/DiagnosticInfo.h"
+#include "llvm/IR/DiagnosticPrinter.h"
+#include "llvm/Support/TargetRegistry.h"
+#include "llvm/Support/TargetSelect.h"
+#include "llvm/Target/TargetMachine.h"
+#include "llvm/Target/TargetOptions.h"
 
 #include "ArgumentReader.h"
 
@@ -42,11 +63,15 @@
 #include "rv/region/Region.h"
 
 #include "rv/vectorizationInfo.h"
+#include "rv/timeReport.h"
 
 static const char LISTSEPERATOR = '_';
 static const char SHAPESEPERATOR = '.';
 static const char RETURNSHAPESEPERATOR = 'r';
 
+// vector width if neither -w nor the loop metadata specify one (and the fallback of -w auto)
+static const uint DefaultVectorWidth = 8;
+
 static const char BOTCHAR = 'B';
 static const char UNICHAR = 'U';
 static const char CONTCHAR = 'C';
@@ -63,85 +88,1405 @@ fail(const char * errMsg) {
   exit(-1);
 }
 
-using namespace llvm;
+using namespace llvm;
+
+Module*
+createModuleFromFile(const std::string& fileName, LLVMContext & context)
+{
+    SMDiagnostic diag;
+    auto modPtr = llvm::parseIRFile(fileName, diag, context);
+    return modPtr.release();
+}
+
+void
+writeModuleToFile(Module* mod, const std::string& fileName)
+{
+    assert (mod);
+    std::error_code EC;
+    raw_fd_ostream file(fileName, EC, sys::fs::OpenFlags::F_RW);
+    mod->print(file, nullptr);
+    if (EC)
+    {
+        errs() << "ERROR: printing module to file failed: " << EC.message() << "\n";
+        fail();
+    }
+    file.close();
+}
+
+// YAML scalar in single quotes
+static void
+printYAMLString(raw_ostream& out, StringRef text)
+{
+    out << '\'';
+    for (char c : text)
+    {
+        if (c == '\'') out << "''";
+        else out << c;
+    }
+    out << '\'';
+}
+
+// collects the optimization remarks of RV (pass "rv") as YAML documents
+// in the format of opt -pass-remarks-output. other diagnostics are printed as usual.
+static void
+handleDiagnostic(const DiagnosticInfo& DI, void* context)
+{
+    auto& remarkStream = *static_cast<raw_ostream*>(context);
+
+    const char* remarkKind = nullptr;
+    switch (DI.getKind())
+    {
+        case DK_OptimizationRemark: remarkKind = "Passed"; break;
+        case DK_OptimizationRemarkMissed: remarkKind = "Missed"; break;
+        case DK_OptimizationRemarkAnalysis: remarkKind = "Analysis"; break;
+        default: break;
+    }
+
+    if (!remarkKind)
+    {
+        DiagnosticPrinterRawOStream printer(errs());
+        DI.print(printer);
+        errs() << "\n";
+        if (DI.getSeverity() == DS_Error) fail("compilation error.");
+        return;
+    }
+
+    auto& remark = static_cast<const DiagnosticInfoOptimizationBase&>(DI);
+    if (StringRef(remark.getPassName()) != "rv") return;
+
+    remarkStream << "--- !" << remarkKind << "\n";
+    remarkStream << "Pass:            rv\n";
+    remarkStream << "Name:            Lowering\n";
+    if (remark.isLocationAvailable())
+    {
+        StringRef file;
+        unsigned line = 0, column = 0;
+        remark.getLocation(&file, &line, &column);
+        remarkStream << "DebugLoc:        { File: ";
+        printYAMLString(remarkStream, file);
+        remarkStream << ", Line: " << line << ", Column: " << column << " }\n";
+    }
+    remarkStream << "Function:        ";
+    printYAMLString(remarkStream, remark.getFunction().getName());
+    remarkStream << "\nArgs:\n  - String:          ";
+    printYAMLString(remarkStream, remark.getMsg().str());
+    remarkStream << "\n...\n";
+}
+
+void
+normalizeFunction(Function& F)
+{
+    legacy::FunctionPassManager FPM(F.getParent());
+    FPM.add(createLoopSimplifyPass());
+    FPM.add(createLCSSAPass());
+    FPM.run(F);
+}
+
+// how iterations beyond the last multiple of the vector width are executed
+enum class TailStrategy
+{
+    None,      // trip count is assumed to be a multiple of the vector width
+    Remainder, // scalar remainder loop after the vector loop
+    Fold       // masked vector loop with ceil(n/W) iterations
+};
+
+// which loops of a function are vectorized (rvTool -l)
+enum class LoopSelectionKind
+{
+    Index,    // loops by index in the order of their headers ("0", "0,2")
+    Metadata, // loops with llvm.loop.vectorize.enable, llvm.loop.vectorize.width or rv.vectorize.width ("meta")
+    Line,     // innermost loops that span a source line ("line:17")
+    All       // all outermost loops ("all")
+};
+
+struct LoopSelection
+{
+    LoopSelectionKind kind;
+    std::vector<uint> values; // indices or source lines
+};
+
+static Value*
+GetInitValue(Loop& loop, PHINode& phi)
+{
+    for (uint i = 0; i < phi.getNumIncomingValues(); ++i)
+    {
+        if (!loop.contains(phi.getIncomingBlock(i)))
+        {
+            return phi.getIncomingValue(i);
+        }
+    }
+    return nullptr;
+}
+
+static Value*
+GetLoopValue(Loop& loop, PHINode& phi)
+{
+    for (uint i = 0; i < phi.getNumIncomingValues(); ++i)
+    {
+        if (loop.contains(phi.getIncomingBlock(i)))
+        {
+            return phi.getIncomingValue(i);
+        }
+    }
+    return nullptr;
+}
+
+// expand the trip count of @loop in its preheader (in the type of the induction variable @ivPhi)
+static Value*
+ExpandTripCount(Function& parentFn, Loop& loop, PHINode& ivPhi, DominatorTree& domTree, LoopInfo& loopInfo)
+{
+    TargetLibraryAnalysis libAnalysis;
+    TargetLibraryInfo tli = libAnalysis.run(*parentFn.getParent());
+    AssumptionCache assumptionCache(parentFn);
+    ScalarEvolution SE(parentFn, tli, assumptionCache, domTree, loopInfo);
+
+    // early exits may leave before, the latch exit bounds the iterations of the vector loop
+    auto* latch = loop.getLoopLatch();
+    auto* backedgeTakenCount = latch ? SE.getExitCount(&loop, latch) : SE.getBackedgeTakenCount(&loop);
+    if (isa<SCEVCouldNotCompute>(backedgeTakenCount)) fail("could not compute the trip count of the loop.");
+
+    auto* ivTy = ivPhi.getType();
+    auto* tripCount = SE.getAddExpr(SE.getTruncateOrZeroExtend(backedgeTakenCount, ivTy),
+                                    SE.getConstant(ivTy, 1));
+
+    SCEVExpander expander(SE, parentFn.getParent()->getDataLayout(), "tail");
+    return expander.expandCodeFor(tripCount, ivTy, loop.getLoopPreheader()->getTerminator());
+}
+
+// affine induction {init,+,step} of a loop
+struct Induction
+{
+    PHINode* phi;
+    Instruction* increment; // phi + step, the loop carried value of phi
+    int64_t step;           // constant step per iteration (in bytes for pointer inductions)
+};
+
+// Returns the instruction that adds a loop invariant step to @phi (add, sub or single index gep of @phi)
+// @stepPos receives the operand index of the step
+static Instruction*
+GetIncrement(Loop& loop, PHINode& phi, uint& stepPos)
+{
+    auto* increment = dyn_cast<Instruction>(GetLoopValue(loop, phi));
+    if (!increment) return nullptr;
+
+    switch (increment->getOpcode())
+    {
+        case Instruction::Add:
+            if (increment->getOperand(0) != &phi && increment->getOperand(1) != &phi) return nullptr;
+            stepPos = increment->getOperand(0) == &phi ? 1 : 0;
+            break;
+        case Instruction::Sub:
+            if (increment->getOperand(0) != &phi) return nullptr;
+            stepPos = 1;
+            break;
+        case Instruction::GetElementPtr:
+            if (increment->getOperand(0) != &phi || cast<GetElementPtrInst>(increment)->getNumIndices() != 1) return nullptr;
+            stepPos = 1;
+            break;
+        default:
+            return nullptr;
+    }
+
+    return loop.isLoopInvariant(increment->getOperand(stepPos)) ? increment : nullptr;
+}
+
+// Rewrites inductions with a loop invariant runtime step k as init + k * count,
+// where count is a new induction {0,+,1}. The vectorizer only seeds inductions with a constant step.
+static void
+CanonicalizeInductions(Function& parentFn, Loop& loop, DominatorTree& domTree, LoopInfo& loopInfo)
+{
+    auto* preheader = loop.getLoopPreheader();
+    auto* header = loop.getHeader();
+    auto* latch = loop.getLoopLatch();
+    if (!preheader || !latch) fail("loop is not in simplified form!");
+
+    TargetLibraryAnalysis libAnalysis;
+    TargetLibraryInfo tli = libAnalysis.run(*parentFn.getParent());
+    AssumptionCache assumptionCache(parentFn);
+    ScalarEvolution SE(parentFn, tli, assumptionCache, domTree, loopInfo);
+
+    // query all inductions before the loop is modified
+    std::vector<std::pair<PHINode*, const SCEV*>> runtimeSteps;
+    for (auto& inst : *header)
+    {
+        auto* phi = dyn_cast<PHINode>(&inst);
+        if (!phi) break;
+
+        auto* addRec = dyn_cast<SCEVAddRecExpr>(SE.getSCEV(phi));
+        if (!addRec || addRec->getLoop() != &loop || !addRec->isAffine()) continue;
+        auto* step = addRec->getStepRecurrence(SE);
+        if (isa<SCEVConstant>(step)) continue;
+
+        if (!phi->getType()->isIntegerTy()) fail("pointer induction with a runtime step currently unsupported!");
+        runtimeSteps.push_back(std::make_pair(phi, step));
+    }
+    if (runtimeSteps.empty()) return;
+
+    auto* latchBranch = dyn_cast<BranchInst>(latch->getTerminator());
+    CmpInst* exitCond = nullptr;
+    if (latchBranch && latchBranch->isConditional()) exitCond = dyn_cast<CmpInst>(latchBranch->getCondition());
+
+    SCEVExpander expander(SE, parentFn.getParent()->getDataLayout(), "iv");
+    for (auto& it : runtimeSteps)
+    {
+        auto* phi = it.first;
+        auto* stepVal = expander.expandCodeFor(it.second, phi->getType(), preheader->getTerminator());
+        auto* init = GetInitValue(loop, *phi);
+
+        uint stepPos;
+        auto* increment = GetIncrement(loop, *phi, stepPos);
+        if (!increment) fail("could not identify the increment of an induction variable.");
+
+        // per lane values of the exit condition can not be recovered from the count
+        if (exitCond && (exitCond->getOperand(0) == phi || exitCond->getOperand(1) == phi ||
+                         exitCond->getOperand(0) == increment || exitCond->getOperand(1) == increment))
+        {
+            fail("loop exit controlled by an induction with a runtime step currently unsupported!");
+        }
+
+        auto* ivTy = phi->getType();
+        auto* count = PHINode::Create(ivTy, 2, phi->getName() + ".count", header->getFirstNonPHI());
+        auto* countNext = BinaryOperator::CreateAdd(count, ConstantInt::get(ivTy, 1), count->getName() + ".next",
+                                                    latch->getTerminator());
+        count->addIncoming(ConstantInt::getNullValue(ivTy), preheader);
+        count->addIncoming(countNext, latch);
+
+        IRBuilder<> builder(header->getFirstNonPHI());
+        auto* value = builder.CreateAdd(init, builder.CreateMul(stepVal, count), phi->getName() + ".val");
+        auto* nextValue = builder.CreateAdd(value, stepVal, phi->getName() + ".val.next");
+
+        increment->replaceAllUsesWith(nextValue);
+        phi->replaceAllUsesWith(value);
+        increment->eraseFromParent();
+        phi->eraseFromParent();
+
+        // live outs are recomputed from the count after the loop (only the count is known outside of the vector loop)
+        SmallPtrSet<PHINode*, 2> exitPhis;
+        for (auto* liveOut : {value, nextValue})
+        {
+            for (auto* user : liveOut->users())
+            {
+                auto* userPhi = dyn_cast<PHINode>(user);
+                if (userPhi && !loop.contains(userPhi->getParent())) exitPhis.insert(userPhi);
+            }
+        }
+        for (auto* exitPhi : exitPhis)
+        {
+            auto* exitCount = PHINode::Create(ivTy, exitPhi->getNumIncomingValues(), count->getName() + ".lcssa", exitPhi);
+            for (uint i = 0; i < exitPhi->getNumIncomingValues(); ++i)
+            {
+                auto* inVal = exitPhi->getIncomingValue(i);
+                if (inVal != value && inVal != nextValue) fail("unsupported live out of an induction with a runtime step.");
+                exitCount->addIncoming(inVal == value ? (Value*) count : countNext, exitPhi->getIncomingBlock(i));
+            }
+
+            IRBuilder<> exitBuilder(&*exitPhi->getParent()->getFirstInsertionPt());
+            auto* exitValue = exitBuilder.CreateAdd(init, exitBuilder.CreateMul(stepVal, exitCount),
+                                                    exitPhi->getName() + ".val");
+            exitPhi->replaceAllUsesWith(exitValue);
+            exitPhi->eraseFromParent();
+        }
+    }
+
+    errs() << "Rewrote " << runtimeSteps.size() << " induction(s) with a runtime step\n";
+}
+
+// affine inductions of @loop in header order (steps must be constant, see CanonicalizeInductions)
+static std::vector<Induction>
+CollectInductions(Function& parentFn, Loop& loop, DominatorTree& domTree, LoopInfo& loopInfo)
+{
+    TargetLibraryAnalysis libAnalysis;
+    TargetLibraryInfo tli = libAnalysis.run(*parentFn.getParent());
+    AssumptionCache assumptionCache(parentFn);
+    ScalarEvolution SE(parentFn, tli, assumptionCache, domTree, loopInfo);
+
+    std::vector<Induction> inductions;
+    for (auto& inst : *loop.getHeader())
+    {
+        auto* phi = dyn_cast<PHINode>(&inst);
+        if (!phi) break;
+
+        auto* addRec = dyn_cast<SCEVAddRecExpr>(SE.getSCEV(phi));
+        if (!addRec || addRec->getLoop() != &loop || !addRec->isAffine()) continue;
+
+        auto* step = dyn_cast<SCEVConstant>(addRec->getStepRecurrence(SE));
+        if (!step) fail("induction with a runtime step currently unsupported!");
+
+        uint stepPos;
+        auto* increment = GetIncrement(loop, *phi, stepPos);
+        if (!increment || !isa<ConstantInt>(increment->getOperand(stepPos)))
+        {
+            fail("could not identify the increment of an induction variable.");
+        }
+
+        inductions.push_back(Induction{phi, increment, step->getValue()->getSExtValue()});
+    }
+
+    return inductions;
+}
+
+// the induction that counts iterations for tail handling and peeling (first integer induction)
+static const Induction&
+GetPrimaryInduction(const std::vector<Induction>& inductions)
+{
+    for (auto& induction : inductions)
+    {
+        if (induction.phi->getType()->isIntegerTy()) return induction;
+    }
+    fail("could not identify an integer induction variable in the loop.");
+}
+
+// bump up the increments of all inductions to the vector width
+static void
+ScaleIncrements(Loop& loop, const std::vector<Induction>& inductions, uint vectorWidth)
+{
+    for (auto& induction : inductions)
+    {
+        uint stepPos;
+        GetIncrement(loop, *induction.phi, stepPos);
+        auto* incStep = cast<ConstantInt>(induction.increment->getOperand(stepPos));
+        auto* vectorIncStep = ConstantInt::getSigned(incStep->getType(), incStep->getSExtValue() * vectorWidth);
+        induction.increment->setOperand(stepPos, vectorIncStep);
+    }
+}
+
+// value of @induction @count steps after @start
+static Value*
+CreateInductionStep(IRBuilder<>& builder, const Induction& induction, Value& start, Value& count, const Twine& name)
+{
+    auto* ivTy = start.getType();
+    if (ivTy->isPointerTy())
+    {
+        // the step of a pointer induction is measured in bytes
+        auto* offsetTy = builder.getInt64Ty();
+        auto* offset = builder.CreateMul(builder.CreateZExtOrTrunc(&count, offsetTy),
+                                         ConstantInt::getSigned(offsetTy, induction.step));
+        auto* bytePtr = builder.CreateBitCast(&start, builder.getInt8PtrTy(ivTy->getPointerAddressSpace()));
+        return builder.CreateBitCast(builder.CreateGEP(bytePtr, offset), ivTy, name);
+    }
+
+    auto* stepConst = ConstantInt::getSigned(ivTy, induction.step);
+    return builder.CreateAdd(&start, builder.CreateMul(builder.CreateZExtOrTrunc(&count, ivTy), stepConst), name);
+}
+
+// value of @induction after @count iterations of @loop (emitted outside of the loop)
+static Value*
+CreateInductionValue(IRBuilder<>& builder, Loop& loop, const Induction& induction, Value& count, const Twine& name)
+{
+    return CreateInductionStep(builder, induction, *GetInitValue(loop, *induction.phi), count, name);
+}
+
+// exit block of the latch of @loop (nullptr if the latch does not leave the loop)
+static BasicBlock*
+GetLatchExitBlock(Loop& loop)
+{
+    auto* latch = loop.getLoopLatch();
+    if (!latch) return nullptr;
+    auto* branch = dyn_cast<BranchInst>(latch->getTerminator());
+    if (!branch || !branch->isConditional()) return nullptr;
+    for (uint i = 0; i < 2; ++i)
+    {
+        if (!loop.contains(branch->getSuccessor(i))) return branch->getSuccessor(i);
+    }
+    return nullptr;
+}
+
+// (a) remainder loop
+// preheader:   if (vecTripCount == 0) goto remainder.ph
+// vector loop: runs until iv == init + vecTripCount, exits to vec.middle
+// vec.middle:  if (vecTripCount == tripCount) goto exit
+// remainder.ph/remainder loop: clone of the scalar loop, continues at init + vecTripCount
+// Early exits of the loop are kept in the remainder loop. Returns remainder.ph, @remInitPhis maps the header phis
+// to their initial values in remainder.ph.
+static BasicBlock*
+CreateRemainderLoop(Function& parentFn, Loop& loop, uint vectorWidth, DominatorTree& domTree, LoopInfo& loopInfo,
+                    DenseMap<PHINode*, PHINode*>& remInitPhis)
+{
+    auto* preheader = loop.getLoopPreheader();
+    auto* header = loop.getHeader();
+    auto* exitingBlock = loop.getLoopLatch();
+    auto* exitBlock = GetLatchExitBlock(loop);
+    if (!preheader) fail("loop does not have a preheader!");
+    if (!exitBlock) fail("tail handling requires a rotated loop (exiting latch).");
+
+    auto inductions = CollectInductions(parentFn, loop, domTree, loopInfo);
+    auto& primary = GetPrimaryInduction(inductions);
+    auto& ivPhi = *primary.phi;
+    auto& increment = *primary.increment;
+    auto& ivInit = *GetInitValue(loop, ivPhi);
+
+    // trip counts of the scalar and the vector loop
+    auto* tripCount = ExpandTripCount(parentFn, loop, ivPhi, domTree, loopInfo);
+    IRBuilder<> builder(preheader->getTerminator());
+    auto* widthConst = ConstantInt::get(tripCount->getType(), vectorWidth);
+    auto* stepConst = ConstantInt::getSigned(tripCount->getType(), primary.step);
+    auto* vecTripCount = builder.CreateSub(tripCount, builder.CreateURem(tripCount, widthConst), "vec.tripcount");
+    auto* vecEnd = builder.CreateAdd(&ivInit, builder.CreateMul(vecTripCount, stepConst), "vec.end");
+    auto* skipVector = builder.CreateICmpEQ(vecTripCount, ConstantInt::getNullValue(tripCount->getType()), "vec.skip");
+    auto* isComplete = builder.CreateICmpEQ(vecTripCount, tripCount, "vec.complete");
+
+    // clone the scalar loop
+    ValueToValueMapTy cloneMap;
+    std::vector<BasicBlock*> remBlocks;
+    for (auto* block : loop.blocks())
+    {
+        auto* remBlock = CloneBasicBlock(block, cloneMap, ".rem", &parentFn);
+        cloneMap[block] = remBlock;
+        remBlocks.push_back(remBlock);
+    }
+    for (auto* remBlock : remBlocks)
+    {
+        for (auto& inst : *remBlock)
+        {
+            RemapInstruction(&inst, cloneMap, RF_NoModuleLevelChanges | RF_IgnoreMissingEntries);
+        }
+    }
+
+    auto& context = parentFn.getContext();
+    auto* middleBlock = BasicBlock::Create(context, "vec.middle", &parentFn, exitBlock);
+    auto* remPreheader = BasicBlock::Create(context, "remainder.ph", &parentFn, exitBlock);
+    auto* remHeader = cast<BasicBlock>(cloneMap[header]);
+    auto* remExiting = cast<BasicBlock>(cloneMap[exitingBlock]);
+
+    // values of the inductions after the vector loop are computed in the preheader (no lane of the vector loop
+    // is used outside of it)
+    DenseMap<Value*, Value*> vecExitVals;
+    for (auto& induction : inductions)
+    {
+        auto* phi = induction.phi;
+        vecExitVals[induction.increment] = phi == &ivPhi ? vecEnd
+            : CreateInductionValue(builder, loop, induction, *vecTripCount, phi->getName() + ".vec.end");
+    }
+
+    // remainder loop entry: continue at the last value of each recurrence
+    IRBuilder<> remBuilder(remPreheader);
+    IRBuilder<> middleBuilder(middleBlock);
+    for (auto& inst : *header)
+    {
+        auto* phi = dyn_cast<PHINode>(&inst);
+        if (!phi) break;
+
+        auto itInduction = std::find_if(inductions.begin(), inductions.end(),
+                                        [phi](const Induction& induction) { return induction.phi == phi; });
+        Value* vecExitVal = nullptr;
+        if (itInduction != inductions.end())
+        {
+            vecExitVal = vecExitVals[itInduction->increment];
+        }
+        else
+        {
+            // LCSSA phi of the loop carried value (reductions are resolved by the vectorizer)
+            auto* lcssaPhi = middleBuilder.CreatePHI(phi->getType(), 1, phi->getName() + ".vec.lcssa");
+            lcssaPhi->addIncoming(GetLoopValue(loop, *phi), exitingBlock);
+            vecExitVal = lcssaPhi;
+        }
+
+        auto* remInitPhi = remBuilder.CreatePHI(phi->getType(), 2, phi->getName() + ".rem.init");
+        remInitPhi->addIncoming(GetInitValue(loop, *phi), preheader);
+        remInitPhi->addIncoming(vecExitVal, middleBlock);
+        remInitPhis[phi] = remInitPhi;
+
+        auto* remPhi = cast<PHINode>(cloneMap[phi]);
+        int preheaderIdx = remPhi->getBasicBlockIndex(preheader);
+        remPhi->setIncomingBlock(preheaderIdx, remPreheader);
+        remPhi->setIncomingValue(preheaderIdx, remInitPhi);
+    }
+    remBuilder.CreateBr(remHeader);
+
+    // exit values are taken from vec.middle or the remainder loop
+    for (auto& inst : *exitBlock)
+    {
+        auto* phi = dyn_cast<PHINode>(&inst);
+        if (!phi) break;
+
+        int exitingIdx = phi->getBasicBlockIndex(exitingBlock);
+        auto* liveOut = phi->getIncomingValue(exitingIdx);
+
+        // inductions leave with their computed exit values, other live outs through an LCSSA phi
+        auto itExitVal = vecExitVals.find(liveOut);
+        Value* middleVal = itExitVal != vecExitVals.end() ? itExitVal->second : nullptr;
+        auto itInduction = std::find_if(inductions.begin(), inductions.end(),
+                                        [liveOut](const Induction& induction) { return induction.phi == liveOut; });
+        if (itInduction != inductions.end())
+        {
+            // value of the last vector iteration
+            auto* lastIteration = builder.CreateSub(vecTripCount, ConstantInt::get(tripCount->getType(), 1));
+            middleVal = CreateInductionValue(builder, loop, *itInduction, *lastIteration, liveOut->getName() + ".vec.last");
+        }
+        if (!middleVal)
+        {
+            auto* middlePhi = middleBuilder.CreatePHI(phi->getType(), 1, phi->getName() + ".vec");
+            middlePhi->addIncoming(liveOut, exitingBlock);
+            middleVal = middlePhi;
+        }
+        phi->setIncomingBlock(exitingIdx, middleBlock);
+        phi->setIncomingValue(exitingIdx, middleVal);
+
+        auto itRemLiveOut = cloneMap.find(liveOut);
+        phi->addIncoming(itRemLiveOut != cloneMap.end() ? (Value*) itRemLiveOut->second : liveOut, remExiting);
+    }
+    middleBuilder.CreateCondBr(isComplete, exitBlock, remPreheader);
+
+    // early exits of the remainder loop leave to the same exit blocks (LCSSA: all live outs are exit block phis)
+    SmallVector<BasicBlock*, 4> exitBlocks;
+    loop.getUniqueExitBlocks(exitBlocks);
+    for (auto* earlyExitBlock : exitBlocks)
+    {
+        for (auto& inst : *earlyExitBlock)
+        {
+            auto* phi = dyn_cast<PHINode>(&inst);
+            if (!phi) break;
+
+            uint numIncoming = phi->getNumIncomingValues();
+            for (uint i = 0; i < numIncoming; ++i)
+            {
+                auto* inBlock = phi->getIncomingBlock(i);
+                if (!loop.contains(inBlock) || inBlock == exitingBlock) continue;
+
+                auto* liveOut = phi->getIncomingValue(i);
+                auto itRemLiveOut = cloneMap.find(liveOut);
+                phi->addIncoming(itRemLiveOut != cloneMap.end() ? (Value*) itRemLiveOut->second : liveOut,
+                                 cast<BasicBlock>(cloneMap[inBlock]));
+            }
+        }
+    }
+
+    // vector loop exits after vecTripCount iterations
+    auto* exitBranch = cast<BranchInst>(exitingBlock->getTerminator());
+    auto* oldCond = exitBranch->getCondition();
+    uint exitIdx = exitBranch->getSuccessor(0) == exitBlock ? 0 : 1;
+    IRBuilder<> exitBuilder(exitBranch);
+    auto* vecCond = exitIdx == 0 ? exitBuilder.CreateICmpEQ(&increment, vecEnd, "vec.exitcond")
+                                 : exitBuilder.CreateICmpNE(&increment, vecEnd, "vec.exitcond");
+    exitBranch->setCondition(vecCond);
+    exitBranch->setSuccessor(exitIdx, middleBlock);
+    RecursivelyDeleteTriviallyDeadInstructions(oldCond);
+
+    // runtime guard for short trip counts
+    auto* preheaderBranch = preheader->getTerminator();
+    BranchInst::Create(remPreheader, header, skipVector, preheaderBranch);
+    preheaderBranch->eraseFromParent();
+
+    return remPreheader;
+}
+
+// address range [low, high) that is accessed through @ptr in @loop (bounds are loop invariant)
+static bool
+GetAccessRange(ScalarEvolution& SE, Loop& loop, Value& ptr, const SCEV*& low, const SCEV*& high)
+{
+    auto* ptrSCEV = SE.getSCEV(&ptr);
+    auto& DL = loop.getHeader()->getModule()->getDataLayout();
+    uint64_t accessSize = DL.getTypeStoreSize(cast<PointerType>(ptr.getType())->getElementType());
+    auto* sizeSCEV = SE.getConstant(SE.getEffectiveSCEVType(ptrSCEV->getType()), accessSize);
+
+    if (SE.isLoopInvariant(ptrSCEV, &loop))
+    {
+        low = ptrSCEV;
+        high = SE.getAddExpr(ptrSCEV, sizeSCEV);
+        return true;
+    }
+
+    // affine address {start,+,step} of this loop (accesses in inner loops are not supported)
+    auto* addRec = dyn_cast<SCEVAddRecExpr>(ptrSCEV);
+    if (!addRec || addRec->getLoop() != &loop || !addRec->isAffine()) return false;
+
+    // with early exits the latch exit count over-approximates the accessed range
+    auto* latch = loop.getLoopLatch();
+    auto* backedgeTakenCount = latch ? SE.getExitCount(&loop, latch) : SE.getBackedgeTakenCount(&loop);
+    if (isa<SCEVCouldNotCompute>(backedgeTakenCount)) return false;
+
+    auto* first = addRec->getStart();
+    auto* last = addRec->evaluateAtIteration(backedgeTakenCount, SE);
+    auto* step = addRec->getStepRecurrence(SE);
+    if (SE.isKnownNegative(step)) std::swap(first, last);
+    else if (!SE.isKnownNonNegative(step)) return false;
+
+    low = first;
+    high = SE.getAddExpr(last, sizeSCEV);
+    return true;
+}
+
+// bytes that are known to be dereferenceable at @base (allocas and globals of a fixed size, dereferenceable arguments)
+static uint64_t
+GetDereferenceableBytes(Value& base, const DataLayout& DL)
+{
+    auto* object = base.stripPointerCasts();
+    if (auto* alloca = dyn_cast<AllocaInst>(object))
+    {
+        auto* arraySize = dyn_cast<ConstantInt>(alloca->getArraySize());
+        return arraySize ? DL.getTypeAllocSize(alloca->getAllocatedType()) * arraySize->getZExtValue() : 0;
+    }
+    if (auto* global = dyn_cast<GlobalVariable>(object))
+    {
+        return global->hasDefinitiveInitializer() ? DL.getTypeAllocSize(global->getValueType()) : 0;
+    }
+    if (auto* arg = dyn_cast<Argument>(object)) return arg->getDereferenceableBytes();
+    return 0;
+}
+
+// The early exit conditions are evaluated for all lanes of a vector iteration, also for the lanes after an exit.
+// Their loads have to be dereferenceable over the whole range that the trip count of the latch exit admits
+// (e.g. a search in a global or local array with the array size as the bound, not a strlen-like search).
+static void
+CheckEarlyExitSpeculation(Function& parentFn, Loop& loop, DominatorTree& domTree, LoopInfo& loopInfo)
+{
+    TargetLibraryAnalysis libAnalysis;
+    TargetLibraryInfo tli = libAnalysis.run(*parentFn.getParent());
+    AssumptionCache assumptionCache(parentFn);
+    ScalarEvolution SE(parentFn, tli, assumptionCache, domTree, loopInfo);
+    auto& DL = parentFn.getParent()->getDataLayout();
+
+    // the exit condition slices (header phis are the recurrences, not part of the slice)
+    SmallVector<BasicBlock*, 4> exitingBlocks;
+    loop.getExitingBlocks(exitingBlocks);
+    std::vector<Instruction*> stack;
+    for (auto* exitingBlock : exitingBlocks)
+    {
+        auto* exitBranch = dyn_cast<BranchInst>(exitingBlock->getTerminator());
+        if (exitingBlock == loop.getLoopLatch() || !exitBranch || !exitBranch->isConditional()) continue;
+        if (auto* cond = dyn_cast<Instruction>(exitBranch->getCondition())) stack.push_back(cond);
+    }
+
+    SmallPtrSet<Instruction*, 16> visited;
+    while (!stack.empty())
+    {
+        auto* inst = stack.back();
+        stack.pop_back();
+        if (!loop.contains(inst->getParent()) || !visited.insert(inst).second) continue;
+        if (isa<PHINode>(inst) && inst->getParent() == loop.getHeader()) continue;
+
+        if (auto* load = dyn_cast<LoadInst>(inst))
+        {
+            const SCEV* low = nullptr;
+            const SCEV* high = nullptr;
+            bool inBounds = GetAccessRange(SE, loop, *load->getPointerOperand(), low, high);
+            auto* base = inBounds ? dyn_cast<SCEVUnknown>(SE.getPointerBase(low)) : nullptr;
+            auto* lowOffset = base ? dyn_cast<SCEVConstant>(SE.getMinusSCEV(low, base)) : nullptr;
+            auto* highOffset = base ? dyn_cast<SCEVConstant>(SE.getMinusSCEV(high, base)) : nullptr;
+            inBounds = lowOffset && highOffset && !lowOffset->getValue()->isNegative() &&
+                       !highOffset->getValue()->isNegative() &&
+                       highOffset->getValue()->getZExtValue() <= GetDereferenceableBytes(*base->getValue(), DL);
+            if (!inBounds) fail("early exit condition loads beyond a known dereferenceable range currently unsupported!");
+        }
+
+        for (auto& op : inst->operands())
+        {
+            if (auto* opInst = dyn_cast<Instruction>(op)) stack.push_back(opInst);
+        }
+    }
+}
+
+// clone the computation of @val in @loop before @insertBefore (header phis and loop invariant values are reused)
+static Value*
+CloneExitSlice(Loop& loop, Value& val, ValueToValueMapTy& sliceMap, Instruction& insertBefore)
+{
+    auto* inst = dyn_cast<Instruction>(&val);
+    if (!inst || !loop.contains(inst->getParent())) return &val;
+    if (isa<PHINode>(inst) && inst->getParent() == loop.getHeader()) return &val;
+
+    auto itClone = sliceMap.find(inst);
+    if (itClone != sliceMap.end()) return itClone->second;
+
+    if (isa<PHINode>(inst) || inst->mayHaveSideEffects()) fail("unsupported early exit condition (phi or side effect).");
+
+    auto* clone = inst->clone();
+    for (uint i = 0; i < inst->getNumOperands(); ++i)
+    {
+        clone->setOperand(i, CloneExitSlice(loop, *inst->getOperand(i), sliceMap, insertBefore));
+    }
+    clone->insertBefore(&insertBefore);
+    clone->setName(inst->getName() + ".early");
+    sliceMap[inst] = clone;
+    return clone;
+}
+
+// (e) early exits (after the remainder loop was created)
+// header:    if (rv_any(exit conditions of the early exits, evaluated for every lane)) goto vec.break
+// vec.break: goto remainder.ph, the remainder loop executes the vector iteration from its first lane
+//            and leaves through the early exit of the first exiting lane with its live outs
+// Search loops (no memory writes, only inductions are carried) start the remainder loop at the first exiting lane
+// (cttz of the exit mask) instead, which then leaves in its first iteration.
+// The early exit edges are removed from the vector loop. The exit conditions are evaluated speculatively at the
+// start of the iteration, so no side effects may execute before an early exit. CheckEarlyExitSpeculation makes sure
+// that their loads are dereferenceable up to the trip count of the latch exit.
+static void
+GuardEarlyExits(Function& parentFn, Loop& loop, const std::vector<Induction>& inductions, BasicBlock& remPreheader,
+                DenseMap<PHINode*, PHINode*>& remInitPhis)
+{
+    auto* header = loop.getHeader();
+    auto* latch = loop.getLoopLatch();
+
+    SmallVector<BasicBlock*, 4> exitingBlocks;
+    loop.getExitingBlocks(exitingBlocks);
+    std::vector<BranchInst*> earlyExits;
+    for (auto* exitingBlock : exitingBlocks)
+    {
+        if (exitingBlock == latch) continue;
+        auto* exitBranch = dyn_cast<BranchInst>(exitingBlock->getTerminator());
+        if (!exitBranch || !exitBranch->isConditional()) fail("unsupported early exit (expected a conditional branch).");
+        earlyExits.push_back(exitBranch);
+    }
+    if (earlyExits.empty()) return;
+
+    // blocks that may execute before an early exit in the same iteration
+    SmallPtrSet<BasicBlock*, 16> beforeExit;
+    std::vector<BasicBlock*> stack(exitingBlocks.begin(), exitingBlocks.end());
+    stack.erase(std::remove(stack.begin(), stack.end(), latch), stack.end());
+    while (!stack.empty())
+    {
+        auto* block = stack.back();
+        stack.pop_back();
+        if (!beforeExit.insert(block).second || block == header) continue;
+        for (auto it = pred_begin(block); it != pred_end(block); ++it)
+        {
+            if (loop.contains(*it)) stack.push_back(*it);
+        }
+    }
+    for (auto* block : beforeExit)
+    {
+        for (auto& inst : *block)
+        {
+            if (inst.mayWriteToMemory() || inst.mayThrow()) fail("side effects before an early exit currently unsupported!");
+        }
+    }
+
+    // evaluate all exit conditions at the start of the iteration
+    auto& firstInst = *header->getFirstNonPHI();
+    ValueToValueMapTy sliceMap;
+    IRBuilder<> builder(&firstInst);
+    Value* anyExit = nullptr;
+    for (auto* exitBranch : earlyExits)
+    {
+        auto* exitCond = CloneExitSlice(loop, *exitBranch->getCondition(), sliceMap, firstInst);
+        builder.SetInsertPoint(&firstInst);
+        if (loop.contains(exitBranch->getSuccessor(0))) exitCond = builder.CreateNot(exitCond, "early.exitcond");
+        anyExit = anyExit ? builder.CreateOr(anyExit, exitCond, "early.exit") : exitCond;
+    }
+
+    auto& mod = *parentFn.getParent();
+    auto* boolTy = builder.getInt1Ty();
+    auto* anyFunc = mod.getFunction("rv_any");
+    if (!anyFunc)
+    {
+        anyFunc = Function::Create(FunctionType::get(boolTy, boolTy, false), GlobalValue::ExternalLinkage, "rv_any", &mod);
+        anyFunc->setDoesNotAccessMemory();
+        anyFunc->setDoesNotThrow();
+        anyFunc->setConvergent();
+        anyFunc->setDoesNotRecurse();
+    }
+    auto* anyLaneExits = builder.CreateCall(anyFunc, anyExit, "early.any");
+
+    // the first exiting lane of search loops
+    bool isSearchLoop = true;
+    for (auto* block : loop.blocks())
+    {
+        for (auto& inst : *block)
+        {
+            isSearchLoop &= !inst.mayWriteToMemory();
+            auto* phi = dyn_cast<PHINode>(&inst);
+            if (!phi || block != header) continue;
+            isSearchLoop &= std::any_of(inductions.begin(), inductions.end(),
+                                        [phi](const Induction& induction) { return induction.phi == phi; });
+        }
+    }
+
+    DenseMap<PHINode*, Value*> exitLaneValues;
+    if (isSearchLoop)
+    {
+        auto* ballotFunc = mod.getFunction("rv_ballot");
+        if (!ballotFunc)
+        {
+            ballotFunc = Function::Create(FunctionType::get(builder.getInt32Ty(), boolTy, false),
+                                          GlobalValue::ExternalLinkage, "rv_ballot", &mod);
+            ballotFunc->setDoesNotAccessMemory();
+            ballotFunc->setDoesNotThrow();
+            ballotFunc->setConvergent();
+            ballotFunc->setDoesNotRecurse();
+        }
+        auto* exitMask = builder.CreateCall(ballotFunc, anyExit, "early.mask");
+        auto* cttzFunc = Intrinsic::getDeclaration(&mod, Intrinsic::cttz, builder.getInt32Ty());
+        auto* exitLane = builder.CreateCall(cttzFunc, {exitMask, builder.getFalse()}, "early.lane");
+        for (auto& induction : inductions)
+        {
+            exitLaneValues[induction.phi] =
+                CreateInductionStep(builder, induction, *induction.phi, *exitLane, induction.phi->getName() + ".lane");
+        }
+    }
+
+    // leave to the remainder loop at the start of the iteration
+    auto& context = parentFn.getContext();
+    auto* bodyBlock = header->splitBasicBlock(&firstInst, header->getName() + ".body");
+    auto* breakBlock = BasicBlock::Create(context, "vec.break", &parentFn, &remPreheader);
+    header->getTerminator()->eraseFromParent();
+    BranchInst::Create(breakBlock, bodyBlock, anyLaneExits, header);
+
+    // LCSSA phis of the recurrences at the start of the iteration (or at the exiting lane of search loops): the
+    // vectorizer passes on the first lane of inductions and the reduced value of reductions
+    IRBuilder<> breakBuilder(breakBlock);
+    for (auto& inst : *header)
+    {
+        auto* phi = dyn_cast<PHINode>(&inst);
+        if (!phi) break;
+
+        auto* remInitPhi = remInitPhis.lookup(phi);
+        assert(remInitPhi && "no initial value of the remainder loop for a header phi");
+        auto* breakPhi = breakBuilder.CreatePHI(phi->getType(), 1, phi->getName() + ".break");
+        auto* exitLaneValue = exitLaneValues.lookup(phi);
+        breakPhi->addIncoming(exitLaneValue ? exitLaneValue : phi, header);
+        remInitPhi->addIncoming(breakPhi, breakBlock);
+    }
+    breakBuilder.CreateBr(&remPreheader);
+
+    // drop the early exit edges of the vector loop
+    for (auto* exitBranch : earlyExits)
+    {
+        uint exitIdx = loop.contains(exitBranch->getSuccessor(0)) ? 1 : 0;
+        auto* exitBlock = exitBranch->getSuccessor(exitIdx);
+        auto* exitingBlock = exitBranch->getParent();
+        auto* oldCond = exitBranch->getCondition();
+        exitBlock->removePredecessor(exitingBlock, true);
+        BranchInst::Create(exitBranch->getSuccessor(1 - exitIdx), exitBranch);
+        exitBranch->eraseFromParent();
+        RecursivelyDeleteTriviallyDeadInstructions(oldCond);
+    }
+
+    errs() << "Guarded " << earlyExits.size() << " early exit(s) of the vector loop"
+           << (isSearchLoop ? " (the remainder starts at the exiting lane)" : "") << "\n";
+}
+
+// (b) tail folding
+// header:     if ((iv - init) / step < tripCount) goto body else goto fold.latch
+// fold.latch: increments the inductions, blends other loop carried values of inactive iterations,
+//             exits at init + roundUp(tripCount, W) * step
+static void
+FoldTail(Function& parentFn, Loop& loop, uint vectorWidth, DominatorTree& domTree, LoopInfo& loopInfo)
+{
+    auto* header = loop.getHeader();
+    auto* exitingBlock = loop.getExitingBlock();
+    auto* exitBlock = loop.getExitBlock();
+    if (!loop.getLoopPreheader() || !exitingBlock || !exitBlock) fail("loop does not have a unique exit block!");
+    if (exitingBlock != loop.getLoopLatch()) fail("tail handling requires a rotated loop (exiting latch).");
+
+    auto inductions = CollectInductions(parentFn, loop, domTree, loopInfo);
+    auto& primary = GetPrimaryInduction(inductions);
+    auto& ivPhi = *primary.phi;
+    auto& ivInit = *GetInitValue(loop, ivPhi);
+
+    // iterate ceil(tripCount / W) times
+    auto* tripCount = ExpandTripCount(parentFn, loop, ivPhi, domTree, loopInfo);
+    IRBuilder<> builder(loop.getLoopPreheader()->getTerminator());
+    auto* widthConst = ConstantInt::get(tripCount->getType(), vectorWidth);
+    auto* stepConst = ConstantInt::getSigned(tripCount->getType(), primary.step);
+    auto* roundedUp = builder.CreateAdd(tripCount, ConstantInt::get(tripCount->getType(), vectorWidth - 1));
+    auto* foldTripCount = builder.CreateSub(roundedUp, builder.CreateURem(roundedUp, widthConst), "fold.tripcount");
+    auto* foldEnd = builder.CreateAdd(&ivInit, builder.CreateMul(foldTripCount, stepConst), "fold.end");
+    // distance covered by the active iterations (measured against the direction of the step)
+    auto* tripDistance = builder.CreateMul(tripCount, ConstantInt::get(tripCount->getType(), std::abs(primary.step)),
+                                           "fold.distance");
+
+    // collect the loop carried values before the CFG changes
+    SmallVector<PHINode*, 4> headerPhis;
+    for (auto& inst : *header)
+    {
+        auto* phi = dyn_cast<PHINode>(&inst);
+        if (!phi) break;
+        headerPhis.push_back(phi);
+    }
+    auto* exitBranch = cast<BranchInst>(exitingBlock->getTerminator());
+
+    // guard the loop body with the lane predicate
+    auto* bodyBlock = header->splitBasicBlock(header->getFirstNonPHI(), header->getName() + ".fold.body");
+    auto* latchBlock = exitBranch->getParent(); // moved by the split for single block loops
+    auto* foldLatch = BasicBlock::Create(parentFn.getContext(), "fold.latch", &parentFn, exitBlock);
+
+    header->getTerminator()->eraseFromParent();
+    IRBuilder<> headerBuilder(header);
+    auto* ivOffset = primary.step > 0 ? headerBuilder.CreateSub(&ivPhi, &ivInit, "fold.offset")
+                                      : headerBuilder.CreateSub(&ivInit, &ivPhi, "fold.offset");
+    auto* inBounds = headerBuilder.CreateICmpULT(ivOffset, tripDistance, "fold.inbounds");
+    headerBuilder.CreateCondBr(inBounds, bodyBlock, foldLatch);
+
+    // inductions advance in all iterations (the increments are inserted after the blend phis)
+    IRBuilder<> latchBuilder(foldLatch);
+    DenseMap<Value*, Value*> blendMap;
+    std::vector<Instruction*> foldIncrements;
+    Instruction* foldIvNext = nullptr;
+    for (auto& induction : inductions)
+    {
+        auto* foldIncrement = induction.increment->clone();
+        foldIncrement->setName(induction.phi->getName() + ".fold.next");
+        foldIncrements.push_back(foldIncrement);
+        blendMap[induction.increment] = foldIncrement;
+        if (induction.phi == &ivPhi) foldIvNext = foldIncrement;
+
+        int latchIdx = induction.phi->getBasicBlockIndex(latchBlock);
+        induction.phi->setIncomingBlock(latchIdx, foldLatch);
+        induction.phi->setIncomingValue(latchIdx, foldIncrement);
+    }
+
+    // blend other loop carried values (inactive iterations keep the previous value)
+    for (auto* phi : headerPhis)
+    {
+        bool isInduction = std::any_of(inductions.begin(), inductions.end(),
+                                       [=](const Induction& induction) { return induction.phi == phi; });
+        if (isInduction) continue;
+
+        int latchIdx = phi->getBasicBlockIndex(latchBlock);
+        auto* loopVal = phi->getIncomingValue(latchIdx);
+        auto* blendPhi = latchBuilder.CreatePHI(phi->getType(), 2, phi->getName() + ".fold");
+        blendPhi->addIncoming(loopVal, latchBlock);
+        blendPhi->addIncoming(phi, header);
+        blendMap[loopVal] = blendPhi;
+
+        phi->setIncomingBlock(latchIdx, foldLatch);
+        phi->setIncomingValue(latchIdx, blendPhi);
+    }
+
+    // live outs are taken from the latch
+    for (auto& inst : *exitBlock)
+    {
+        auto* phi = dyn_cast<PHINode>(&inst);
+        if (!phi) break;
+
+        int exitingIdx = phi->getBasicBlockIndex(latchBlock);
+        auto* liveOut = phi->getIncomingValue(exitingIdx);
+        Value* foldLiveOut = blendMap.lookup(liveOut);
+        if (!foldLiveOut)
+        {
+            auto* liveOutInst = dyn_cast<Instruction>(liveOut);
+            if (liveOutInst && liveOutInst->getParent() != header && loop.contains(liveOutInst->getParent()))
+            {
+                auto* blendPhi = PHINode::Create(liveOut->getType(), 2, liveOut->getName() + ".fold", foldLatch);
+                blendPhi->addIncoming(liveOut, latchBlock);
+                blendPhi->addIncoming(UndefValue::get(liveOut->getType()), header);
+                foldLiveOut = blendPhi;
+            }
+            else
+            {
+                foldLiveOut = liveOut;
+            }
+        }
+        phi->setIncomingBlock(exitingIdx, foldLatch);
+        phi->setIncomingValue(exitingIdx, foldLiveOut);
+    }
+
+    for (auto* foldIncrement : foldIncrements)
+    {
+        foldLatch->getInstList().push_back(foldIncrement);
+    }
+
+    // exit after the last (partial) vector iteration
+    auto* exitCond = latchBuilder.CreateICmpEQ(foldIvNext, foldEnd, "fold.exitcond");
+    latchBuilder.CreateCondBr(exitCond, exitBlock, header);
+
+    auto* oldCond = exitBranch->getCondition();
+    BranchInst::Create(foldLatch, exitBranch);
+    exitBranch->eraseFromParent();
+    RecursivelyDeleteTriviallyDeadInstructions(oldCond);
+}
+
+// all accesses of the loop through one pointer base
+struct PointerGroup
+{
+    const SCEV* base;
+    const SCEV* low;
+    const SCEV* high;
+    bool written;
+};
+
+// (c) runtime alias check
+// preheader:   conflict = any (low_a < high_b && low_b < high_a) for pointer groups a, b (one of them written)
+//              if (conflict) goto scalar loop else goto loop
+// scalar loop: untouched clone of the loop, leaves to the same exit blocks
+// Returns false (and leaves the function unchanged) if the accessed ranges can not be computed.
+static bool
+VersionLoopForAliasing(Function& parentFn, Loop& loop, DominatorTree& domTree, LoopInfo& loopInfo)
+{
+    auto* preheader = loop.getLoopPreheader();
+    auto* header = loop.getHeader();
+    if (!preheader) return false;
+
+    TargetLibraryAnalysis libAnalysis;
+    TargetLibraryInfo tli = libAnalysis.run(*parentFn.getParent());
+    AssumptionCache assumptionCache(parentFn);
+    ScalarEvolution SE(parentFn, tli, assumptionCache, domTree, loopInfo);
+
+    // group the accessed ranges by pointer base
+    std::vector<PointerGroup> groups;
+    for (auto* block : loop.blocks())
+    {
+        for (auto& inst : *block)
+        {
+            Value* ptr = nullptr;
+            bool isWrite = false;
+            if (auto* load = dyn_cast<LoadInst>(&inst)) ptr = load->getPointerOperand();
+            else if (auto* store = dyn_cast<StoreInst>(&inst))
+            {
+                ptr = store->getPointerOperand();
+                isWrite = true;
+            }
+            else if (isa<CallInst>(&inst) && inst.mayWriteToMemory())
+            {
+                auto* callee = cast<CallInst>(inst).getCalledFunction();
+                if (!callee || !callee->getName().startswith("rv_")) return false;
+            }
+
+            if (!ptr) continue;
+
+            const SCEV* low = nullptr;
+            const SCEV* high = nullptr;
+            if (!GetAccessRange(SE, loop, *ptr, low, high)) return false;
+
+            auto* base = SE.getPointerBase(low);
+            auto itGroup = std::find_if(groups.begin(), groups.end(), [=](const PointerGroup& group) { return group.base == base; });
+            if (itGroup == groups.end())
+            {
+                groups.push_back(PointerGroup{base, low, high, isWrite});
+            }
+            else
+            {
+                itGroup->low = SE.getUMinExpr(itGroup->low, low);
+                itGroup->high = SE.getUMaxExpr(itGroup->high, high);
+                itGroup->written |= isWrite;
+            }
+        }
+    }
+
+    // nothing to check
+    std::vector<std::pair<uint, uint>> checks;
+    for (uint i = 0; i < groups.size(); ++i)
+    {
+        for (uint j = i + 1; j < groups.size(); ++j)
+        {
+            if (groups[i].written || groups[j].written) checks.push_back(std::make_pair(i, j));
+        }
+    }
+    if (checks.empty()) return true;
+
+    // expand the bounds in the preheader
+    auto* preheaderBranch = preheader->getTerminator();
+    auto* bytePtrTy = Type::getInt8PtrTy(parentFn.getContext());
+    SCEVExpander expander(SE, parentFn.getParent()->getDataLayout(), "memcheck");
+    std::vector<Value*> lows, highs;
+    for (auto& group : groups)
+    {
+        lows.push_back(expander.expandCodeFor(group.low, bytePtrTy, preheaderBranch));
+        highs.push_back(expander.expandCodeFor(group.high, bytePtrTy, preheaderBranch));
+    }
+
+    IRBuilder<> builder(preheaderBranch);
+    Value* conflict = nullptr;
+    for (auto& check : checks)
+    {
+        uint a = check.first, b = check.second;
+        auto* overlap = builder.CreateAnd(builder.CreateICmpULT(lows[a], highs[b]),
+                                          builder.CreateICmpULT(lows[b], highs[a]), "memcheck.overlap");
+        conflict = conflict ? builder.CreateOr(conflict, overlap, "memcheck.conflict") : overlap;
+    }
+    errs() << "Runtime alias check for " << checks.size() << " pointer pair(s) in the loop preheader\n";
+
+    // clone the scalar loop
+    ValueToValueMapTy cloneMap;
+    std::vector<BasicBlock*> scalarBlocks;
+    for (auto* block : loop.blocks())
+    {
+        auto* scalarBlock = CloneBasicBlock(block, cloneMap, ".scalar", &parentFn);
+        cloneMap[block] = scalarBlock;
+        scalarBlocks.push_back(scalarBlock);
+    }
+    for (auto* scalarBlock : scalarBlocks)
+    {
+        for (auto& inst : *scalarBlock)
+        {
+            RemapInstruction(&inst, cloneMap, RF_NoModuleLevelChanges | RF_IgnoreMissingEntries);
+        }
+    }
+
+    // the scalar loop leaves to the same exit blocks (LCSSA: all live outs are exit block phis)
+    SmallVector<BasicBlock*, 4> exitBlocks;
+    loop.getUniqueExitBlocks(exitBlocks);
+    for (auto* exitBlock : exitBlocks)
+    {
+        for (auto& inst : *exitBlock)
+        {
+            auto* phi = dyn_cast<PHINode>(&inst);
+            if (!phi) break;
+
+            uint numIncoming = phi->getNumIncomingValues();
+            for (uint i = 0; i < numIncoming; ++i)
+            {
+                auto* inBlock = phi->getIncomingBlock(i);
+                if (!loop.contains(inBlock)) continue;
+
+                auto* liveOut = phi->getIncomingValue(i);
+                auto itScalarLiveOut = cloneMap.find(liveOut);
+                phi->addIncoming(itScalarLiveOut != cloneMap.end() ? (Value*) itScalarLiveOut->second : liveOut,
+                                 cast<BasicBlock>(cloneMap[inBlock]));
+            }
+        }
+    }
 
-Module*
-createModuleFromFile(const std::string& fileName, LLVMContext & context)
-{
-    SMDiagnostic diag;
-    auto modPtr = llvm::parseIRFile(fileName, diag, context);
-    return modPtr.release();
+    // branch to the scalar loop on conflict
+    BranchInst::Create(cast<BasicBlock>(cloneMap[header]), header, conflict, preheaderBranch);
+    preheaderBranch->eraseFromParent();
+    return true;
 }
 
-void
-writeModuleToFile(Module* mod, const std::string& fileName)
+// unit stride access of a loop (address {start,+,elemSize})
+struct ContiguousAccess
 {
-    assert (mod);
-    std::error_code EC;
-    raw_fd_ostream file(fileName, EC, sys::fs::OpenFlags::F_RW);
-    mod->print(file, nullptr);
-    if (EC)
+    Instruction* inst;
+    const SCEV* start;
+    uint64_t elemSize;
+    bool isStore;
+};
+
+// (d) alignment peeling
+// preheader:    peelCount = iterations until the dominant store stream is aligned to W * elemSize
+//               if (peelCount == 0) goto main.ph
+// peel loop:    clone of the scalar loop, runs peelCount iterations
+// peel.exit:    if (peelCount == tripCount) goto exit
+// main.ph/loop: continues at init + peelCount
+// @alignedAccesses receives the accesses of the loop that are vector aligned in the main loop (with their alignment)
+// Returns false (and leaves the function unchanged) if there is no unit stride store in the loop.
+static bool
+PeelForAlignment(Function& parentFn, Loop& loop, uint vectorWidth, DominatorTree& domTree, LoopInfo& loopInfo,
+                 DenseMap<const Instruction*, uint>& alignedAccesses)
+{
+    auto* preheader = loop.getLoopPreheader();
+    auto* header = loop.getHeader();
+    auto* exitingBlock = loop.getExitingBlock();
+    auto* exitBlock = loop.getExitBlock();
+    if (!preheader || !exitingBlock || !exitBlock) fail("loop does not have a unique exit block!");
+    if (exitingBlock != loop.getLoopLatch()) fail("alignment peeling requires a rotated loop (exiting latch).");
+
+    auto inductions = CollectInductions(parentFn, loop, domTree, loopInfo);
+    auto& primary = GetPrimaryInduction(inductions);
+    if (primary.step != 1) fail("alignment peeling requires an induction variable with step +1.");
+    auto& ivPhi = *primary.phi;
+    auto& ivInit = *GetInitValue(loop, ivPhi);
+
+    auto& DL = parentFn.getParent()->getDataLayout();
+    TargetLibraryAnalysis libAnalysis;
+    TargetLibraryInfo tli = libAnalysis.run(*parentFn.getParent());
+    AssumptionCache assumptionCache(parentFn);
+    ScalarEvolution SE(parentFn, tli, assumptionCache, domTree, loopInfo);
+
+    // unit stride accesses of this loop (not of inner loops)
+    std::vector<ContiguousAccess> accesses;
+    for (auto* block : loop.blocks())
     {
-        errs() << "ERROR: printing module to file failed: " << EC.message() << "\n";
-        fail();
+        if (loopInfo.getLoopFor(block) != &loop) continue;
+        for (auto& inst : *block)
+        {
+            Value* ptr = nullptr;
+            bool isStore = false;
+            if (auto* load = dyn_cast<LoadInst>(&inst)) ptr = load->getPointerOperand();
+            else if (auto* store = dyn_cast<StoreInst>(&inst))
+            {
+                ptr = store->getPointerOperand();
+                isStore = true;
+            }
+            if (!ptr) continue;
+
+            uint64_t elemSize = DL.getTypeStoreSize(cast<PointerType>(ptr->getType())->getElementType());
+            auto* addRec = dyn_cast<SCEVAddRecExpr>(SE.getSCEV(ptr));
+            if (!addRec || addRec->getLoop() != &loop || !addRec->isAffine() || !isPowerOf2_64(elemSize)) continue;
+            auto* step = dyn_cast<SCEVConstant>(addRec->getStepRecurrence(SE));
+            if (!step || step->getValue()->getSExtValue() != static_cast<int64_t>(elemSize)) continue;
+
+            accesses.push_back(ContiguousAccess{&inst, addRec->getStart(), elemSize, isStore});
+        }
     }
-    file.close();
-}
 
-void
-normalizeFunction(Function& F)
-{
-    legacy::FunctionPassManager FPM(F.getParent());
-    FPM.add(createLoopSimplifyPass());
-    FPM.add(createLCSSAPass());
-    FPM.run(F);
-}
+    // accesses that are vector aligned whenever @dominant is (constant distance, a multiple of their vector size)
+    auto collectAligned = [&](const ContiguousAccess& dominant, DenseMap<const Instruction*, uint>& aligned)
+    {
+        for (auto& access : accesses)
+        {
+            if (dominant.elemSize % access.elemSize != 0) continue;
+            int64_t alignment = vectorWidth * access.elemSize;
+            auto* distance = dyn_cast<SCEVConstant>(SE.getMinusSCEV(access.start, dominant.start));
+            if (!distance || distance->getValue()->getSExtValue() % alignment != 0) continue;
+            aligned[access.inst] = alignment;
+        }
+    };
 
-static Value*
-GetInitValue(Loop& loop, PHINode& phi)
-{
-    for (uint i = 0; i < phi.getNumIncomingValues(); ++i)
+    // the dominant store stream aligns the most stores (and then the most accesses)
+    const ContiguousAccess* dominant = nullptr;
+    uint bestStores = 0, bestAccesses = 0;
+    for (auto& candidate : accesses)
     {
-        if (!loop.contains(phi.getIncomingBlock(i)))
+        if (!candidate.isStore) continue;
+
+        DenseMap<const Instruction*, uint> aligned;
+        collectAligned(candidate, aligned);
+        uint numStores = 0;
+        for (auto& access : accesses)
         {
-            return phi.getIncomingValue(i);
+            if (access.isStore && aligned.count(access.inst)) ++numStores;
+        }
+
+        if (!dominant || numStores > bestStores || (numStores == bestStores && aligned.size() > bestAccesses))
+        {
+            dominant = &candidate;
+            bestStores = numStores;
+            bestAccesses = aligned.size();
         }
     }
-    return nullptr;
+    if (!dominant) return false;
+    collectAligned(*dominant, alignedAccesses);
+
+    // number of peeled iterations
+    auto* tripCount = ExpandTripCount(parentFn, loop, ivPhi, domTree, loopInfo);
+    auto* ivTy = ivPhi.getType();
+    auto* intPtrTy = DL.getIntPtrType(parentFn.getContext());
+    uint64_t elemSize = dominant->elemSize;
+    uint64_t vecBytes = vectorWidth * elemSize;
+
+    SCEVExpander expander(SE, DL, "peel");
+    auto* startPtr = expander.expandCodeFor(dominant->start, dominant->start->getType(), preheader->getTerminator());
+    IRBuilder<> builder(preheader->getTerminator());
+    auto* startAddr = builder.CreatePtrToInt(startPtr, intPtrTy, "peel.addr");
+    auto* misalign = builder.CreateAnd(startAddr, vecBytes - 1, "peel.misalign");
+    auto* peelBytes = builder.CreateAnd(builder.CreateSub(ConstantInt::get(intPtrTy, vecBytes), misalign), vecBytes - 1);
+    auto* peelIters = builder.CreateZExtOrTrunc(builder.CreateLShr(peelBytes, Log2_64(elemSize)), ivTy);
+    // the stream can not be aligned if it is not element aligned: run all iterations in the peel loop
+    auto* elemAligned = builder.CreateICmpEQ(builder.CreateAnd(startAddr, elemSize - 1), ConstantInt::get(intPtrTy, 0));
+    auto* peelCount = builder.CreateSelect(elemAligned, peelIters, tripCount);
+    peelCount = builder.CreateSelect(builder.CreateICmpULT(peelCount, tripCount), peelCount, tripCount, "peel.count");
+    auto* peelEnd = builder.CreateAdd(&ivInit, peelCount, "peel.end");
+    auto* skipPeel = builder.CreateICmpEQ(peelCount, ConstantInt::getNullValue(ivTy), "peel.skip");
+    auto* peelAll = builder.CreateICmpEQ(peelCount, tripCount, "peel.all");
+
+    // clone the scalar loop
+    ValueToValueMapTy cloneMap;
+    std::vector<BasicBlock*> peelBlocks;
+    for (auto* block : loop.blocks())
+    {
+        auto* peelBlock = CloneBasicBlock(block, cloneMap, ".peel", &parentFn);
+        cloneMap[block] = peelBlock;
+        peelBlocks.push_back(peelBlock);
+    }
+    for (auto* peelBlock : peelBlocks)
+    {
+        for (auto& inst : *peelBlock)
+        {
+            RemapInstruction(&inst, cloneMap, RF_NoModuleLevelChanges | RF_IgnoreMissingEntries);
+        }
+    }
+    auto mapToPeel = [&](Value* val)
+    {
+        auto it = cloneMap.find(val);
+        return it != cloneMap.end() ? (Value*) it->second : val;
+    };
+
+    auto& context = parentFn.getContext();
+    auto* peelExit = BasicBlock::Create(context, "peel.exit", &parentFn, header);
+    auto* mainPreheader = BasicBlock::Create(context, "peel.main.ph", &parentFn, header);
+    auto* peelHeader = cast<BasicBlock>(cloneMap[header]);
+    auto* peelLatch = cast<BasicBlock>(cloneMap[exitingBlock]);
+
+    // the main loop continues with the last values of the peel loop
+    IRBuilder<> peelExitBuilder(peelExit);
+    IRBuilder<> mainBuilder(mainPreheader);
+    for (auto& inst : *header)
+    {
+        auto* phi = dyn_cast<PHINode>(&inst);
+        if (!phi) break;
+
+        auto* peelFinal = peelExitBuilder.CreatePHI(phi->getType(), 1, phi->getName() + ".peel.final");
+        peelFinal->addIncoming(mapToPeel(GetLoopValue(loop, *phi)), peelLatch);
+
+        auto* mainInit = mainBuilder.CreatePHI(phi->getType(), 2, phi->getName() + ".main.init");
+        mainInit->addIncoming(GetInitValue(loop, *phi), preheader);
+        mainInit->addIncoming(peelFinal, peelExit);
+
+        int preheaderIdx = phi->getBasicBlockIndex(preheader);
+        phi->setIncomingBlock(preheaderIdx, mainPreheader);
+        phi->setIncomingValue(preheaderIdx, mainInit);
+    }
+    mainBuilder.CreateBr(header);
+
+    // if all iterations were peeled, live outs come from the peel loop
+    for (auto& inst : *exitBlock)
+    {
+        auto* phi = dyn_cast<PHINode>(&inst);
+        if (!phi) break;
+
+        auto* liveOut = phi->getIncomingValueForBlock(exitingBlock);
+        auto* peelLiveOut = peelExitBuilder.CreatePHI(phi->getType(), 1, phi->getName() + ".peel");
+        peelLiveOut->addIncoming(mapToPeel(liveOut), peelLatch);
+        phi->addIncoming(peelLiveOut, peelExit);
+    }
+    peelExitBuilder.CreateCondBr(peelAll, exitBlock, mainPreheader);
+
+    // the peel loop exits after peelCount iterations
+    auto* peelBranch = cast<BranchInst>(peelLatch->getTerminator());
+    auto* oldCond = peelBranch->getCondition();
+    uint exitIdx = peelBranch->getSuccessor(0) == exitBlock ? 0 : 1;
+    IRBuilder<> latchBuilder(peelBranch);
+    auto* peelIncrement = mapToPeel(GetLoopValue(loop, ivPhi));
+    auto* peelCond = exitIdx == 0 ? latchBuilder.CreateICmpEQ(peelIncrement, peelEnd, "peel.exitcond")
+                                  : latchBuilder.CreateICmpNE(peelIncrement, peelEnd, "peel.exitcond");
+    peelBranch->setCondition(peelCond);
+    peelBranch->setSuccessor(exitIdx, peelExit);
+    RecursivelyDeleteTriviallyDeadInstructions(oldCond);
+
+    auto* preheaderBranch = preheader->getTerminator();
+    BranchInst::Create(mainPreheader, peelHeader, skipPeel, preheaderBranch);
+    preheaderBranch->eraseFromParent();
+
+    errs() << "Peeling for alignment: " << alignedAccesses.size() << " vector aligned access(es) in the loop\n";
+    return true;
 }
 
-static bool
-AdjustStride(Loop& loop, PHINode& phi, uint vectorWidth)
+// the primary induction variable of the vector loop starts at a multiple of gcd(init, @vectorWidth * step)
+// if its initial value is a constant (a runtime value, e.g. n - 1 or the end of a peel loop, has no known alignment)
+static void
+ConfigureLoopShapes(Loop& loop, rv::VectorizationInfo& vecInfo, const std::vector<Induction>& inductions,
+                    uint vectorWidth)
 {
-    Instruction* increment = nullptr;
-    for (uint i = 0; i < phi.getNumIncomingValues(); ++i)
+    // configure initial shapes for induction variables (lane i starts at init + i * step)
+    auto& primary = GetPrimaryInduction(inductions);
+    for (auto& induction : inductions)
     {
-        auto* inVal = phi.getIncomingValue(i);
-        auto* inInst = dyn_cast<Instruction>(inVal);
-        if (!inInst || !loop.contains(inInst->getParent()))
+        auto* phi = induction.phi;
+        if (phi != primary.phi)
         {
+            vecInfo.setVectorShape(*phi, rv::VectorShape::strided(induction.step));
             continue;
         }
-        if (!inInst || (inInst->getOpcode() != Instruction::Add))
-        { continue; }
-        increment = inInst;
-        break;
-    }
 
-    // bump up loop increment to vector width
-    if (!increment) fail("could not identify increment add in vectorized loop.");
-    uint constPos = isa<Constant>(increment->getOperand(1)) ? 1 : 0;
-    auto* incStep = cast<ConstantInt>(increment->getOperand(constPos));
-    if (incStep->getLimitedValue() != 1) fail("increment != +1 currently unsupported!");
-    auto* vectorIncStep = ConstantInt::getSigned(incStep->getType(), vectorWidth);
-    increment->setOperand(constPos, vectorIncStep);
+        auto* phiInit = GetInitValue(loop, *phi);
+        uint ivAlignment = 1;
+        if (auto* constInit = dyn_cast<ConstantInt>(phiInit))
+        {
+            uint64_t vectorStep = vectorWidth * std::abs(induction.step);
+            ivAlignment = GreatestCommonDivisor64(std::abs(constInit->getSExtValue()), vectorStep);
+        }
+        vecInfo.setVectorShape(*phi, rv::VectorShape::strided(induction.step, ivAlignment));
+        vecInfo.setVectorShape(*phiInit, rv::VectorShape::strided(induction.step, ivAlignment));
+    }
 
-    return true;
+    // configure exit conditions to be non-divergent in any case
+    SmallVector<BasicBlock*, 4> exitingBlocks;
+    loop.getExitingBlocks(exitingBlocks);
+    if (exitingBlocks.empty()) fail("loop does not have an exit block!");
+    for (auto* exitingBlock : exitingBlocks)
+    {
+        auto* exitBranch = dyn_cast<BranchInst>(exitingBlock->getTerminator());
+        if (!exitBranch || !exitBranch->isConditional()) fail("unsupported loop exit (expected a conditional branch).");
+        vecInfo.setVectorShape(*exitBranch, rv::VectorShape::uni());
+        vecInfo.setVectorShape(*exitBranch->getCondition(), rv::VectorShape::uni());
+    }
 }
 
 void
 vectorizeLoop(Function& parentFn, Loop& loop, uint vectorWidth, LoopInfo& loopInfo, DFG& dfg,
-              CDG& cdg, DominatorTree& domTree, PostDominatorTree& postDomTree)
+              CDG& cdg, DominatorTree& domTree, PostDominatorTree& postDomTree, uint bosccThreshold,
+              rv::LaneIteration laneIteration, rv::TimeReport* timeReport,
+              const DenseMap<const Instruction*, uint>* alignedAccesses)
 {
     // assert: function is already normalized
 
@@ -164,32 +1509,39 @@ vectorizeLoop(Function& parentFn, Loop& loop, uint vectorWidth, LoopInfo& loopIn
     const bool useSSE = false;
     const bool useAVX = true;
     const bool useAVX2 = false;
+    const bool useAVX512 = platformInfo.hasAVX512(parentFn);
     const bool useImpreciseFunctions = false;
-    addSleefMappings(useSSE, useAVX, useAVX2, platformInfo, useImpreciseFunctions);
+    addSleefMappings(useSSE, useAVX, useAVX2, useAVX512, platformInfo, useImpreciseFunctions);
 
-    // configure initial shape for induction variable
-    auto* header = loop.getHeader();
-    PHINode* xPhi = cast<PHINode>(&*header->begin());
-    auto* xPhiInit = GetInitValue(loop, *xPhi);
-    errs() << "Vectorizing loop with induction variable " << *xPhi << "\n";
-    vecInfo.setVectorShape(*xPhi, rv::VectorShape::cont(vectorWidth));
-    vecInfo.setVectorShape(*xPhiInit, rv::VectorShape::cont(vectorWidth));
-
-    // configure exit condition to be non-divergent in any case
-    auto* exitBlock = loop.getExitingBlock();
-    if (!exitBlock) fail("loop does not have a unique exit block!");
-    vecInfo.setVectorShape(*exitBlock->getTerminator(), rv::VectorShape::uni());
-    vecInfo.setVectorShape(*cast<BranchInst>(exitBlock->getTerminator())->getOperand(0),
-                           rv::VectorShape::uni());
-
-    bool matched = AdjustStride(loop, *xPhi, vectorWidth);
-    if (!matched) fail("could not match ++i loop pattern");
+    // configure initial shapes for induction variables
+    auto inductions = CollectInductions(parentFn, loop, domTree, loopInfo);
+    ConfigureLoopShapes(loop, vecInfo, inductions, vectorWidth);
+    for (auto& induction : inductions)
+    {
+        errs() << "Vectorizing loop with induction variable " << *induction.phi << " (step " << induction.step << ")\n";
+    }
+
+    ScaleIncrements(loop, inductions, vectorWidth);
 
     rv::VectorizerInterface vectorizer(platformInfo);
+    vectorizer.setBOSCCThreshold(bosccThreshold);
+    vectorizer.setLaneIteration(laneIteration);
+    vectorizer.setTimeReport(timeReport);
 
     // vectorizationAnalysis
     vectorizer.analyze(vecInfo, cdg, dfg, loopInfo, postDomTree, domTree);
 
+    // accesses that were aligned by peeling use aligned vector loads and stores
+    if (alignedAccesses)
+    {
+        for (auto& it : *alignedAccesses)
+        {
+            auto shape = vecInfo.getVectorShape(*it.first);
+            shape.setAlignment(it.second);
+            vecInfo.setVectorShape(*it.first, shape);
+        }
+    }
+
     // mask analysis
     auto* maskAnalysis = vectorizer.analyzeMasks(vecInfo, loopInfo);
     assert(maskAnalysis);
@@ -214,12 +1566,329 @@ vectorizeLoop(Function& parentFn, Loop& loop, uint vectorWidth, LoopInfo& loopIn
     delete maskAnalysis;
 }
 
-// Use case: Outer-loop Vectorizer
-void
-vectorizeFirstLoop(Function& parentFn, uint vectorWidth)
+// target machine for the triple of the module of @fn and the target-cpu/target-features of @fn
+// (nullptr if the module has no triple or rvTool was not built for its target)
+static std::unique_ptr<TargetMachine>
+CreateTargetMachine(Function& fn)
 {
-    // normalize
-    normalizeFunction(parentFn);
+    std::string triple = fn.getParent()->getTargetTriple();
+    if (triple.empty()) return nullptr;
+
+    InitializeNativeTarget();
+    std::string error;
+    auto* target = TargetRegistry::lookupTarget(triple, error);
+    if (!target) return nullptr;
+
+    StringRef cpu = fn.hasFnAttribute("target-cpu") ? fn.getFnAttribute("target-cpu").getValueAsString() : "";
+    StringRef features = fn.hasFnAttribute("target-features") ? fn.getFnAttribute("target-features").getValueAsString() : "";
+    return std::unique_ptr<TargetMachine>(target->createTargetMachine(triple, cpu, features, TargetOptions()));
+}
+
+// pick the vector width for @loop with the lowest estimated cost per iteration
+// the ranking needs the costs of the target, without a target machine the default width is used
+uint
+SelectVectorWidth(Function& parentFn, Loop& loop, LoopInfo& loopInfo, DFG& dfg,
+                  CDG& cdg, DominatorTree& domTree, PostDominatorTree& postDomTree, rv::TimeReport* timeReport)
+{
+    Module& mod = *parentFn.getParent();
+
+    // analyze once at the widest candidate width
+    const uint candidateWidths[] = {2, 4, 8, 16};
+    const uint probeWidth = 16;
+
+    // the target independent TTI prices all widths the same (32bit vector registers, unit costs)
+    auto targetMachine = CreateTargetMachine(parentFn);
+    if (!targetMachine)
+    {
+        errs() << "Warning: no target machine for triple \"" << mod.getTargetTriple()
+               << "\", -w auto falls back to the vector width " << DefaultVectorWidth << "\n";
+        return DefaultVectorWidth;
+    }
+
+    rv::LoopRegion loopRegionImpl(loop);
+    rv::Region loopRegion(loopRegionImpl);
+    rv::VectorizationInfo vecInfo(parentFn, probeWidth, loopRegion);
+
+    TargetTransformInfo tti = targetMachine->getTargetIRAnalysis().run(parentFn);
+    TargetLibraryAnalysis libAnalysis;
+    TargetLibraryInfo tli = libAnalysis.run(*parentFn.getParent());
+    rv::PlatformInfo platformInfo(mod, &tti, &tli);
+
+    // link in SIMD library
+    const bool useSSE = false;
+    const bool useAVX = true;
+    const bool useAVX2 = false;
+    const bool useAVX512 = platformInfo.hasAVX512(parentFn);
+    const bool useImpreciseFunctions = false;
+    addSleefMappings(useSSE, useAVX, useAVX2, useAVX512, platformInfo, useImpreciseFunctions);
+
+    auto inductions = CollectInductions(parentFn, loop, domTree, loopInfo);
+    ConfigureLoopShapes(loop, vecInfo, inductions, probeWidth);
+
+    rv::VectorizerInterface vectorizer(platformInfo);
+    vectorizer.setTimeReport(timeReport);
+    auto estimates = vectorizer.rankVectorWidths(vecInfo, cdg, dfg, loopInfo, postDomTree, domTree, candidateWidths);
+    assert(!estimates.empty());
+
+    errs() << "Vector width ranking:\n";
+    for (auto& estimate : estimates)
+    {
+        errs() << "  ";
+        estimate.print(errs());
+        errs() << "\n";
+    }
+
+    return estimates[0].vectorWidth;
+}
+
+// integer value of the loop metadata !{!"@name", iN value} of @loop (nullptr if it is not set)
+static ConstantInt*
+GetLoopMetadataValue(Loop& loop, StringRef name)
+{
+    auto* loopID = loop.getLoopID();
+    if (!loopID) return nullptr;
+
+    // operand 0 is the self reference of the loop id
+    for (uint i = 1; i < loopID->getNumOperands(); ++i)
+    {
+        auto* entry = dyn_cast<MDNode>(loopID->getOperand(i));
+        if (!entry || entry->getNumOperands() != 2) continue;
+        auto* key = dyn_cast<MDString>(entry->getOperand(0));
+        if (!key || key->getString() != name) continue;
+        return mdconst::dyn_extract<ConstantInt>(entry->getOperand(1));
+    }
+    return nullptr;
+}
+
+// vector width requested by the metadata of @loop (rv.vectorize.width, then llvm.loop.vectorize.width), 0 if none
+static uint
+GetMetadataWidth(Loop& loop)
+{
+    auto* width = GetLoopMetadataValue(loop, "rv.vectorize.width");
+    if (!width) width = GetLoopMetadataValue(loop, "llvm.loop.vectorize.width");
+    return width && width->getZExtValue() > 1 ? width->getZExtValue() : 0;
+}
+
+// source lines [first, last] of the instructions in @loop, false if there is no debug info
+static bool
+GetLoopLines(Loop& loop, uint& first, uint& last)
+{
+    first = std::numeric_limits<uint>::max();
+    last = 0;
+    for (auto* block : loop.blocks())
+    {
+        for (auto& inst : *block)
+        {
+            auto& loc = inst.getDebugLoc();
+            if (!loc || loc.getLine() == 0) continue;
+            first = std::min(first, loc.getLine());
+            last = std::max(last, loc.getLine());
+        }
+    }
+    return last > 0;
+}
+
+static LoopSelection
+ParseLoopSelection(StringRef text)
+{
+    LoopSelection selection;
+    if (text == "all")
+    {
+        selection.kind = LoopSelectionKind::All;
+        return selection;
+    }
+    if (text == "meta")
+    {
+        selection.kind = LoopSelectionKind::Metadata;
+        return selection;
+    }
+
+    selection.kind = LoopSelectionKind::Index;
+    if (text.startswith("line:"))
+    {
+        selection.kind = LoopSelectionKind::Line;
+        text = text.drop_front(5);
+    }
+
+    SmallVector<StringRef, 4> items;
+    text.split(items, ',');
+    for (auto item : items)
+    {
+        uint value;
+        if (item.trim().getAsInteger(10, value))
+        {
+            fail("unknown loop selection (expected all, meta, line:N or a list of loop indices).");
+        }
+        selection.values.push_back(value);
+    }
+    return selection;
+}
+
+// loops of @parentFn that are picked by @selection
+static std::vector<Loop*>
+SelectLoops(Function& parentFn, LoopInfo& loopInfo, const LoopSelection& selection)
+{
+    // loops in the order of their headers (outer loops before their inner loops)
+    std::vector<Loop*> loops;
+    for (auto& block : parentFn)
+    {
+        auto* loop = loopInfo.getLoopFor(&block);
+        if (loop && loop->getHeader() == &block) loops.push_back(loop);
+    }
+
+    std::vector<Loop*> selected;
+    switch (selection.kind)
+    {
+        case LoopSelectionKind::All:
+            for (auto* loop : loops)
+            {
+                if (!loop->getParentLoop()) selected.push_back(loop);
+            }
+            break;
+
+        case LoopSelectionKind::Metadata:
+            for (auto* loop : loops)
+            {
+                auto* enable = GetLoopMetadataValue(*loop, "llvm.loop.vectorize.enable");
+                if ((enable && !enable->isZero()) || GetMetadataWidth(*loop) > 0) selected.push_back(loop);
+            }
+            break;
+
+        case LoopSelectionKind::Line:
+            // the innermost loops that span one of the lines
+            for (auto* loop : loops)
+            {
+                uint first, last;
+                if (!GetLoopLines(*loop, first, last)) continue;
+                for (uint line : selection.values)
+                {
+                    if (line < first || line > last) continue;
+                    bool inSubLoop = std::any_of(loop->begin(), loop->end(), [&](Loop* subLoop)
+                    {
+                        uint subFirst, subLast;
+                        return GetLoopLines(*subLoop, subFirst, subLast) && subFirst <= line && line <= subLast;
+                    });
+                    if (!inSubLoop) selected.push_back(loop);
+                    break;
+                }
+            }
+            break;
+
+        case LoopSelectionKind::Index:
+            for (uint index : selection.values)
+            {
+                if (index >= loops.size()) fail("loop index out of range.");
+                if (std::find(selected.begin(), selected.end(), loops[index]) == selected.end()) selected.push_back(loops[index]);
+            }
+            break;
+    }
+
+    // vectorizing a loop rewrites its inner loops
+    for (auto* loop : selected)
+    {
+        for (auto* other : selected)
+        {
+            if (other != loop && loop->contains(other)) fail("can not vectorize a loop and one of its inner loops.");
+        }
+    }
+
+    return selected;
+}
+
+// vectorize the loop with header @vecHeader (the function is normalized)
+static void
+vectorizeSelectedLoop(Function& parentFn, BasicBlock* vecHeader, uint vectorWidth, TailStrategy tailStrategy,
+                      uint bosccThreshold, rv::LaneIteration laneIteration, rv::TimeReport* timeReport,
+                      bool aliasCheck, bool peelAlign)
+{
+    // only inductions with a constant step remain
+    {
+        DominatorTree domTree(parentFn);
+        LoopInfo loopInfo(domTree);
+        CanonicalizeInductions(parentFn, *loopInfo.getLoopFor(vecHeader), domTree, loopInfo);
+    }
+
+    // rank the vector widths on the unmodified loop
+    if (vectorWidth == 0)
+    {
+        DominatorTree domTree(parentFn);
+        PostDominatorTree postDomTree;
+        postDomTree.runOnFunction(parentFn);
+        LoopInfo loopInfo(domTree);
+
+        DFG dfg(domTree);
+        dfg.create(parentFn);
+        CDG cdg(*postDomTree.DT);
+        cdg.create(parentFn);
+
+        LoopExitCanonicalizer canonicalizer(loopInfo);
+        canonicalizer.canonicalize(parentFn);
+
+        vectorWidth = SelectVectorWidth(parentFn, *loopInfo.getLoopFor(vecHeader), loopInfo, dfg, cdg, domTree, postDomTree,
+                                        timeReport);
+        errs() << "Selected vector width " << vectorWidth << "\n";
+    }
+
+    // guard the loop with a runtime alias check, the scalar loop runs if the accessed ranges overlap
+    if (aliasCheck)
+    {
+        DominatorTree domTree(parentFn);
+        LoopInfo loopInfo(domTree);
+        auto* vecLoop = loopInfo.getLoopFor(vecHeader);
+        if (!VersionLoopForAliasing(parentFn, *vecLoop, domTree, loopInfo))
+        {
+            // the accesses may overlap across iterations, vectorizing without the check could change the results
+            errs() << "Warning: could not compute the accessed address ranges, the loop stays scalar "
+                   << "(-no-alias-check vectorizes it without alias check).\n";
+            return;
+        }
+
+        // restore preheaders and dedicated exits
+        normalizeFunction(parentFn);
+    }
+
+    // peel scalar iterations until the dominant store stream is vector aligned
+    DenseMap<const Instruction*, uint> alignedAccesses;
+    bool peeled = false;
+    if (peelAlign)
+    {
+        if (tailStrategy == TailStrategy::None) fail("alignment peeling requires -tail remainder or fold.");
+
+        DominatorTree domTree(parentFn);
+        LoopInfo loopInfo(domTree);
+        auto* vecLoop = loopInfo.getLoopFor(vecHeader);
+        peeled = PeelForAlignment(parentFn, *vecLoop, vectorWidth, domTree, loopInfo, alignedAccesses);
+        if (!peeled) errs() << "Warning: no unit stride store in the loop, not peeling for alignment.\n";
+
+        normalizeFunction(parentFn);
+    }
+
+    // prepare the loop for trip counts that are not a multiple of the vector width
+    {
+        DominatorTree domTree(parentFn);
+        LoopInfo loopInfo(domTree);
+        auto* vecLoop = loopInfo.getLoopFor(vecHeader);
+        assert(vecLoop && vecLoop->getHeader() == vecHeader);
+
+        // divergent early exits leave through the scalar remainder loop
+        SmallVector<BasicBlock*, 4> exitingBlocks;
+        vecLoop->getExitingBlocks(exitingBlocks);
+        bool hasEarlyExits = exitingBlocks.size() > 1;
+        if (hasEarlyExits && tailStrategy != TailStrategy::Remainder) fail("loops with early exits require -tail remainder.");
+        if (hasEarlyExits) CheckEarlyExitSpeculation(parentFn, *vecLoop, domTree, loopInfo);
+
+        if (tailStrategy == TailStrategy::Remainder)
+        {
+            auto inductions = CollectInductions(parentFn, *vecLoop, domTree, loopInfo);
+            DenseMap<PHINode*, PHINode*> remInitPhis;
+            auto* remPreheader = CreateRemainderLoop(parentFn, *vecLoop, vectorWidth, domTree, loopInfo, remInitPhis);
+            if (hasEarlyExits) GuardEarlyExits(parentFn, *vecLoop, inductions, *remPreheader, remInitPhis);
+        }
+        else if (tailStrategy == TailStrategy::Fold)
+        {
+            FoldTail(parentFn, *vecLoop, vectorWidth, domTree, loopInfo);
+        }
+    }
 
     // build Analysis
     DominatorTree domTree(parentFn);
@@ -239,24 +1908,52 @@ vectorizeFirstLoop(Function& parentFn, uint vectorWidth)
     LoopExitCanonicalizer canonicalizer(loopInfo);
     canonicalizer.canonicalize(parentFn);
 
-    if (loopInfo.begin() == loopInfo.end())
-    {
-        return;
-    }
+    auto* vecLoop = loopInfo.getLoopFor(vecHeader);
+    assert(vecLoop && vecLoop->getHeader() == vecHeader);
+
+    vectorizeLoop(parentFn, *vecLoop, vectorWidth, loopInfo, dfg, cdg, domTree, postDomTree, bosccThreshold,
+                  laneIteration, timeReport, peeled ? &alignedAccesses : nullptr);
+}
 
-    auto* firstLoop = *loopInfo.begin();
+// Use case: Outer-loop Vectorizer
+void
+vectorizeLoops(Function& parentFn, const LoopSelection& selection, uint vectorWidth, TailStrategy tailStrategy,
+               uint bosccThreshold, rv::LaneIteration laneIteration, rv::TimeReport* timeReport, bool aliasCheck,
+               bool peelAlign)
+{
+    // normalize
+    normalizeFunction(parentFn);
 
-    vectorizeLoop(parentFn, *firstLoop, vectorWidth, loopInfo, dfg, cdg, domTree, postDomTree);
+    // the headers of the selected loops survive the vectorization of the other loops
+    std::vector<BasicBlock*> vecHeaders;
+    std::vector<uint> vecWidths;
+    {
+        DominatorTree domTree(parentFn);
+        LoopInfo loopInfo(domTree);
+        for (auto* loop : SelectLoops(parentFn, loopInfo, selection))
+        {
+            uint metadataWidth = GetMetadataWidth(*loop);
+            vecHeaders.push_back(loop->getHeader());
+            vecWidths.push_back(metadataWidth ? metadataWidth : vectorWidth);
+        }
+    }
+    if (vecHeaders.empty()) errs() << "Warning: no loop selected for vectorization.\n";
 
-    // mark region
-    // run RV
-    // replace stride
+    // every vectorized loop changes the CFG, the analyses are rebuilt for the next one
+    for (uint i = 0; i < vecHeaders.size(); ++i)
+    {
+        errs() << "Vectorizing loop at " << vecHeaders[i]->getName() << " (" << (i + 1) << " of "
+               << vecHeaders.size() << ")\n";
+        vectorizeSelectedLoop(parentFn, vecHeaders[i], vecWidths[i], tailStrategy, bosccThreshold, laneIteration,
+                              timeReport, aliasCheck, peelAlign);
+    }
 }
 
 
 // Use case: Whole-Function Vectorizer
 void
-vectorizeFunction(rv::VectorMapping& vectorizerJob)
+vectorizeFunction(rv::VectorMapping& vectorizerJob, uint bosccThreshold, rv::LaneIteration laneIteration,
+                  rv::TimeReport* timeReport)
 {
     Function* scalarFn = vectorizerJob.scalarFn;
     Module& mod = *scalarFn->getParent();
@@ -284,13 +1981,17 @@ vectorizeFunction(rv::VectorMapping& vectorizerJob)
     rv::PlatformInfo platformInfo(mod, &tti, &tli);
 
     rv::VectorizerInterface vectorizer(platformInfo);
+    vectorizer.setBOSCCThreshold(bosccThreshold);
+    vectorizer.setLaneIteration(laneIteration);
+    vectorizer.setTimeReport(timeReport);
 
     // link in SIMD library
     const bool useSSE = false;
     const bool useAVX = true;
     const bool useAVX2 = false;
+    const bool useAVX512 = platformInfo.hasAVX512(*scalarFn);
     const bool useImpreciseFunctions = false;
-    addSleefMappings(useSSE, useAVX, useAVX2, platformInfo, useImpreciseFunctions);
+    addSleefMappings(useSSE, useAVX, useAVX2, useAVX512, platformInfo, useImpreciseFunctions);
 
     // set-up vecInfo overlay and define vectorization job (mapping)
     rv::VectorMapping targetMapping = vectorizerJob;
@@ -441,6 +2142,51 @@ int main(int argc, char** argv)
 
     bool lowerIntrinsics = reader.hasOption("-lower");
 
+    // loop mode: the loops to vectorize (default: the first loop)
+    LoopSelection loopSelection{LoopSelectionKind::Index, {0}};
+    std::string loopText;
+    if (reader.readOption<std::string>("-l", loopText)) loopSelection = ParseLoopSelection(loopText);
+
+    // loop mode: version the loop with a runtime check for overlapping pointers
+    bool aliasCheck = !reader.hasOption("-no-alias-check");
+
+    // loop mode: peel iterations until the dominant store stream is vector aligned
+    bool peelAlign = reader.hasOption("-peel-align");
+
+    TailStrategy tailStrategy = TailStrategy::None;
+    std::string tailText;
+    if (reader.readOption<std::string>("-tail", tailText))
+    {
+        if (tailText == "remainder") tailStrategy = TailStrategy::Remainder;
+        else if (tailText == "fold") tailStrategy = TailStrategy::Fold;
+        else if (tailText != "none") fail("unknown tail strategy (expected none, remainder or fold).");
+    }
+
+    // guard costly linearized blocks with rv_any/rv_all branches
+    uint bosccThreshold = 0;
+    if (reader.hasOption("-boscc"))
+    {
+        bosccThreshold = reader.getOption<uint>("-boscc-threshold", 16);
+    }
+
+    // replicate predicated code with unrolled per-lane cascades or loops over the active lanes
+    rv::LaneIteration laneIteration = rv::LaneIteration::Auto;
+    std::string lanesText;
+    if (reader.readOption<std::string>("-lanes", lanesText))
+    {
+        if (lanesText == "unrolled") laneIteration = rv::LaneIteration::Unrolled;
+        else if (lanesText == "loop") laneIteration = rv::LaneIteration::Loop;
+        else if (lanesText != "auto") fail("unknown lane iteration (expected auto, unrolled or loop).");
+    }
+
+    // per-phase compile time and statistics as JSON
+    std::string timeReportFile;
+    bool hasTimeReport = reader.readOption<std::string>("-time-report", timeReportFile);
+
+    // optimization remarks (lowering statistics per source location) as YAML
+    std::string remarksFile;
+    bool hasRemarksFile = reader.readOption<std::string>("-pass-remarks-output", remarksFile);
+
     std::string outFile;
     bool hasOutFile = reader.readOption<std::string>("-o", outFile);
 
@@ -448,12 +2194,19 @@ int main(int argc, char** argv)
     {
         std::cerr << "Not all arguments specified -wfv/-loopvec) "
                   << "-i MODULE -k KERNELNAME [-target TARGET_DECL]"
-                  << "[-o OUTPUT_LL] [-w 8] [--lower]\n";
+                  << "[-o OUTPUT_LL] [-w 8|auto] [-l 0|0,2|meta|line:N|all] [--lower] [-tail none|remainder|fold] [-boscc [-boscc-threshold 16]] [-lanes auto|unrolled|loop] [-no-alias-check] [-peel-align] [-time-report REPORT_JSON] [-pass-remarks-output REMARKS_YAML]\n";
         return -1;
     }
 
+    std::unique_ptr<rv::TimeReport> timeReport;
+    if (hasTimeReport) timeReport.reset(new rv::TimeReport());
+
     LLVMContext context;
 
+    std::string remarksText;
+    raw_string_ostream remarksStream(remarksText);
+    if (hasRemarksFile) context.setDiagnosticHandler(handleDiagnostic, &remarksStream);
+
     // Load module
     llvm::Module* mod = createModuleFromFile(inFile, context);
     if (!mod)
@@ -497,7 +2250,21 @@ int main(int argc, char** argv)
       }
     }
 
-    uint vectorWidth = reader.getOption<uint>("-w", 8);
+    // "-w auto" picks the width with the cost model (loop mode only)
+    uint vectorWidth = DefaultVectorWidth;
+    std::string widthText;
+    if (reader.readOption<std::string>("-w", widthText))
+    {
+        if (widthText == "auto")
+        {
+            if (!loopVecMode) fail("-w auto is only supported with -loopvec.");
+            vectorWidth = 0;
+        }
+        else
+        {
+            vectorWidth = reader.getOption<uint>("-w", DefaultVectorWidth);
+        }
+    }
 
     if (wfvMode)
     {
@@ -528,12 +2295,13 @@ int main(int argc, char** argv)
         errs() << "\nVectorizing kernel \"" << vectorizerJob.scalarFn->getName()
                << "\" into declaration \"" << vectorizerJob.vectorFn->getName()
                << "\" with vector size " << vectorizerJob.vectorWidth << "... \n";
-        vectorizeFunction(vectorizerJob);
+        vectorizeFunction(vectorizerJob, bosccThreshold, laneIteration, timeReport.get());
 
     }
     else if (loopVecMode)
     {
-        vectorizeFirstLoop(*scalarFn, vectorWidth);
+        vectorizeLoops(*scalarFn, loopSelection, vectorWidth, tailStrategy, bosccThreshold, laneIteration,
+                       timeReport.get(), aliasCheck, peelAlign);
     }
 
     if (lowerIntrinsics) {
@@ -541,6 +2309,25 @@ int main(int argc, char** argv)
       rv::lowerIntrinsics(*scalarFn);
     }
 
+    if (hasRemarksFile)
+    {
+        std::error_code EC;
+        raw_fd_ostream remarksOut(remarksFile, EC, sys::fs::F_Text);
+        if (EC) fail("could not open remarks file.");
+        remarksOut << remarksStream.str();
+        errs() << "Optimization remarks written to \"" << remarksFile << "\"\n";
+    }
+
+    if (timeReport)
+    {
+        std::error_code EC;
+        raw_fd_ostream reportStream(timeReportFile, EC, sys::fs::F_Text);
+        if (EC) fail("could not open time report file.");
+        timeReport->printJSON(reportStream);
+        timeReport->print(errs());
+        errs() << "Time report written to \"" << timeReportFile << "\"\n";
+    }
+
     //output
     if (hasOutFile)
     {